@@ -0,0 +1,504 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Microbenchmarks for the solver kernels.
+//                Times each kernel over a sweep of instance sizes with fixed
+//                seeds and reports ns/op and allocations/op as CSV or JSON.
+//                On Linux, hardware counters (instructions per cycle and 
+//                cache, branch and TLB misses per op) are reported as well,
+//                with each kernel tagged with the solver region it belongs 
+//                to.
+//                Usage: Benchmark [--format csv|json] [--sizes 100,1000,...]
+//                                 [--min-time seconds] [--seed n]
+//                                 [--filter kernel-name-prefix]
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Geometry.h"
+#include "ArrayTour.h"
+#include "TwoLevelList.h"
+#include "Genetic.h"
+#include "Utils.h"
+#include "HardwareCounters.h"
+#include "BatchDistances.h"
+#include "NeighbourLists.h"
+#include "LocalSearch.h"
+
+// Counts every allocation made through operator new so that kernels which
+// allocate per operation show up in the results.
+static std::atomic<unsigned long long> g_allocationCount{ 0 };
+
+void* operator new(size_t size)
+{
+	g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void* ptr = std::malloc(size ? size : 1))
+		return ptr;
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	operator delete(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	operator delete(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+	operator delete(ptr);
+}
+
+namespace {
+	// Kernel results are accumulated here so the optimizer cannot remove 
+	// the work being timed.
+	volatile double g_sink = 0;
+
+	struct Options {
+		std::string format = "csv";
+		std::vector<size_t> sizes = { 100, 1000, 10000, 100000, 1000000 };
+		double minTime = 0.2;
+		unsigned seed = 12345;
+		std::string filter;
+	};
+
+	struct Result {
+		std::string kernel;
+		size_t size;
+		unsigned long long iterations;
+		double nsPerOp;
+		double allocsPerOp;
+		HardwareCounterValues hardwareCounters;
+	};
+
+	// A kernel prepares its state for an instance size, then returns the 
+	// operation to time. Kernels with a maxSize above zero are skipped for 
+	// larger sizes, and kernels that do not depend on the size run once.
+	struct Kernel {
+		std::string name;
+		size_t maxSize;
+		bool sizeIndependent;
+		std::function<std::function<void()>(size_t size, unsigned seed)> setup;
+	};
+
+	PointList makePoints(size_t size, unsigned seed)
+	{
+		std::mt19937 generator(seed);
+		std::uniform_real_distribution<double> dist(0, 1000);
+		PointList points(size);
+		for (Eigen::Vector2d& point : points)
+			point = { dist(generator), dist(generator) };
+		return points;
+	}
+
+	std::vector<size_t> makeTour(size_t size, unsigned seed)
+	{
+		std::vector<size_t> tour(size);
+		for (size_t i = 0; i < size; ++i)
+			tour[i] = i;
+		std::shuffle(tour.begin(), tour.end(), std::mt19937(seed));
+		return tour;
+	}
+
+	// Random indices in [0, size), precomputed so that drawing them is not 
+	// part of the timed operation.
+	std::vector<size_t> makeIndices(size_t size, unsigned seed)
+	{
+		const size_t kIndexCount = 4096;
+		std::mt19937 generator(seed);
+		std::uniform_int_distribution<size_t> dist(0, size - 1);
+		std::vector<size_t> indices(kIndexCount);
+		for (size_t& index : indices)
+			index = dist(generator);
+		return indices;
+	}
+
+	// Returns the solver region a kernel belongs to, so that counters can be
+	// compared between kernels doing the same kind of work.
+	std::string getRegion(const std::string& kernelName)
+	{
+		const char* kDistanceKernels[] = { "calculatePathLength", "calculateDistances", "calculatePairDistances", "distance", "swapDelta", "twoOptDelta", "selectBest" };
+		const char* kMoveKernels[] = { "twoOptFlip", "mutate" };
+		for (const char* prefix : kDistanceKernels) {
+			if (kernelName.compare(0, std::strlen(prefix), prefix) == 0)
+				return "distance";
+		}
+		for (const char* prefix : kMoveKernels) {
+			if (kernelName.compare(0, std::strlen(prefix), prefix) == 0)
+				return "move";
+		}
+		if (kernelName == "crossover")
+			return "crossover";
+		if (kernelName.compare(0, std::strlen("descent"), "descent") == 0)
+			return "search";
+		return "other";
+	}
+
+	// Formats a hardware counter per op, or an empty (null in JSON) value
+	// if the counter is not available.
+	std::string formatPerOp(const Result& result, HardwareCounterValues::Counter counter, const Options& options)
+	{
+		if (!result.hardwareCounters.available[counter])
+			return options.format == "csv" ? "" : "null";
+		char text[32];
+		std::snprintf(text, sizeof(text), "%.4f", static_cast<double>(result.hardwareCounters.values[counter]) / result.iterations);
+		return text;
+	}
+
+	// Times an operation until at least minTime has passed.
+	Result runKernel(const Kernel& kernel, size_t size, const Options& options)
+	{
+		getRandomGenerator().seed(options.seed);
+		std::function<void()> op = kernel.setup(size, options.seed);
+
+		// Warm up caches and lazily allocated buffers
+		op();
+
+		using namespace std::chrono;
+		unsigned long long iterations = 0;
+		unsigned long long batchSize = 1;
+		double elapsed = 0;
+		unsigned long long allocations = 0;
+		HardwareCounters counters;
+		HardwareCounterValues counted;
+		while (elapsed < options.minTime) {
+			unsigned long long allocationsBefore = g_allocationCount.load(std::memory_order_relaxed);
+			HardwareCounterValues countersBefore = counters.read();
+			auto begin = high_resolution_clock::now();
+			for (unsigned long long i = 0; i < batchSize; ++i)
+				op();
+			auto end = high_resolution_clock::now();
+			HardwareCounterValues countersAfter = counters.read();
+			countersAfter -= countersBefore;
+			counted += countersAfter;
+			allocations += g_allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+			elapsed += duration_cast<nanoseconds>(end - begin).count() / 1e9;
+			iterations += batchSize;
+			batchSize *= 2;
+		}
+
+		return Result{ kernel.name, size, iterations, elapsed * 1e9 / iterations, static_cast<double>(allocations) / iterations, counted };
+	}
+
+	template <typename TourT>
+	Kernel makeTwoOptDeltaKernel(const std::string& name)
+	{
+		return Kernel{ name, 0, false, [](size_t size, unsigned seed) -> std::function<void()> {
+			auto points = std::make_shared<PointList>(makePoints(size, seed));
+			auto tour = std::make_shared<TourT>(makeTour(size, seed));
+			auto indices = std::make_shared<std::vector<size_t>>(makeIndices(size, seed));
+			auto i = std::make_shared<size_t>(0);
+			return [=]() {
+				size_t a = (*indices)[*i % indices->size()];
+				size_t c = (*indices)[(*i + 1) % indices->size()];
+				++*i;
+				size_t b = tour->next(a);
+				size_t d = tour->next(c);
+				g_sink = g_sink + euclideanDist(*points, a, c) + euclideanDist(*points, b, d)
+				       - euclideanDist(*points, a, b) - euclideanDist(*points, c, d);
+			};
+		} };
+	}
+
+	template <typename TourT>
+	Kernel makeTwoOptFlipKernel(const std::string& name)
+	{
+		return Kernel{ name, 0, false, [](size_t size, unsigned seed) -> std::function<void()> {
+			auto tour = std::make_shared<TourT>(makeTour(size, seed));
+			auto indices = std::make_shared<std::vector<size_t>>(makeIndices(size, seed));
+			auto i = std::make_shared<size_t>(0);
+			return [=]() {
+				size_t a = (*indices)[*i % indices->size()];
+				size_t c = (*indices)[(*i + 1) % indices->size()];
+				++*i;
+				size_t b = tour->next(a);
+				size_t d = tour->next(c);
+				if (a != c && b != c && a != d)
+					tour->flip(a, b, c, d);
+			};
+		} };
+	}
+
+	// Distances from a point to a full batch of cities, or between two full
+	// batches pairwise. The batches are gathered up front, so only the
+	// arithmetic is timed.
+	Kernel makeBatchDistancesKernel(const std::string& name, bool pairwise, bool avx2)
+	{
+		return Kernel{ name, 0, true, [pairwise, avx2](size_t, unsigned seed) -> std::function<void()> {
+			const size_t kBatchCount = 256;
+			setAvx2Enabled(avx2);
+			PointList points = makePoints(kBatchCount * PointBatch::s_kMaxSize, seed);
+			auto batches = std::make_shared<std::vector<PointBatch>>(kBatchCount);
+			std::vector<size_t> cities(PointBatch::s_kMaxSize);
+			for (size_t batch = 0; batch < kBatchCount; ++batch) {
+				for (size_t j = 0; j < cities.size(); ++j)
+					cities[j] = batch * PointBatch::s_kMaxSize + j;
+				(*batches)[batch].gather(points, cities.data(), cities.size());
+			}
+			auto i = std::make_shared<size_t>(0);
+			return [=]() {
+				const PointBatch& from = (*batches)[*i % batches->size()];
+				const PointBatch& to = (*batches)[(*i + 1) % batches->size()];
+				++*i;
+				double distances[PointBatch::s_kMaxSize];
+				if (pairwise)
+					calculatePairDistances(from, to, PointBatch::s_kMaxSize, distances);
+				else
+					calculateDistances(Eigen::Vector2d(from.xs[0], from.ys[0]), to, PointBatch::s_kMaxSize, distances);
+				g_sink = g_sink + distances[0] + distances[PointBatch::s_kMaxSize - 1];
+			};
+		} };
+	}
+
+	// A full 2-opt and Or-opt descent from a random tour, with or without
+	// evaluating candidates as a batch. Comparing the two shows whether the
+	// batch threshold in LocalSearch pays off on the whole search, where
+	// most cities end up with only a few candidates in range.
+	Kernel makeDescentKernel(const std::string& name, size_t neighbourCount, bool batching)
+	{
+		return Kernel{ name, 10000, false, [neighbourCount, batching](size_t size, unsigned seed) -> std::function<void()> {
+			setAvx2Enabled(true);
+			auto points = std::make_shared<PointList>(makePoints(size, seed));
+			auto neighbours = std::make_shared<NeighbourLists>(*points, neighbourCount);
+			auto start = std::make_shared<std::vector<size_t>>(makeTour(size, seed));
+			return [=]() {
+				ArrayTour tour(*start);
+				LocalSearch<ArrayTour> localSearch(tour, *points, *neighbours);
+				localSearch.setBatching(batching);
+				localSearch.pushAll();
+				g_sink = g_sink + localSearch.optimize();
+			};
+		} };
+	}
+
+	std::vector<Kernel> makeKernels()
+	{
+		// Pool size used by the genetic solver's tournament selection
+		const size_t kSelectionPoolSize = 5;
+
+		// Neighbour list length used by the solvers
+		const size_t kNeighbourCount = 8;
+
+		std::vector<Kernel> kernels;
+
+		kernels.push_back({ "calculatePathLength", 0, false, [](size_t size, unsigned seed) -> std::function<void()> {
+			auto points = std::make_shared<PointList>(makePoints(size, seed));
+			auto tour = std::make_shared<std::vector<size_t>>(makeTour(size, seed));
+			return [=]() { g_sink = g_sink + calculatePathLength(*points, *tour); };
+		} });
+
+		kernels.push_back({ "distance", 0, false, [](size_t size, unsigned seed) -> std::function<void()> {
+			auto points = std::make_shared<PointList>(makePoints(size, seed));
+			auto indices = std::make_shared<std::vector<size_t>>(makeIndices(size, seed));
+			auto i = std::make_shared<size_t>(0);
+			return [=]() {
+				size_t a = (*indices)[*i % indices->size()];
+				size_t b = (*indices)[(*i + 1) % indices->size()];
+				++*i;
+				g_sink = g_sink + euclideanDist(*points, a, b);
+			};
+		} });
+
+		// The AVX2 kernels only exist on CPUs that support it
+		if (isAvx2Enabled()) {
+			kernels.push_back(makeBatchDistancesKernel("calculateDistances/AVX2", false, true));
+			kernels.push_back(makeBatchDistancesKernel("calculatePairDistances/AVX2", true, true));
+		}
+		kernels.push_back(makeBatchDistancesKernel("calculateDistances/scalar", false, false));
+		kernels.push_back(makeBatchDistancesKernel("calculatePairDistances/scalar", true, false));
+
+		// Delta of swapping the cities at two tour positions, measured over
+		// the (up to) four edges that change
+		kernels.push_back({ "swapDelta", 0, false, [](size_t size, unsigned seed) -> std::function<void()> {
+			auto points = std::make_shared<PointList>(makePoints(size, seed));
+			auto tour = std::make_shared<std::vector<size_t>>(makeTour(size, seed));
+			auto indices = std::make_shared<std::vector<size_t>>(makeIndices(size, seed));
+			auto i = std::make_shared<size_t>(0);
+			return [=]() {
+				const std::vector<size_t>& path = *tour;
+				size_t n = path.size();
+				size_t posA = (*indices)[*i % indices->size()];
+				size_t posB = (*indices)[(*i + 1) % indices->size()];
+				++*i;
+				size_t a = path[posA], b = path[posB];
+				size_t prevA = path[(posA + n - 1) % n], nextA = path[(posA + 1) % n];
+				size_t prevB = path[(posB + n - 1) % n], nextB = path[(posB + 1) % n];
+				double before = euclideanDist(*points, prevA, a) + euclideanDist(*points, a, nextA)
+				              + euclideanDist(*points, prevB, b) + euclideanDist(*points, b, nextB);
+				double after = euclideanDist(*points, prevA, b) + euclideanDist(*points, b, nextA)
+				             + euclideanDist(*points, prevB, a) + euclideanDist(*points, a, nextB);
+				g_sink = g_sink + after - before;
+			};
+		} });
+
+		kernels.push_back(makeTwoOptDeltaKernel<ArrayTour>("twoOptDelta/ArrayTour"));
+		kernels.push_back(makeTwoOptDeltaKernel<TwoLevelList>("twoOptDelta/TwoLevelList"));
+		kernels.push_back(makeTwoOptFlipKernel<ArrayTour>("twoOptFlip/ArrayTour"));
+		kernels.push_back(makeTwoOptFlipKernel<TwoLevelList>("twoOptFlip/TwoLevelList"));
+		kernels.push_back(makeDescentKernel("descent/batched", kNeighbourCount, true));
+		kernels.push_back(makeDescentKernel("descent/unbatched", kNeighbourCount, false));
+
+		// Crossover is quadratic in the tour size
+		kernels.push_back({ "crossover", 10000, false, [](size_t size, unsigned seed) -> std::function<void()> {
+			auto parent1 = std::make_shared<std::vector<size_t>>(makeTour(size, seed));
+			auto parent2 = std::make_shared<std::vector<size_t>>(makeTour(size, seed + 1));
+			return [=]() { g_sink = g_sink + crossover(*parent1, *parent2).front(); };
+		} });
+
+		kernels.push_back({ "mutate", 0, false, [](size_t size, unsigned seed) -> std::function<void()> {
+			auto tour = std::make_shared<std::vector<size_t>>(makeTour(size, seed));
+			return [=]() { g_sink = g_sink + mutate(*tour).front(); };
+		} });
+
+		kernels.push_back({ "selectBest", 0, false, [kSelectionPoolSize](size_t size, unsigned seed) -> std::function<void()> {
+			auto points = std::make_shared<PointList>(makePoints(size, seed));
+			auto pool = std::make_shared<std::vector<std::vector<size_t>>>();
+			for (size_t i = 0; i < kSelectionPoolSize; ++i)
+				pool->push_back(makeTour(size, seed + static_cast<unsigned>(i)));
+			return [=]() { g_sink = g_sink + selectBest(*points, *pool).front(); };
+		} });
+
+		kernels.push_back({ "randomInt", 0, true, [](size_t, unsigned) -> std::function<void()> {
+			return []() { g_sink = g_sink + randomInt(static_cast<size_t>(0), static_cast<size_t>(999999)); };
+		} });
+
+		kernels.push_back({ "randomReal", 0, true, [](size_t, unsigned) -> std::function<void()> {
+			return []() { g_sink = g_sink + randomReal(); };
+		} });
+
+		return kernels;
+	}
+
+	bool parseOptions(int argc, char** argv, Options& outOptions)
+	{
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			if (i + 1 >= argc)
+				return false;
+			std::string value = argv[++i];
+			if (arg == "--format" && (value == "csv" || value == "json")) {
+				outOptions.format = value;
+			}
+			else if (arg == "--sizes") {
+				outOptions.sizes.clear();
+				size_t start = 0;
+				while (start < value.size()) {
+					size_t end = value.find(',', start);
+					if (end == std::string::npos)
+						end = value.size();
+					size_t size = std::strtoull(value.substr(start, end - start).c_str(), nullptr, 10);
+					if (size < 4)
+						return false;
+					outOptions.sizes.push_back(size);
+					start = end + 1;
+				}
+			}
+			else if (arg == "--min-time") {
+				outOptions.minTime = std::atof(value.c_str());
+			}
+			else if (arg == "--seed") {
+				outOptions.seed = static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+			}
+			else if (arg == "--filter") {
+				outOptions.filter = value;
+			}
+			else {
+				return false;
+			}
+		}
+
+		return !outOptions.sizes.empty();
+	}
+
+	void printResult(const Result& result, const Options& options, bool first)
+	{
+		std::string region = getRegion(result.kernel);
+		std::string ipc = options.format == "csv" ? "" : "null";
+		if (result.hardwareCounters.available[HardwareCounterValues::Instructions]) {
+			char text[32];
+			std::snprintf(text, sizeof(text), "%.3f", result.hardwareCounters.getInstructionsPerCycle());
+			ipc = text;
+		}
+		std::string cacheMisses = formatPerOp(result, HardwareCounterValues::CacheMisses, options);
+		std::string branchMisses = formatPerOp(result, HardwareCounterValues::BranchMisses, options);
+		std::string tlbMisses = formatPerOp(result, HardwareCounterValues::TlbMisses, options);
+
+		if (options.format == "csv") {
+			if (first)
+				std::printf("kernel,region,size,iterations,ns_per_op,allocs_per_op,ipc,cache_misses_per_op,branch_misses_per_op,tlb_misses_per_op\n");
+			std::printf("%s,%s,%zu,%llu,%.2f,%.3f,%s,%s,%s,%s\n", result.kernel.c_str(), region.c_str(), result.size, result.iterations, 
+			            result.nsPerOp, result.allocsPerOp, ipc.c_str(), cacheMisses.c_str(), branchMisses.c_str(), tlbMisses.c_str());
+		}
+		else {
+			std::printf("%s\n  {\"kernel\": \"%s\", \"region\": \"%s\", \"size\": %zu, \"iterations\": %llu, \"ns_per_op\": %.2f, \"allocs_per_op\": %.3f, "
+			            "\"ipc\": %s, \"cache_misses_per_op\": %s, \"branch_misses_per_op\": %s, \"tlb_misses_per_op\": %s}",
+			            first ? "[" : ",", result.kernel.c_str(), region.c_str(), result.size, result.iterations, result.nsPerOp, result.allocsPerOp,
+			            ipc.c_str(), cacheMisses.c_str(), branchMisses.c_str(), tlbMisses.c_str());
+		}
+		std::fflush(stdout);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!parseOptions(argc, argv, options)) {
+		std::fprintf(stderr, "Usage: Benchmark [--format csv|json] [--sizes 100,1000,...] [--min-time seconds] [--seed n] [--filter prefix]\n");
+		return EXIT_FAILURE;
+	}
+
+	bool first = true;
+	for (const Kernel& kernel : makeKernels()) {
+		if (kernel.name.compare(0, options.filter.size(), options.filter) != 0)
+			continue;
+
+		if (kernel.sizeIndependent) {
+			printResult(runKernel(kernel, 0, options), options, first);
+			first = false;
+			continue;
+		}
+
+		for (size_t size : options.sizes) {
+			if (kernel.maxSize > 0 && size > kernel.maxSize)
+				continue;
+			printResult(runKernel(kernel, size, options), options, first);
+			first = false;
+		}
+	}
+
+	if (options.format == "json")
+		std::printf(first ? "[]\n" : "\n]\n");
+
+	return EXIT_SUCCESS;
+}
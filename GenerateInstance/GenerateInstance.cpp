@@ -0,0 +1,111 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Command line tool that generates a synthetic instance and 
+//                writes it to a file. Files ending in .tsp are written in the
+//                TSPLIB format, anything else in the binary instance format.
+//                Usage: GenerateInstance --output file [--distribution 
+//                                        uniform|clustered|grid|road]
+//                                        [--count n] [--seed n] [--size x]
+//                                        [--clusters n] [--cluster-spread x]
+//                                        [--jitter x] [--roads n]
+//                                        [--road-spread x]
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "InstanceGenerator.h"
+#include "Instance.h"
+
+namespace {
+	bool endsWith(const std::string& str, const std::string& suffix)
+	{
+		return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+
+	bool parseOptions(int argc, char** argv, GeneratorSettings& outSettings, std::string& outFileName)
+	{
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			if (i + 1 >= argc)
+				return false;
+			std::string value = argv[++i];
+			if (arg == "--output") {
+				outFileName = value;
+			}
+			else if (arg == "--distribution") {
+				if (!parseDistribution(value, outSettings.distribution))
+					return false;
+			}
+			else if (arg == "--count") {
+				outSettings.nodeCount = std::strtoull(value.c_str(), nullptr, 10);
+			}
+			else if (arg == "--seed") {
+				outSettings.seed = std::strtoull(value.c_str(), nullptr, 10);
+			}
+			else if (arg == "--size") {
+				outSettings.size = std::atof(value.c_str());
+			}
+			else if (arg == "--clusters") {
+				outSettings.clusterCount = std::strtoull(value.c_str(), nullptr, 10);
+			}
+			else if (arg == "--cluster-spread") {
+				outSettings.clusterSpread = std::atof(value.c_str());
+			}
+			else if (arg == "--jitter") {
+				outSettings.gridJitter = std::atof(value.c_str());
+			}
+			else if (arg == "--roads") {
+				outSettings.roadCount = std::strtoull(value.c_str(), nullptr, 10);
+			}
+			else if (arg == "--road-spread") {
+				outSettings.roadSpread = std::atof(value.c_str());
+			}
+			else {
+				return false;
+			}
+		}
+
+		return !outFileName.empty() && outSettings.size > 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	GeneratorSettings settings;
+	std::string fileName;
+	if (!parseOptions(argc, argv, settings, fileName)) {
+		std::fprintf(stderr, "Usage: GenerateInstance --output file [--distribution uniform|clustered|grid|road] [--count n] [--seed n] [--size x] "
+		                     "[--clusters n] [--cluster-spread x] [--jitter x] [--roads n] [--road-spread x]\n");
+		return EXIT_FAILURE;
+	}
+
+	using namespace std::chrono;
+	auto begin = high_resolution_clock::now();
+	PointList points = generateInstance(settings);
+	auto generated = high_resolution_clock::now();
+
+	bool saved = endsWith(fileName, ".tsp") 
+		? saveTsplib(fileName, points, fileName) 
+		: saveBinaryInstance(fileName, points);
+	if (!saved) {
+		std::fprintf(stderr, "Could not write %s\n", fileName.c_str());
+		return EXIT_FAILURE;
+	}
+	auto written = high_resolution_clock::now();
+
+	std::fprintf(stderr, "Generated %zu nodes in %.2fs, wrote them in %.2fs\n", points.size(),
+	             duration_cast<milliseconds>(generated - begin).count() / 1000.0,
+	             duration_cast<milliseconds>(written - generated).count() / 1000.0);
+	return EXIT_SUCCESS;
+}
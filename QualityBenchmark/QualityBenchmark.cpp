@@ -0,0 +1,509 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Solution quality regression benchmark.
+//                Runs every solver mode over a corpus of instances with known
+//                optimal (or best known) tour lengths, records how long each
+//                takes to reach a set of target gaps and the gap reached at
+//                fixed time budgets, then compares the results against a
+//                stored baseline. Exits with a failure code if quality or 
+//                speed regressed beyond a tolerance.
+//                On Linux, each run's hardware counters are also printed, 
+//                but never compared, since they depend on the machine.
+//                With --checkpoint, the run in progress is checkpointed
+//                every few seconds (5 by default), so it can be loaded in
+//                the app after a crash. Snapshots are taken on the solver
+//                thread, so such timings should not be used as a baseline.
+//                Usage: QualityBenchmark [--corpus dir] [--baseline file]
+//                                        [--write-baseline file] 
+//                                        [--curves file] [--modes a,b,...]
+//                                        [--budgets s1,s2,...] [--seed n]
+//                                        [--runs n]
+//                                        [--gap-tolerance x]
+//                                        [--time-tolerance x]
+//                                        [--trace file] [--history file]
+//                                        [--checkpoint file[,seconds]]
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "PathFinder.h"
+#include "Instance.h"
+#include "Tracing.h"
+#include "BatchDistances.h"
+
+namespace {
+	struct ModeInfo {
+		const char* key;
+		PathFinder::Mode mode;
+	};
+
+	const ModeInfo s_kModes[] = {
+		{ "hillclimbing", PathFinder::HillClimbing },
+		{ "annealing", PathFinder::Anealing },
+		{ "genetic", PathFinder::Genetic },
+		{ "ils", PathFinder::IteratedLocalSearch },
+		{ "portfolio", PathFinder::Portfolio },
+		{ "aco", PathFinder::AntColonyOptimization },
+		{ "tabu", PathFinder::Tabu },
+		{ "gls", PathFinder::GuidedLocalSearch },
+		{ "lahc", PathFinder::LateAcceptance },
+		{ "rrt", PathFinder::RecordToRecord },
+		{ "ta", PathFinder::ThresholdAccepting },
+		{ "multilevel", PathFinder::Multilevel },
+		{ "partitioned", PathFinder::Partitioned },
+	};
+
+	// Gaps to the reference length that time-to-target is measured for.
+	const double s_kTargetGaps[] = { 0.10, 0.05, 0.02, 0.01 };
+
+	// Time-to-target results within this many seconds of the baseline are 
+	// never reported, since they are dominated by the polling interval and 
+	// scheduling noise.
+	const double s_kTimeSlack = 0.1;
+
+	const std::chrono::milliseconds s_kPollInterval{ 10 };
+
+	// Gaps this far below zero are floating point error in the tour length
+	// or the rounding of the reference, and are reported as zero.
+	const double s_kGapRoundOff = 1e-6;
+
+	struct Options {
+		std::string corpusDir = "Corpus";
+		std::string baselineFile;
+		std::string writeBaselineFile;
+		std::string curvesFile;
+		std::vector<std::string> modes;
+		std::vector<double> budgets = { 0.5, 1, 2 };
+		unsigned seed = 12345;
+		size_t runs = 3;
+		double gapTolerance = 0.1;
+		double timeTolerance = 0.5;
+		std::string traceFile;
+		std::string historyFile;
+		std::string checkpointFile;
+		unsigned long checkpointSeconds = 5;
+	};
+
+	struct Instance {
+		std::string name;
+		PointList points;
+		double referenceLength;
+	};
+
+	// Results are stored as (instance, mode, metric) -> value, which is also 
+	// the row layout of the baseline file.
+	typedef std::map<std::string, double> Results;
+
+	// Values of each result over several runs.
+	typedef std::map<std::string, std::vector<double>> Samples;
+
+	std::string makeKey(const std::string& instance, const std::string& mode, const std::string& metric)
+	{
+		return instance + "," + mode + "," + metric;
+	}
+
+	std::string budgetMetric(double budget)
+	{
+		std::ostringstream metric;
+		metric << "gap@" << budget << "s";
+		return metric.str();
+	}
+
+	std::string targetMetric(double targetGap)
+	{
+		std::ostringstream metric;
+		metric << "ttt@" << targetGap * 100 << "%";
+		return metric.str();
+	}
+
+	std::vector<std::string> split(const std::string& str, char delimiter)
+	{
+		std::vector<std::string> parts;
+		std::istringstream stream(str);
+		std::string part;
+		while (std::getline(stream, part, delimiter)) {
+			if (!part.empty())
+				parts.push_back(part);
+		}
+		return parts;
+	}
+
+	bool loadCorpus(const std::string& corpusDir, std::vector<Instance>& outInstances)
+	{
+		std::ifstream manifest(corpusDir + "/corpus.txt");
+		if (!manifest) {
+			std::fprintf(stderr, "Could not open %s/corpus.txt\n", corpusDir.c_str());
+			return false;
+		}
+
+		std::string line;
+		while (std::getline(manifest, line)) {
+			if (line.empty() || line[0] == '#')
+				continue;
+
+			Instance instance;
+			std::string fileName, referenceKind;
+			std::istringstream fields(line);
+			if (!(fields >> instance.name >> fileName >> instance.referenceLength >> referenceKind)) {
+				std::fprintf(stderr, "Malformed corpus line: %s\n", line.c_str());
+				return false;
+			}
+			if (!loadInstance(corpusDir + "/" + fileName, instance.points)) {
+				std::fprintf(stderr, "Could not load %s\n", fileName.c_str());
+				return false;
+			}
+			outInstances.push_back(std::move(instance));
+		}
+
+		return !outInstances.empty();
+	}
+
+	bool loadResults(const std::string& fileName, Results& outResults)
+	{
+		std::ifstream file(fileName);
+		if (!file)
+			return false;
+
+		std::string line;
+		std::getline(file, line); // Header
+		while (std::getline(file, line)) {
+			size_t lastComma = line.rfind(',');
+			if (lastComma == std::string::npos)
+				return false;
+			outResults[line.substr(0, lastComma)] = std::atof(line.c_str() + lastComma + 1);
+		}
+
+		return true;
+	}
+
+	bool saveResults(const std::string& fileName, const Results& results)
+	{
+		std::ofstream file(fileName);
+		if (!file)
+			return false;
+
+		file << "instance,mode,metric,value\n";
+		for (const auto& result : results)
+			file << result.first << "," << result.second << "\n";
+		return static_cast<bool>(file);
+	}
+
+	// Returns the median of each result. Unreached targets (-1) count as 
+	// slower than any reached one.
+	Results takeMedians(Samples& samples)
+	{
+		Results results;
+		for (auto& sample : samples) {
+			std::vector<double>& values = sample.second;
+			bool isTimeToTarget = sample.first.find(",ttt@") != std::string::npos;
+			if (isTimeToTarget) {
+				for (double& value : values) {
+					if (value < 0)
+						value = std::numeric_limits<double>::infinity();
+				}
+			}
+			std::sort(values.begin(), values.end());
+			double median = values.at(values.size() / 2);
+			results[sample.first] = std::isinf(median) ? -1 : median;
+		}
+		return results;
+	}
+
+	// Prints a run's instructions per cycle and misses per thousand 
+	// instructions, if the counters are available. Runs whose helper 
+	// threads were not counted are labelled as solver thread only.
+	void printHardwareCounters(const HardwareCounterValues& counters, unsigned seed)
+	{
+		uint64_t instructions = counters.values[HardwareCounterValues::Instructions];
+		if (!counters.available[HardwareCounterValues::Instructions] || instructions == 0)
+			return;
+
+		std::string text = "  seed " + std::to_string(seed) + ": ";
+		char value[64];
+		std::snprintf(value, sizeof(value), "%.3f instructions per cycle", counters.getInstructionsPerCycle());
+		text += value;
+		for (size_t counter = HardwareCounterValues::CacheMisses; counter < HardwareCounterValues::CounterCount; ++counter) {
+			if (!counters.available[counter])
+				continue;
+			std::snprintf(value, sizeof(value), ", %.2f ", 1000.0 * counters.values[counter] / instructions);
+			text += value + HardwareCounterValues::getCounterName(static_cast<HardwareCounterValues::Counter>(counter)) + " per 1000 instructions";
+		}
+		if (counters.solverThreadOnly)
+			text += " (solver thread only)";
+		std::fprintf(stderr, "%s\n", text.c_str());
+	}
+
+	// Runs one solver mode on an instance for the longest budget, sampling 
+	// the tour length as it goes. Unreached targets are recorded as -1.
+	void runInstance(const Instance& instance, const ModeInfo& mode, unsigned seed, const Options& options, Samples& samples, std::ostream* curves, std::ostream* history)
+	{
+		PathFinder pathFinder;
+		pathFinder.setNodes(instance.points);
+		pathFinder.setMode(mode.mode);
+		pathFinder.setSeed(seed);
+
+		// Start from a shuffled tour, since the corpus files of structured
+		// instances list the nodes in (near) optimal order. The shuffle is
+		// written out so it gives the same tour with every standard library.
+		std::vector<size_t> path(instance.points.size());
+		for (size_t i = 0; i < path.size(); ++i)
+			path.at(i) = i;
+		std::mt19937 generator(seed);
+		for (size_t i = path.size() - 1; i > 0; --i)
+			std::swap(path.at(i), path.at(generator() % (i + 1)));
+		pathFinder.setPath(path);
+		if (!options.checkpointFile.empty())
+			pathFinder.setCheckpointFile(options.checkpointFile, std::chrono::seconds(options.checkpointSeconds));
+
+		const size_t kTargetCount = sizeof(s_kTargetGaps) / sizeof(s_kTargetGaps[0]);
+		std::vector<double> timeToTarget(kTargetCount, -1);
+		std::vector<double> budgetGaps(options.budgets.size(), -1);
+		double maxBudget = *std::max_element(options.budgets.begin(), options.budgets.end());
+		double lastGap = std::numeric_limits<double>::infinity();
+
+		using namespace std::chrono;
+		auto begin = high_resolution_clock::now();
+		pathFinder.calculatePathAsync();
+		double elapsed = 0;
+		while (true) {
+			elapsed = duration_cast<microseconds>(high_resolution_clock::now() - begin).count() / 1000000.0;
+			double gap = pathFinder.getPathLength() / instance.referenceLength - 1;
+			if (gap < 0 && gap > -s_kGapRoundOff)
+				gap = 0;
+
+			for (size_t i = 0; i < kTargetCount; ++i) {
+				if (timeToTarget.at(i) < 0 && gap <= s_kTargetGaps[i])
+					timeToTarget.at(i) = elapsed;
+			}
+			for (size_t i = 0; i < options.budgets.size(); ++i) {
+				if (elapsed <= options.budgets.at(i))
+					budgetGaps.at(i) = gap;
+			}
+			if (curves && gap < lastGap)
+				*curves << instance.name << "," << mode.key << "," << seed << "," << elapsed << "," << gap << "\n";
+			lastGap = gap;
+
+			if (elapsed >= maxBudget)
+				break;
+			std::this_thread::sleep_for(s_kPollInterval);
+		}
+		pathFinder.stop();
+		printHardwareCounters(pathFinder.getHardwareCounters(), seed);
+
+		if (history) {
+			for (const ConvergenceSample& sample : pathFinder.getConvergenceHistory()) {
+				*history << instance.name << "," << mode.key << "," << seed << "," << sample.seconds << "," << sample.bestPathLength << "," 
+				         << sample.pathLength << "," << sample.temperature << "," << sample.acceptanceRate << "\n";
+			}
+		}
+
+		for (size_t i = 0; i < kTargetCount; ++i)
+			samples[makeKey(instance.name, mode.key, targetMetric(s_kTargetGaps[i]))].push_back(timeToTarget.at(i));
+		for (size_t i = 0; i < options.budgets.size(); ++i)
+			samples[makeKey(instance.name, mode.key, budgetMetric(options.budgets.at(i)))].push_back(budgetGaps.at(i));
+	}
+
+	// Reports every result that is worse than the baseline by more than the
+	// tolerances. Returns the number of regressions.
+	size_t compareResults(const Results& results, const Results& baseline, const Options& options)
+	{
+		size_t regressionCount = 0;
+		for (const auto& result : results) {
+			auto baselineIt = baseline.find(result.first);
+			if (baselineIt == baseline.end())
+				continue;
+
+			double value = result.second;
+			double baselineValue = baselineIt->second;
+			bool isTimeToTarget = result.first.find(",ttt@") != std::string::npos;
+			bool regressed;
+			if (isTimeToTarget) {
+				// A target the baseline never reached cannot regress
+				regressed = baselineValue >= 0 && 
+				            (value < 0 || value > baselineValue * (1 + options.timeTolerance) + s_kTimeSlack);
+			}
+			else {
+				// Compare tour lengths rather than gaps, so the tolerance means
+				// the same for solvers far from and close to the optimum
+				regressed = (1 + value) / (1 + baselineValue) - 1 > options.gapTolerance;
+			}
+
+			if (regressed) {
+				std::fprintf(stderr, "REGRESSION %s: %g (baseline %g)\n", result.first.c_str(), value, baselineValue);
+				++regressionCount;
+			}
+		}
+
+		return regressionCount;
+	}
+
+	bool parseOptions(int argc, char** argv, Options& outOptions)
+	{
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			if (i + 1 >= argc)
+				return false;
+			std::string value = argv[++i];
+			if (arg == "--corpus") {
+				outOptions.corpusDir = value;
+			}
+			else if (arg == "--baseline") {
+				outOptions.baselineFile = value;
+			}
+			else if (arg == "--write-baseline") {
+				outOptions.writeBaselineFile = value;
+			}
+			else if (arg == "--curves") {
+				outOptions.curvesFile = value;
+			}
+			else if (arg == "--modes") {
+				outOptions.modes = split(value, ',');
+			}
+			else if (arg == "--budgets") {
+				outOptions.budgets.clear();
+				for (const std::string& budget : split(value, ','))
+					outOptions.budgets.push_back(std::atof(budget.c_str()));
+				if (outOptions.budgets.empty())
+					return false;
+			}
+			else if (arg == "--seed") {
+				outOptions.seed = static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+			}
+			else if (arg == "--runs") {
+				outOptions.runs = std::strtoul(value.c_str(), nullptr, 10);
+				if (outOptions.runs == 0)
+					return false;
+			}
+			else if (arg == "--gap-tolerance") {
+				outOptions.gapTolerance = std::atof(value.c_str());
+			}
+			else if (arg == "--time-tolerance") {
+				outOptions.timeTolerance = std::atof(value.c_str());
+			}
+			else if (arg == "--trace") {
+				outOptions.traceFile = value;
+			}
+			else if (arg == "--history") {
+				outOptions.historyFile = value;
+			}
+			else if (arg == "--checkpoint") {
+				size_t comma = value.rfind(',');
+				outOptions.checkpointFile = value.substr(0, comma);
+				if (comma != std::string::npos)
+					outOptions.checkpointSeconds = std::strtoul(value.c_str() + comma + 1, nullptr, 10);
+				if (outOptions.checkpointFile.empty() || outOptions.checkpointSeconds == 0)
+					return false;
+			}
+			else {
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!parseOptions(argc, argv, options)) {
+		std::fprintf(stderr, "Usage: QualityBenchmark [--corpus dir] [--baseline file] [--write-baseline file] [--curves file] "
+		                     "[--modes a,b,...] [--budgets s1,s2,...] [--seed n] [--runs n] [--gap-tolerance x] [--time-tolerance x] [--trace file] [--history file] "
+		                     "[--checkpoint file[,seconds]]\n");
+		return EXIT_FAILURE;
+	}
+
+	std::vector<Instance> instances;
+	if (!loadCorpus(options.corpusDir, instances))
+		return EXIT_FAILURE;
+
+	std::ofstream curvesFile;
+	if (!options.curvesFile.empty()) {
+		curvesFile.open(options.curvesFile);
+		curvesFile << "instance,mode,seed,seconds,gap\n";
+	}
+
+	std::ofstream historyFile;
+	if (!options.historyFile.empty()) {
+		historyFile.open(options.historyFile);
+		historyFile << "instance,mode,seed,seconds,best_length,length,temperature,acceptance_rate\n";
+	}
+
+	if (!options.traceFile.empty())
+		startTracing();
+
+	// Timings are only comparable between machines taking the same path
+	std::fprintf(stderr, "Move evaluation: %s\n", isAvx2Enabled() ? "AVX2" : "scalar");
+
+	// Each run uses its own seed, and the median over the runs is reported
+	// to smooth out scheduling noise
+	Samples samples;
+	for (const Instance& instance : instances) {
+		for (const ModeInfo& mode : s_kModes) {
+			if (!options.modes.empty() && std::find(options.modes.begin(), options.modes.end(), mode.key) == options.modes.end())
+				continue;
+
+			std::fprintf(stderr, "Running %s on %s\n", mode.key, instance.name.c_str());
+			for (size_t run = 0; run < options.runs; ++run) {
+				unsigned seed = options.seed + static_cast<unsigned>(run);
+				runInstance(instance, mode, seed, options, samples, curvesFile.is_open() ? &curvesFile : nullptr, historyFile.is_open() ? &historyFile : nullptr);
+			}
+		}
+	}
+	Results results = takeMedians(samples);
+
+	if (!options.traceFile.empty()) {
+		stopTracing();
+		if (!writeTrace(options.traceFile)) {
+			std::fprintf(stderr, "Could not write %s\n", options.traceFile.c_str());
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::printf("instance,mode,metric,value\n");
+	for (const auto& result : results)
+		std::printf("%s,%g\n", result.first.c_str(), result.second);
+
+	if (!options.writeBaselineFile.empty() && !saveResults(options.writeBaselineFile, results)) {
+		std::fprintf(stderr, "Could not write %s\n", options.writeBaselineFile.c_str());
+		return EXIT_FAILURE;
+	}
+
+	if (!options.baselineFile.empty()) {
+		Results baseline;
+		if (!loadResults(options.baselineFile, baseline)) {
+			std::fprintf(stderr, "Could not read %s\n", options.baselineFile.c_str());
+			return EXIT_FAILURE;
+		}
+
+		size_t regressionCount = compareResults(results, baseline, options);
+		if (regressionCount > 0) {
+			std::fprintf(stderr, "%zu regression(s) against %s\n", regressionCount, options.baselineFile.c_str());
+			return EXIT_FAILURE;
+		}
+		std::fprintf(stderr, "No regressions against %s\n", options.baselineFile.c_str());
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,497 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : MAX-MIN Ant System, using Ant Colony System's pseudo-random
+//                proportional rule to pick each ant's next city.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <string>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#include <xmmintrin.h>
+#define ANT_COLONY_SSE
+#endif
+
+#include "AntColony.h"
+#include "ArrayTour.h"
+#include "TwoLevelList.h"
+#include "LocalSearch.h"
+#include "Tracing.h"
+
+const size_t AntColony::s_kMaxDenseNodeCount = 2048;
+const size_t AntColony::s_kNoTrail = std::numeric_limits<size_t>::max();
+
+namespace {
+	const size_t s_kAntCount = 16;
+
+	// Fraction of every trail left after each iteration.
+	const float s_kPersistence = 0.98f;
+
+	// Chance of taking the most desirable candidate rather than sampling one
+	// in proportion to desirability.
+	const double s_kExploitationProbability = 0.9;
+
+	// The global best tour deposits instead of the iteration best tour
+	// once every this many iterations.
+	const size_t s_kGlobalBestInterval = 5;
+
+	// Iterations without a new best tour after which all trails are reset.
+	const size_t s_kStagnationIterations = 250;
+
+	// Node count at which ants' tours are improved on a TwoLevelList rather
+	// than an ArrayTour. Matches the solver's threshold.
+	const size_t s_kTwoLevelListThreshold = 5000;
+
+	// Cities an ant adds to its tour between checks of the stop flag.
+	const size_t s_kStopCheckInterval = 256;
+
+	// Desirability of an edge of the given length, the inverse square of
+	// its length. Coincident cities are treated as very close instead.
+	float getHeuristic(double distance)
+	{
+		double clamped = std::max(distance, 1e-6);
+		return static_cast<float>(1 / (clamped * clamped));
+	}
+}
+
+AntColony::AntColony(const PointList& points, const NeighbourLists& neighbours, const std::vector<size_t>& path,
+                     double pathLength, size_t threadCount, std::mt19937& randomGenerator)
+	: m_points{ points }
+	, m_neighbours{ neighbours }
+	, m_nodeCount{ points.size() }
+	, m_candidateCount{ neighbours.getNeighbourCount() }
+	, m_dense{ points.size() <= s_kMaxDenseNodeCount }
+	, m_cellSize{ 1 }
+	, m_gridCols{ 0 }
+	, m_gridRows{ 0 }
+	, m_trailMin{ 0 }
+	, m_trailMax{ 0 }
+	, m_bestPath{ path }
+	, m_bestPathLength{ pathLength }
+	, m_iteration{ 0 }
+	, m_iterationsSinceImprovement{ 0 }
+	, m_localSearch{ true }
+	, m_batch{ 0 }
+	, m_busyThreads{ 0 }
+	, m_shuttingDown{ false }
+	, m_nextAnt{ 0 }
+	, m_stopped{ nullptr }
+{
+	m_candidateHeuristics.resize(m_nodeCount * m_candidateCount);
+	for (size_t city = 0; city < m_nodeCount; ++city) {
+		const size_t* candidates = m_neighbours.getNeighbours(city);
+		for (size_t i = 0; i < m_candidateCount; ++i)
+			m_candidateHeuristics[city * m_candidateCount + i] = getHeuristic(euclideanDist(m_points, city, candidates[i]));
+	}
+
+	if (!m_dense)
+		buildGrid();
+
+	m_trails.resize(m_dense ? m_nodeCount * m_nodeCount : m_nodeCount * m_candidateCount);
+	updateTrailLimits(true);
+
+	m_ants.resize(s_kAntCount);
+	for (Ant& ant : m_ants) {
+		ant.randomGenerator.seed(randomGenerator());
+		ant.path.reserve(m_nodeCount);
+		ant.pathLength = 0;
+	}
+
+	threadCount = std::max<size_t>(std::min(threadCount, s_kAntCount), 1);
+	m_workers.resize(threadCount);
+	for (Worker& worker : m_workers) {
+		worker.visited.resize(m_nodeCount);
+		worker.unvisited.resize(m_nodeCount);
+		worker.unvisitedPositions.resize(m_nodeCount);
+		if (!m_dense) {
+			worker.cellCities.resize(m_nodeCount);
+			worker.cellCounts.resize(m_gridCols * m_gridRows);
+			worker.cellPositions.resize(m_nodeCount);
+		}
+	}
+	for (size_t i = 1; i < threadCount; ++i)
+		m_threads.emplace_back(&AntColony::workerLoop, this, i);
+}
+
+AntColony::~AntColony()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_poolMutex);
+		m_shuttingDown = true;
+	}
+	m_batchStarted.notify_all();
+	for (std::thread& thread : m_threads)
+		thread.join();
+}
+
+bool AntColony::iterate(const std::atomic<bool>* stopped)
+{
+	// Hand the ants out to the pool, and work on them from this thread too
+	m_stopped = stopped;
+	m_nextAnt = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_poolMutex);
+		++m_batch;
+		m_busyThreads = m_threads.size();
+	}
+	m_batchStarted.notify_all();
+	runAnts(m_workers.front());
+	{
+		std::unique_lock<std::mutex> lock(m_poolMutex);
+		m_batchFinished.wait(lock, [this]() { return m_busyThreads == 0; });
+	}
+
+	const Ant* iterationBest = &m_ants.front();
+	for (const Ant& ant : m_ants) {
+		if (ant.pathLength < iterationBest->pathLength)
+			iterationBest = &ant;
+	}
+
+	// Every ant was stopped before finishing its tour
+	if (iterationBest->pathLength == std::numeric_limits<double>::infinity())
+		return false;
+
+	bool improved = iterationBest->pathLength < m_bestPathLength;
+	if (improved) {
+		m_bestPath = iterationBest->path;
+		m_bestPathLength = iterationBest->pathLength;
+		m_iterationsSinceImprovement = 0;
+		updateTrailLimits(false);
+	}
+	else {
+		++m_iterationsSinceImprovement;
+	}
+
+	// Mostly reinforce the iteration best tour, which keeps the search
+	// broader than always reinforcing the global best
+	{
+		TRACE_SCOPE("Update Pheromone");
+		evaporate();
+		if (m_iteration % s_kGlobalBestInterval == 0)
+			deposit(m_bestPath, m_bestPathLength);
+		else
+			deposit(iterationBest->path, iterationBest->pathLength);
+	}
+
+	if (m_iterationsSinceImprovement >= s_kStagnationIterations) {
+		updateTrailLimits(true);
+		m_iterationsSinceImprovement = 0;
+	}
+
+	++m_iteration;
+	return improved;
+}
+
+void AntColony::setBestTour(const std::vector<size_t>& path, double pathLength)
+{
+	m_bestPath = path;
+	m_bestPathLength = pathLength;
+	m_iterationsSinceImprovement = 0;
+	updateTrailLimits(true);
+	deposit(m_bestPath, m_bestPathLength);
+}
+
+void AntColony::runAnts(Worker& worker)
+{
+	for (size_t antIdx = m_nextAnt++; antIdx < m_ants.size(); antIdx = m_nextAnt++) {
+		Ant& ant = m_ants[antIdx];
+		{
+			TRACE_SCOPE("Build Ant Tour");
+			buildTour(ant, worker);
+		}
+
+		if (m_localSearch && !(m_stopped && *m_stopped)) {
+			TRACE_SCOPE("Local Search");
+			if (m_nodeCount >= s_kTwoLevelListThreshold)
+				improveTour<TwoLevelList>(ant);
+			else
+				improveTour<ArrayTour>(ant);
+		}
+	}
+}
+
+void AntColony::buildTour(Ant& ant, Worker& worker)
+{
+	std::fill(worker.visited.begin(), worker.visited.end(), 0);
+	std::iota(worker.unvisited.begin(), worker.unvisited.end(), static_cast<size_t>(0));
+	std::iota(worker.unvisitedPositions.begin(), worker.unvisitedPositions.end(), static_cast<size_t>(0));
+	if (!m_dense) {
+		worker.cellCities = m_cellCities;
+		worker.cellPositions = m_cityCellPositions;
+		for (size_t cell = 0; cell < worker.cellCounts.size(); ++cell)
+			worker.cellCounts[cell] = m_cellStarts[cell + 1] - m_cellStarts[cell];
+	}
+	size_t unvisitedCount = m_nodeCount;
+	auto visit = [this, &worker, &unvisitedCount](size_t city) {
+		worker.visited[city] = 1;
+		size_t pos = worker.unvisitedPositions[city];
+		size_t last = worker.unvisited[--unvisitedCount];
+		worker.unvisited[pos] = last;
+		worker.unvisitedPositions[last] = pos;
+
+		if (!m_dense) {
+			size_t cell = m_cityCells[city];
+			size_t cellPos = worker.cellPositions[city];
+			size_t cellLast = worker.cellCities[m_cellStarts[cell] + --worker.cellCounts[cell]];
+			worker.cellCities[cellPos] = cellLast;
+			worker.cellPositions[cellLast] = cellPos;
+		}
+	};
+
+	std::uniform_real_distribution<double> realDist;
+	std::uniform_int_distribution<size_t> cityDist(0, m_nodeCount - 1);
+	size_t city = cityDist(ant.randomGenerator);
+	ant.path.clear();
+	ant.path.push_back(city);
+	ant.pathLength = 0;
+	visit(city);
+
+	float weights[64];
+	size_t candidateCount = std::min<size_t>(m_candidateCount, 64);
+	while (unvisitedCount > 0) {
+		if (unvisitedCount % s_kStopCheckInterval == 0 && m_stopped && *m_stopped) {
+			ant.pathLength = std::numeric_limits<double>::infinity();
+			return;
+		}
+
+		// Weigh the unvisited candidates by trail and heuristic
+		const size_t* candidates = m_neighbours.getNeighbours(city);
+		const float* heuristics = m_candidateHeuristics.data() + city * m_candidateCount;
+		float totalWeight = 0;
+		size_t bestIdx = s_kNoTrail;
+		for (size_t i = 0; i < candidateCount; ++i) {
+			weights[i] = worker.visited[candidates[i]] ? 0 : m_trails[getCandidateTrailIdx(city, i)] * heuristics[i];
+			totalWeight += weights[i];
+			if (weights[i] > 0 && (bestIdx == s_kNoTrail || weights[i] > weights[bestIdx]))
+				bestIdx = i;
+		}
+
+		size_t next;
+		if (bestIdx == s_kNoTrail) {
+			next = m_dense ? pickFallback(city, worker, unvisitedCount) : findNearestUnvisited(city, worker);
+		}
+		else if (realDist(ant.randomGenerator) < s_kExploitationProbability) {
+			next = candidates[bestIdx];
+		}
+		else {
+			float target = static_cast<float>(realDist(ant.randomGenerator)) * totalWeight;
+			next = candidates[bestIdx];
+			for (size_t i = 0; i < candidateCount; ++i) {
+				if (weights[i] <= 0)
+					continue;
+				target -= weights[i];
+				if (target <= 0) {
+					next = candidates[i];
+					break;
+				}
+			}
+		}
+
+		ant.pathLength += euclideanDist(m_points, city, next);
+		ant.path.push_back(next);
+		visit(next);
+		city = next;
+	}
+	ant.pathLength += euclideanDist(m_points, city, ant.path.front());
+}
+
+template <typename TourT>
+void AntColony::improveTour(Ant& ant)
+{
+	TourT tour(ant.path);
+	LocalSearch<TourT> localSearch(tour, m_points, m_neighbours);
+	localSearch.pushAll();
+	ant.pathLength += localSearch.optimize(m_stopped);
+	tour.getOrder(ant.path);
+}
+
+size_t AntColony::pickFallback(size_t city, const Worker& worker, size_t unvisitedCount) const
+{
+	// Every candidate is visited. Dense trails know about every edge, so
+	// take the most desirable city
+	size_t bestCity = worker.unvisited.front();
+	double bestScore = -std::numeric_limits<double>::infinity();
+	for (size_t i = 0; i < unvisitedCount; ++i) {
+		size_t other = worker.unvisited[i];
+		double distance = euclideanDist(m_points, city, other);
+		double score = m_trails[city * m_nodeCount + other] * getHeuristic(distance);
+		if (score > bestScore) {
+			bestScore = score;
+			bestCity = other;
+		}
+	}
+	return bestCity;
+}
+
+size_t AntColony::findNearestUnvisited(size_t city, const Worker& worker) const
+{
+	// Search outwards ring by ring until no closer city can exist
+	const Eigen::Vector2d& from = m_points[city];
+	size_t col = m_cityCells[city] % m_gridCols;
+	size_t row = m_cityCells[city] / m_gridCols;
+	size_t bestCity = s_kNoTrail;
+	double bestDistSquared = std::numeric_limits<double>::infinity();
+	size_t maxRing = std::max(m_gridCols, m_gridRows);
+	for (size_t ring = 0; ring <= maxRing; ++ring) {
+		ptrdiff_t r = static_cast<ptrdiff_t>(ring);
+		for (ptrdiff_t dy = -r; dy <= r; ++dy) {
+			ptrdiff_t y = static_cast<ptrdiff_t>(row) + dy;
+			if (y < 0 || y >= static_cast<ptrdiff_t>(m_gridRows))
+				continue;
+
+			// Only visit the border of the ring
+			ptrdiff_t step = (dy == -r || dy == r) ? 1 : std::max(static_cast<ptrdiff_t>(1), 2 * r);
+			for (ptrdiff_t dx = -r; dx <= r; dx += step) {
+				ptrdiff_t x = static_cast<ptrdiff_t>(col) + dx;
+				if (x < 0 || x >= static_cast<ptrdiff_t>(m_gridCols))
+					continue;
+
+				size_t cell = static_cast<size_t>(y) * m_gridCols + static_cast<size_t>(x);
+				const size_t* cities = worker.cellCities.data() + m_cellStarts[cell];
+				for (size_t i = 0; i < worker.cellCounts[cell]; ++i) {
+					double distSquared = euclideanDistSquared(from, m_points[cities[i]]);
+					if (distSquared < bestDistSquared) {
+						bestDistSquared = distSquared;
+						bestCity = cities[i];
+					}
+				}
+			}
+		}
+
+		// Anything outside this ring is at least ring * m_cellSize away
+		double ringDist = ring * m_cellSize;
+		if (bestCity != s_kNoTrail && ringDist * ringDist >= bestDistSquared)
+			break;
+	}
+	return bestCity;
+}
+
+void AntColony::buildGrid()
+{
+	Eigen::Vector2d minPos = m_points[0];
+	Eigen::Vector2d maxPos = m_points[0];
+	for (const Eigen::Vector2d& point : m_points) {
+		minPos = minPos.cwiseMin(point);
+		maxPos = maxPos.cwiseMax(point);
+	}
+	Eigen::Vector2d extent = maxPos - minPos;
+	double area = std::max(extent.x() * extent.y(), extent.maxCoeff() * extent.maxCoeff() / m_nodeCount);
+	m_cellSize = std::sqrt(area * 2 / m_nodeCount);
+	if (m_cellSize <= 0)
+		m_cellSize = 1;
+	m_gridCols = static_cast<size_t>(extent.x() / m_cellSize) + 1;
+	m_gridRows = static_cast<size_t>(extent.y() / m_cellSize) + 1;
+
+	m_cityCells.resize(m_nodeCount);
+	m_cellStarts.assign(m_gridCols * m_gridRows + 1, 0);
+	for (size_t city = 0; city < m_nodeCount; ++city) {
+		size_t col = std::min(m_gridCols - 1, static_cast<size_t>((m_points[city].x() - minPos.x()) / m_cellSize));
+		size_t row = std::min(m_gridRows - 1, static_cast<size_t>((m_points[city].y() - minPos.y()) / m_cellSize));
+		m_cityCells[city] = row * m_gridCols + col;
+		++m_cellStarts[m_cityCells[city] + 1];
+	}
+	for (size_t i = 1; i < m_cellStarts.size(); ++i)
+		m_cellStarts[i] += m_cellStarts[i - 1];
+
+	std::vector<size_t> cellFill(m_cellStarts.begin(), m_cellStarts.end() - 1);
+	m_cellCities.resize(m_nodeCount);
+	m_cityCellPositions.resize(m_nodeCount);
+	for (size_t city = 0; city < m_nodeCount; ++city) {
+		size_t pos = cellFill[m_cityCells[city]]++;
+		m_cellCities[pos] = city;
+		m_cityCellPositions[city] = pos;
+	}
+}
+
+size_t AntColony::getTrailIdx(size_t from, size_t to) const
+{
+	if (m_dense)
+		return from * m_nodeCount + to;
+
+	const size_t* candidates = m_neighbours.getNeighbours(from);
+	for (size_t i = 0; i < m_candidateCount; ++i) {
+		if (candidates[i] == to)
+			return from * m_candidateCount + i;
+	}
+	return s_kNoTrail;
+}
+
+size_t AntColony::getCandidateTrailIdx(size_t from, size_t candidateIdx) const
+{
+	if (m_dense)
+		return from * m_nodeCount + m_neighbours.getNeighbours(from)[candidateIdx];
+	return from * m_candidateCount + candidateIdx;
+}
+
+void AntColony::evaporate()
+{
+	// Trails never exceed the maximum, so only the minimum needs clamping
+	float* trails = m_trails.data();
+	size_t count = m_trails.size();
+	size_t i = 0;
+#ifdef ANT_COLONY_SSE
+	__m128 persistence = _mm_set1_ps(s_kPersistence);
+	__m128 trailMin = _mm_set1_ps(m_trailMin);
+	for (; i + 4 <= count; i += 4) {
+		__m128 trail = _mm_loadu_ps(trails + i);
+		_mm_storeu_ps(trails + i, _mm_max_ps(_mm_mul_ps(trail, persistence), trailMin));
+	}
+#endif
+	for (; i < count; ++i)
+		trails[i] = std::max(trails[i] * s_kPersistence, m_trailMin);
+}
+
+void AntColony::deposit(const std::vector<size_t>& path, double pathLength)
+{
+	float amount = static_cast<float>(1 / pathLength);
+	for (size_t i = 0; i < path.size(); ++i) {
+		size_t from = path[i];
+		size_t to = path[i + 1 == path.size() ? 0 : i + 1];
+		size_t forwardIdx = getTrailIdx(from, to);
+		if (forwardIdx != s_kNoTrail)
+			m_trails[forwardIdx] = std::min(m_trails[forwardIdx] + amount, m_trailMax);
+		size_t backwardIdx = getTrailIdx(to, from);
+		if (backwardIdx != s_kNoTrail)
+			m_trails[backwardIdx] = std::min(m_trails[backwardIdx] + amount, m_trailMax);
+	}
+}
+
+void AntColony::updateTrailLimits(bool resetTrails)
+{
+	m_trailMax = static_cast<float>(1 / ((1 - s_kPersistence) * std::max(m_bestPathLength, 1e-9)));
+	m_trailMin = m_trailMax / (2 * std::max<size_t>(m_nodeCount, 1));
+	if (resetTrails)
+		std::fill(m_trails.begin(), m_trails.end(), m_trailMax);
+}
+
+void AntColony::workerLoop(size_t workerIdx)
+{
+	setTraceThreadName("Ant Worker " + std::to_string(workerIdx));
+
+	uint64_t seenBatch = 0;
+	std::unique_lock<std::mutex> lock(m_poolMutex);
+	while (true) {
+		m_batchStarted.wait(lock, [this, seenBatch]() { return m_shuttingDown || m_batch != seenBatch; });
+		if (m_shuttingDown)
+			return;
+		seenBatch = m_batch;
+
+		lock.unlock();
+		runAnts(m_workers[workerIdx]);
+		lock.lock();
+
+		if (--m_busyThreads == 0)
+			m_batchFinished.notify_one();
+	}
+}
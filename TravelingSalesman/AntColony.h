@@ -0,0 +1,186 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : MAX-MIN Ant System, using Ant Colony System's pseudo-random
+//                proportional rule to pick each ant's next city.
+//                Ants only choose between a city's nearest neighbours, and
+//                build their tours in parallel on a pool of worker threads
+//                owned by the colony. Pheromone is kept in a dense float
+//                matrix for small instances and per candidate edge for
+//                large ones, where the other edges stay at the trail
+//                minimum.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Geometry.h"
+#include "NeighbourLists.h"
+
+class AntColony {
+public:
+	// Creates a colony whose best tour starts as the given tour. Ants get
+	// their random generators seeded from the given generator, so runs can
+	// be reproduced whatever the thread count.
+	AntColony(const PointList& points, const NeighbourLists& neighbours, const std::vector<size_t>& path,
+	          double pathLength, size_t threadCount, std::mt19937& randomGenerator);
+	~AntColony();
+
+	AntColony(const AntColony&) = delete;
+	AntColony& operator=(const AntColony&) = delete;
+
+	// Lets every ant build a tour, improves each one with 2-opt / Or-opt
+	// local search if enabled, then evaporates and deposits pheromone.
+	// Tour building and local search stop early once *stopped becomes
+	// true.
+	// Returns true if the colony found a new best tour.
+	bool iterate(const std::atomic<bool>* stopped);
+
+	// Replaces the best tour, e.g. with a better one from another solver,
+	// and resets the trails around it.
+	void setBestTour(const std::vector<size_t>& path, double pathLength);
+
+	const std::vector<size_t>& getBestTour() const { return m_bestPath; }
+	double getBestPathLength() const { return m_bestPathLength; }
+
+	// Turns local search of every ant's tour on or off.
+	void setLocalSearch(bool enabled) { m_localSearch = enabled; }
+
+	size_t getAntCount() const { return m_ants.size(); }
+
+	// Node count above which pheromone is only kept for candidate edges.
+	static const size_t s_kMaxDenseNodeCount;
+
+private:
+	// Scratch space of one worker thread for building a tour.
+	struct Worker {
+		std::vector<char> visited;
+
+		// Unvisited cities, with the position of every city in the list, so
+		// that cities can be removed in constant time.
+		std::vector<size_t> unvisited;
+		std::vector<size_t> unvisitedPositions;
+
+		// Unvisited cities of every grid cell, laid out like m_cellCities
+		// with the first cellCounts[cell] of each cell unvisited, and the
+		// position of every city in the list. Only used without dense
+		// trails.
+		std::vector<size_t> cellCities;
+		std::vector<size_t> cellCounts;
+		std::vector<size_t> cellPositions;
+	};
+
+	struct Ant {
+		std::mt19937 randomGenerator;
+		std::vector<size_t> path;
+		double pathLength;
+	};
+
+	// Builds and optionally improves the tours of ants taken from
+	// m_nextAnt until none are left.
+	void runAnts(Worker& worker);
+
+	// Builds one ant's tour. Stops early once *m_stopped becomes true,
+	// leaving the ant with an infinite path length.
+	void buildTour(Ant& ant, Worker& worker);
+
+	// Improves one ant's tour with local search.
+	template <typename TourT>
+	void improveTour(Ant& ant);
+
+	// Picks the next city with dense trails when every candidate has been
+	// visited, from the first unvisitedCount cities of the worker's
+	// unvisited list.
+	size_t pickFallback(size_t city, const Worker& worker, size_t unvisitedCount) const;
+
+	// Returns the closest city to the given one that is still unvisited in
+	// the worker's grid. At least one city must be unvisited.
+	size_t findNearestUnvisited(size_t city, const Worker& worker) const;
+
+	// Buckets the cities into m_cellCities.
+	void buildGrid();
+
+	// Returns the index of the trail of an edge, or s_kNoTrail if the edge
+	// has no trail of its own.
+	size_t getTrailIdx(size_t from, size_t to) const;
+
+	// Returns the index of the trail from a city to its candidate.
+	size_t getCandidateTrailIdx(size_t from, size_t candidateIdx) const;
+
+	// Multiplies every trail by the persistence and clamps it to the trail
+	// limits.
+	void evaporate();
+
+	// Adds pheromone along a tour, in both directions.
+	void deposit(const std::vector<size_t>& path, double pathLength);
+
+	// Sets the trail limits from the best tour, and optionally resets every
+	// trail to the maximum.
+	void updateTrailLimits(bool resetTrails);
+
+	// Runs batches of ants until the colony is destroyed. Runs on each of
+	// m_threads.
+	void workerLoop(size_t workerIdx);
+
+	static const size_t s_kNoTrail;
+
+	const PointList& m_points;
+	const NeighbourLists& m_neighbours;
+	size_t m_nodeCount;
+	size_t m_candidateCount;
+	bool m_dense;
+
+	// Heuristic desirability of every candidate edge, indexed like the
+	// neighbour lists.
+	std::vector<float> m_candidateHeuristics;
+
+	// Uniform grid over the cities with roughly two per cell, used to find
+	// the nearest unvisited city without dense trails. m_cellStarts holds
+	// the offset of each cell's cities in m_cellCities, plus one past the
+	// end.
+	double m_cellSize;
+	size_t m_gridCols;
+	size_t m_gridRows;
+	std::vector<size_t> m_cellStarts;
+	std::vector<size_t> m_cellCities;
+	std::vector<size_t> m_cityCells;
+	std::vector<size_t> m_cityCellPositions;
+
+	// Pheromone trails, either n * n or one per candidate edge.
+	std::vector<float> m_trails;
+	float m_trailMin;
+	float m_trailMax;
+
+	std::vector<Ant> m_ants;
+	std::vector<size_t> m_bestPath;
+	double m_bestPathLength;
+	size_t m_iteration;
+	size_t m_iterationsSinceImprovement;
+	bool m_localSearch;
+
+	// Thread pool. Workers run a batch of ants whenever m_batch changes, and
+	// the calling thread works on the batch as worker 0.
+	std::vector<Worker> m_workers;
+	std::vector<std::thread> m_threads;
+	std::mutex m_poolMutex;
+	std::condition_variable m_batchStarted;
+	std::condition_variable m_batchFinished;
+	uint64_t m_batch;
+	size_t m_busyThreads;
+	bool m_shuttingDown;
+	std::atomic<size_t> m_nextAnt;
+	const std::atomic<bool>* m_stopped;
+};
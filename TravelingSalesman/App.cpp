@@ -13,16 +13,37 @@
 //
 
 #include "App.h"
-#include "Node.h"
 #include "Canvas.h"
 #include "PathFinder.h"
+#include "Instance.h"
+#include "Tracing.h"
 
 using namespace nanogui;
 
+namespace {
+	// Most frames drawn per second in performance mode
+	const double s_kPerformanceFrameRate = 10;
+
+	// Render snapshots published by the solver per second
+	const double s_kRenderSnapshotRate = 30;
+
+	// Seconds between auto saved checkpoints, until changed in the UI
+	const int s_kDefaultAutoSaveInterval = 60;
+}
+
 TravelingSalesmanApp::TravelingSalesmanApp()
 	: Screen(Vector2i(1500, 850), "Traveling Salesman")
 	, m_modulation{ 5 }
+	, m_performanceMode{ false }
+	, m_lastDrawTime{ 0 }
+	, m_drawnPathVersion{ 0 }
+	, m_drawnStopped{ true }
+	, m_staticBackground{ false }
+	, m_backgroundModulation{ 0 }
+	, m_backgroundSize{ 0, 0 }
 {
+	m_pathFinder.setRenderSnapshotRate(s_kRenderSnapshotRate);
+
 	/**
 	* Add a window.
 	* To the window add a label and a slider widget.
@@ -98,6 +119,179 @@ TravelingSalesmanApp::TravelingSalesmanApp()
 	geneticBtn->setCallback([this]() {
 		m_pathFinder.setMode(PathFinder::Mode::Genetic);
 	});
+	auto antColonyBtn = new Button(modeWindow, "Ant Colony");
+	antColonyBtn->setFlags(Button::RadioButton);
+	antColonyBtn->setCallback([this]() {
+		m_pathFinder.setMode(PathFinder::Mode::AntColonyOptimization);
+	});
+	auto iteratedLocalSearchBtn = new Button(modeWindow, "Iterated Local Search");
+	iteratedLocalSearchBtn->setFlags(Button::RadioButton);
+	iteratedLocalSearchBtn->setCallback([this]() {
+		m_pathFinder.setMode(PathFinder::Mode::IteratedLocalSearch);
+	});
+	auto tabuBtn = new Button(modeWindow, "Tabu Search");
+	tabuBtn->setFlags(Button::RadioButton);
+	tabuBtn->setCallback([this]() {
+		m_pathFinder.setMode(PathFinder::Mode::Tabu);
+	});
+	auto guidedLocalSearchBtn = new Button(modeWindow, "Guided Local Search");
+	guidedLocalSearchBtn->setFlags(Button::RadioButton);
+	guidedLocalSearchBtn->setCallback([this]() {
+		m_pathFinder.setMode(PathFinder::Mode::GuidedLocalSearch);
+	});
+	auto lateAcceptanceBtn = new Button(modeWindow, "Late Acceptance");
+	lateAcceptanceBtn->setFlags(Button::RadioButton);
+	lateAcceptanceBtn->setCallback([this]() {
+		m_pathFinder.setMode(PathFinder::Mode::LateAcceptance);
+	});
+	auto recordToRecordBtn = new Button(modeWindow, "Record To Record");
+	recordToRecordBtn->setFlags(Button::RadioButton);
+	recordToRecordBtn->setCallback([this]() {
+		m_pathFinder.setMode(PathFinder::Mode::RecordToRecord);
+	});
+	auto thresholdAcceptingBtn = new Button(modeWindow, "Threshold Accepting");
+	thresholdAcceptingBtn->setFlags(Button::RadioButton);
+	thresholdAcceptingBtn->setCallback([this]() {
+		m_pathFinder.setMode(PathFinder::Mode::ThresholdAccepting);
+	});
+	auto multilevelBtn = new Button(modeWindow, "Multilevel");
+	multilevelBtn->setFlags(Button::RadioButton);
+	multilevelBtn->setCallback([this]() {
+		m_pathFinder.setMode(PathFinder::Mode::Multilevel);
+	});
+	auto partitionedBtn = new Button(modeWindow, "Partitioned");
+	partitionedBtn->setFlags(Button::RadioButton);
+	partitionedBtn->setCallback([this]() {
+		m_pathFinder.setMode(PathFinder::Mode::Partitioned);
+	});
+	auto portfolioBtn = new Button(modeWindow, "Portfolio");
+	portfolioBtn->setFlags(Button::RadioButton);
+	portfolioBtn->setCallback([this]() {
+		m_pathFinder.setMode(PathFinder::Mode::Portfolio);
+	});
+
+	// Kept so the pushed button can follow the mode of a loaded checkpoint
+	std::vector<std::pair<PathFinder::Mode, Button*>> modeButtons = {
+		{ PathFinder::HillClimbing, hillClimbingBtn },
+		{ PathFinder::Anealing, annealingBtn },
+		{ PathFinder::Genetic, geneticBtn },
+		{ PathFinder::AntColonyOptimization, antColonyBtn },
+		{ PathFinder::IteratedLocalSearch, iteratedLocalSearchBtn },
+		{ PathFinder::Tabu, tabuBtn },
+		{ PathFinder::GuidedLocalSearch, guidedLocalSearchBtn },
+		{ PathFinder::LateAcceptance, lateAcceptanceBtn },
+		{ PathFinder::RecordToRecord, recordToRecordBtn },
+		{ PathFinder::ThresholdAccepting, thresholdAcceptingBtn },
+		{ PathFinder::Multilevel, multilevelBtn },
+		{ PathFinder::Partitioned, partitionedBtn },
+		{ PathFinder::Portfolio, portfolioBtn },
+	};
+
+	// Ants' local search is a separate toggle, since the mode buttons are
+	// radio buttons
+	auto antLocalSearchBtn = new Button(modeWindow, "Ant Local Search");
+	antLocalSearchBtn->setFlags(Button::ToggleButton);
+	antLocalSearchBtn->setPushed(true);
+	antLocalSearchBtn->setChangeCallback([this](bool pushed) {
+		m_pathFinder.setAntLocalSearch(pushed);
+	});
+
+	// Setup checkpoint save / load
+	Window* checkpointWindow = new Window(this, "Checkpoint");
+	checkpointWindow->setPosition({ 1250, 15 });
+	checkpointWindow->setLayout(new GroupLayout());
+	auto saveBtn = new Button(checkpointWindow, "Save");
+	saveBtn->setCallback([this]() {
+		std::string fileName = file_dialog({ { "tspc", "Solver Checkpoint" } }, true);
+		if (!fileName.empty())
+			m_pathFinder.saveCheckpoint(fileName);
+	});
+	auto loadBtn = new Button(checkpointWindow, "Load");
+	loadBtn->setCallback([this, canvas, modeButtons]() {
+		std::string fileName = file_dialog({ { "tspc", "Solver Checkpoint" } }, false);
+		if (fileName.empty() || !m_pathFinder.loadCheckpoint(fileName))
+			return;
+
+		canvas->syncNodes();
+		for (const std::pair<PathFinder::Mode, Button*>& modeButton : modeButtons)
+			modeButton.second->setPushed(modeButton.first == m_pathFinder.getMode());
+	});
+
+	// Auto save keeps a checkpoint of a running solver up to date, so that
+	// a long run can be loaded again after a crash
+	new Label(checkpointWindow, "Auto Save Interval", "sans-bold");
+	auto autoSaveIntervalBox = new IntBox<int>(checkpointWindow, s_kDefaultAutoSaveInterval);
+	autoSaveIntervalBox->setEditable(true);
+	autoSaveIntervalBox->setUnits("s");
+	autoSaveIntervalBox->setMinValue(1);
+	autoSaveIntervalBox->setCallback([this](int seconds) {
+		if (!m_autoSaveFile.empty())
+			m_pathFinder.setCheckpointFile(m_autoSaveFile, std::chrono::seconds(seconds));
+	});
+	auto autoSaveBtn = new Button(checkpointWindow, "Auto Save");
+	autoSaveBtn->setFlags(Button::ToggleButton);
+	autoSaveBtn->setChangeCallback([this, autoSaveBtn, autoSaveIntervalBox](bool pushed) {
+		m_autoSaveFile.clear();
+		if (pushed) {
+			m_autoSaveFile = file_dialog({ { "tspc", "Solver Checkpoint" } }, true);
+			if (m_autoSaveFile.empty()) {
+				autoSaveBtn->setPushed(false);
+				return;
+			}
+		}
+		m_pathFinder.setCheckpointFile(m_autoSaveFile, std::chrono::seconds(autoSaveIntervalBox->value()));
+	});
+
+	// Setup loading of instances written by other tools
+	Window* instanceWindow = new Window(this, "Instance");
+	instanceWindow->setPosition({ 1250, 235 });
+	instanceWindow->setLayout(new GroupLayout());
+	auto loadInstanceBtn = new Button(instanceWindow, "Load");
+	loadInstanceBtn->setCallback([this, canvas]() {
+		std::string fileName = file_dialog({ { "tsp", "TSPLIB Instance" }, { "tspi", "Binary Instance" } }, false);
+		PointList points;
+		if (!fileName.empty() && loadInstance(fileName, points)) {
+			m_pathFinder.setNodes(points);
+			canvas->syncNodes();
+		}
+	});
+
+	// Setup tracing of solver phases. The trace is saved when stopped.
+	Window* traceWindow = new Window(this, "Trace");
+	traceWindow->setPosition({ 1250, 325 });
+	traceWindow->setLayout(new GroupLayout());
+	auto traceBtn = new Button(traceWindow, "Start");
+	traceBtn->setFlags(Button::ToggleButton);
+	traceBtn->setChangeCallback([traceBtn](bool pushed) {
+		if (pushed) {
+			startTracing();
+			traceBtn->setCaption("Stop");
+			return;
+		}
+
+		stopTracing();
+		traceBtn->setCaption("Start");
+		std::string fileName = file_dialog({ { "json", "Chrome Trace" } }, true);
+		if (!fileName.empty())
+			writeTrace(fileName);
+	});
+
+	// Setup the display options for slow (e.g. software rendered) displays
+	Window* displayWindow = new Window(this, "Display");
+	displayWindow->setPosition({ 1250, 415 });
+	displayWindow->setLayout(new GroupLayout());
+	auto performanceBtn = new Button(displayWindow, "Performance Mode");
+	performanceBtn->setFlags(Button::ToggleButton);
+	performanceBtn->setChangeCallback([this](bool pushed) {
+		m_performanceMode = pushed;
+	});
+	auto staticBackgroundBtn = new Button(displayWindow, "Static Background");
+	staticBackgroundBtn->setFlags(Button::ToggleButton);
+	staticBackgroundBtn->setChangeCallback([this](bool pushed) {
+		m_staticBackground = pushed;
+		if (!pushed)
+			m_background.free();
+	});
 
 	// Do the layout calculations based on what was added to the GUI
 	performLayout();
@@ -132,6 +326,25 @@ TravelingSalesmanApp::TravelingSalesmanApp()
 	m_shader.setUniform("resolution", Vector2f{ fboWidth, fboHeight });
 }
 
+void TravelingSalesmanApp::drawAll()
+{
+	std::shared_ptr<const RenderSnapshot> snapshot = m_pathFinder.getRenderSnapshot();
+	if (m_performanceMode) {
+		if (glfwGetTime() - m_lastDrawTime < 1 / s_kPerformanceFrameRate)
+			return;
+		if (!hasChangedSinceDraw(snapshot.get()))
+			return;
+	}
+
+	// Record the state before drawing, so that changes made while drawing
+	// are picked up by the next frame
+	m_lastDrawTime = glfwGetTime();
+	m_drawnPathVersion = snapshot ? snapshot->pathVersion : 0;
+	m_drawnStopped = snapshot ? snapshot->stats.stopped : true;
+
+	Screen::drawAll();
+}
+
 void TravelingSalesmanApp::drawContents()
 {
 	static double prevTime = glfwGetTime();
@@ -139,7 +352,13 @@ void TravelingSalesmanApp::drawContents()
 	double deltaTime = curTime - prevTime;
 	prevTime = curTime;
 
-	if (!m_pathFinder.isStopped()) {
+	if (m_staticBackground) {
+		drawStaticBackground();
+		return;
+	}
+
+	std::shared_ptr<const RenderSnapshot> snapshot = m_pathFinder.getRenderSnapshot();
+	if (snapshot && !snapshot->stats.stopped) {
 		m_modulation += static_cast<float>(deltaTime * 2);
 	}
 
@@ -148,6 +367,36 @@ void TravelingSalesmanApp::drawContents()
 	m_shader.drawIndexed(GL_TRIANGLES, 0, 2);
 }
 
+bool TravelingSalesmanApp::hasChangedSinceDraw(const RenderSnapshot* snapshot)
+{
+	// The screen records the time of every input and resize event
+	if (mLastInteraction >= m_lastDrawTime)
+		return true;
+	return snapshot
+		&& (snapshot->pathVersion != m_drawnPathVersion || snapshot->stats.stopped != m_drawnStopped);
+}
+
+void TravelingSalesmanApp::drawStaticBackground()
+{
+	if (!m_background.ready() || m_backgroundModulation != m_modulation || m_backgroundSize != mFBSize) {
+		TRACE_SCOPE("Render Background");
+
+		m_background.free();
+		m_background.init(mFBSize, 0);
+		m_background.bind();
+		m_shader.bind();
+		m_shader.setUniform("modulation", m_modulation);
+		m_shader.setUniform("resolution", Vector2f{ mFBSize.cast<float>() });
+		m_shader.drawIndexed(GL_TRIANGLES, 0, 2);
+		m_background.release();
+
+		m_backgroundModulation = m_modulation;
+		m_backgroundSize = mFBSize;
+	}
+
+	m_background.blit();
+}
+
 void TravelingSalesmanApp::draw(NVGcontext * ctx)
 {
 	//nvgBeginPath(ctx);
@@ -14,7 +14,7 @@
 
 #pragma once
 
-#include <nanogui\nanogui.h>
+#include <nanogui/nanogui.h>
 
 #include "PathFinder.h"
 
@@ -23,6 +23,10 @@ public:
 	// Setup UI and Shader
 	TravelingSalesmanApp();
 
+	// Draws the screen, unless in performance mode and nothing has changed
+	// since the last frame, or the last frame was too recent.
+	void drawAll() override;
+
 	// Draw opengl stuff (screen will handle clear and buffer swap)
 	void drawContents() override;
 
@@ -30,7 +34,33 @@ public:
 	void draw(NVGcontext* ctx) override;
 
 private:
+	// Returns true if the UI, or the tour or solver state in the latest 
+	// render snapshot, has changed since the last frame.
+	bool hasChangedSinceDraw(const RenderSnapshot* snapshot);
+
+	// Draws the background from a cached frame, rendering it first if the
+	// modulation or framebuffer size has changed.
+	void drawStaticBackground();
+
 	nanogui::GLShader m_shader;
 	float m_modulation;
 	PathFinder m_pathFinder;
+
+	// File that auto save writes checkpoints to, or empty while it is off.
+	std::string m_autoSaveFile;
+
+	// In performance mode, frames are only drawn when something has changed,
+	// at most s_kPerformanceFrameRate times a second, so the solver gets
+	// the CPU on software rendered displays.
+	bool m_performanceMode;
+	double m_lastDrawTime;
+	uint64_t m_drawnPathVersion;
+	bool m_drawnStopped;
+
+	// With a static background, the raymarched background stops animating
+	// and is drawn once into m_background, then copied every frame.
+	bool m_staticBackground;
+	nanogui::GLFramebuffer m_background;
+	float m_backgroundModulation;
+	nanogui::Vector2i m_backgroundSize;
 };
\ No newline at end of file
@@ -0,0 +1,73 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Array based tour representation.
+//                Stores the visiting order along with the position of each
+//                city in that order.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <utility>
+
+#include "ArrayTour.h"
+
+ArrayTour::ArrayTour(const std::vector<size_t>& order)
+	: m_order{ order }
+	, m_positions(order.size())
+{
+	for (size_t i = 0; i < m_order.size(); ++i)
+		m_positions[m_order[i]] = i;
+}
+
+bool ArrayTour::between(size_t a, size_t b, size_t c) const
+{
+	size_t posA = m_positions[a];
+	size_t posB = m_positions[b];
+	size_t posC = m_positions[c];
+	if (posA <= posC)
+		return posA <= posB && posB <= posC;
+	else
+		return posB >= posA || posB <= posC;
+}
+
+void ArrayTour::flip(size_t a, size_t b, size_t c, size_t d)
+{
+	size_t n = m_order.size();
+	size_t posB = m_positions[b];
+	size_t posC = m_positions[c];
+
+	// Reversing b..c or d..a produces the same tour, so reverse the shorter one
+	size_t innerLength = (posC + n - posB) % n + 1;
+	if (innerLength * 2 <= n)
+		reverse(posB, posC);
+	else
+		reverse(m_positions[d], m_positions[a]);
+}
+
+void ArrayTour::getOrder(std::vector<size_t>& outOrder) const
+{
+	outOrder = m_order;
+}
+
+void ArrayTour::reverse(size_t fromPos, size_t toPos)
+{
+	size_t n = m_order.size();
+	size_t length = (toPos + n - fromPos) % n + 1;
+	for (size_t i = 0; i < length / 2; ++i) {
+		size_t cityFrom = m_order[fromPos];
+		size_t cityTo = m_order[toPos];
+		m_order[fromPos] = cityTo;
+		m_positions[cityTo] = fromPos;
+		m_order[toPos] = cityFrom;
+		m_positions[cityFrom] = toPos;
+
+		fromPos = fromPos + 1 == n ? 0 : fromPos + 1;
+		toPos = toPos == 0 ? n - 1 : toPos - 1;
+	}
+}
@@ -0,0 +1,66 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Array based tour representation.
+//                Stores the visiting order along with the position of each
+//                city in that order. Reversals cost O(n) but have a very low
+//                constant, making this the best choice for small instances.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+class ArrayTour {
+public:
+	// Creates a tour visiting the cities in the specified order.
+	// Cities must be numbered 0 to order.size() - 1.
+	explicit ArrayTour(const std::vector<size_t>& order);
+
+	// Returns the number of cities in the tour.
+	size_t size() const { return m_order.size(); }
+
+	// Returns the city visited after the specified city.
+	size_t next(size_t city) const
+	{
+		size_t pos = m_positions[city] + 1;
+		return m_order[pos == m_order.size() ? 0 : pos];
+	}
+
+	// Returns the city visited before the specified city.
+	size_t prev(size_t city) const
+	{
+		size_t pos = m_positions[city];
+		return m_order[pos == 0 ? m_order.size() - 1 : pos - 1];
+	}
+
+	// Returns true if b lies on the path from a to c (inclusive) when
+	// travelling forwards through the tour.
+	bool between(size_t a, size_t b, size_t c) const;
+
+	// Performs a 2-opt move, replacing the edges (a, b) and (c, d) with the
+	// edges (a, c) and (b, d).
+	// Requires b == next(a) and d == next(c).
+	// Note: The shorter of the two paths is reversed, so the direction of the
+	// tour may be flipped after this call.
+	void flip(size_t a, size_t b, size_t c, size_t d);
+
+	// Outputs the cities in visiting order.
+	void getOrder(std::vector<size_t>& outOrder) const;
+
+private:
+	// Reverses the cities between the two positions (inclusive), wrapping
+	// around the end of the order if necessary.
+	void reverse(size_t fromPos, size_t toPos);
+
+	std::vector<size_t> m_order;
+	std::vector<size_t> m_positions;
+};
@@ -0,0 +1,137 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Distances between batches of points.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <cmath>
+
+#include "BatchDistances.h"
+
+const size_t PointBatch::s_kMinSize;
+const size_t PointBatch::s_kMaxSize;
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BATCH_DISTANCES_AVX2
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC allows AVX2 intrinsics in any function
+#define AVX2_FUNCTION
+#else
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+	// Computed as in euclideanDistSquared, without fused multiply-adds, so
+	// that both paths give the same results.
+	double distance(double dx, double dy)
+	{
+		return std::sqrt(dx * dx + dy * dy);
+	}
+
+#ifdef BATCH_DISTANCES_AVX2
+	// Returns true if the CPU supports AVX2 and the OS saves the AVX
+	// registers on context switches.
+	bool detectAvx2()
+	{
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+
+		__cpuid(info, 1);
+		bool osSavesAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+		if (!osSavesAvx)
+			return false;
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+
+	const bool s_kHasAvx2 = detectAvx2();
+	bool s_avx2Enabled = s_kHasAvx2;
+
+	AVX2_FUNCTION __m256d distances(__m256d dx, __m256d dy)
+	{
+		return _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+	}
+
+	AVX2_FUNCTION size_t distancesAvx2(const Eigen::Vector2d& from, const PointBatch& to, size_t count, double* outDistances)
+	{
+		__m256d fromX = _mm256_set1_pd(from.x());
+		__m256d fromY = _mm256_set1_pd(from.y());
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m256d dx = _mm256_sub_pd(_mm256_loadu_pd(to.xs + i), fromX);
+			__m256d dy = _mm256_sub_pd(_mm256_loadu_pd(to.ys + i), fromY);
+			_mm256_storeu_pd(outDistances + i, distances(dx, dy));
+		}
+		return i;
+	}
+
+	AVX2_FUNCTION size_t pairDistancesAvx2(const PointBatch& from, const PointBatch& to, size_t count, double* outDistances)
+	{
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m256d dx = _mm256_sub_pd(_mm256_loadu_pd(to.xs + i), _mm256_loadu_pd(from.xs + i));
+			__m256d dy = _mm256_sub_pd(_mm256_loadu_pd(to.ys + i), _mm256_loadu_pd(from.ys + i));
+			_mm256_storeu_pd(outDistances + i, distances(dx, dy));
+		}
+		return i;
+	}
+#endif
+}
+
+void calculateDistances(const Eigen::Vector2d& from, const PointBatch& to, size_t count, double* outDistances)
+{
+	size_t i = 0;
+#ifdef BATCH_DISTANCES_AVX2
+	if (s_avx2Enabled)
+		i = distancesAvx2(from, to, count, outDistances);
+#endif
+
+	// Whatever is left over, or everything without AVX2
+	for (; i < count; ++i)
+		outDistances[i] = distance(to.xs[i] - from.x(), to.ys[i] - from.y());
+}
+
+void calculatePairDistances(const PointBatch& from, const PointBatch& to, size_t count, double* outDistances)
+{
+	size_t i = 0;
+#ifdef BATCH_DISTANCES_AVX2
+	if (s_avx2Enabled)
+		i = pairDistancesAvx2(from, to, count, outDistances);
+#endif
+
+	for (; i < count; ++i)
+		outDistances[i] = distance(to.xs[i] - from.xs[i], to.ys[i] - from.ys[i]);
+}
+
+bool isAvx2Enabled()
+{
+#ifdef BATCH_DISTANCES_AVX2
+	return s_avx2Enabled;
+#else
+	return false;
+#endif
+}
+
+void setAvx2Enabled(bool enabled)
+{
+#ifdef BATCH_DISTANCES_AVX2
+	s_avx2Enabled = enabled && s_kHasAvx2;
+#endif
+}
@@ -0,0 +1,59 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Distances between batches of points, computed four at a
+//                time with AVX2 when the CPU supports it and one at a time
+//                otherwise. The check is made once at startup.
+//                Both paths round exactly like euclideanDist, so local
+//                search makes the same moves whichever one is used.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <cstddef>
+
+#include "Geometry.h"
+
+// Coordinates of a batch of cities, split into x and y arrays so that the
+// distance kernels can load several at once.
+struct PointBatch {
+	// Fewest cities worth batching, enough to fill one AVX2 vector.
+	static const size_t s_kMinSize = 4;
+
+	// Most cities in one batch.
+	static const size_t s_kMaxSize = 16;
+
+	// Copies the coordinates of count cities, at most s_kMaxSize.
+	void gather(const PointList& points, const size_t* cities, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i) {
+			xs[i] = points[cities[i]].x();
+			ys[i] = points[cities[i]].y();
+		}
+	}
+
+	double xs[s_kMaxSize];
+	double ys[s_kMaxSize];
+};
+
+// Outputs the distances from a point to the first count points of a batch.
+void calculateDistances(const Eigen::Vector2d& from, const PointBatch& to, size_t count, double* outDistances);
+
+// Outputs the distances between the first count points of two batches,
+// pairwise.
+void calculatePairDistances(const PointBatch& from, const PointBatch& to, size_t count, double* outDistances);
+
+// Returns true if the distances are computed with AVX2.
+bool isAvx2Enabled();
+
+// Turns the AVX2 path off, or back on if the CPU supports it, so that the
+// benchmarks can compare it with the scalar path. Must not be called while
+// a solver is running.
+void setAvx2Enabled(bool enabled);
@@ -0,0 +1,56 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Lock-free board holding the shortest tour found by any of
+//                a group of concurrently running solvers.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <limits>
+
+#include "BestTourBoard.h"
+
+BestTourBoard::BestTourBoard()
+	: m_bestLength{ std::numeric_limits<double>::infinity() }
+{
+}
+
+void BestTourBoard::reset()
+{
+	std::atomic_store(&m_best, std::shared_ptr<const Entry>{});
+	m_bestLength.store(std::numeric_limits<double>::infinity(), std::memory_order_release);
+}
+
+bool BestTourBoard::publish(const std::vector<size_t>& path, double pathLength, size_t publisherId)
+{
+	// Cheap early out for the common case of a losing tour
+	if (pathLength >= getBestLength())
+		return false;
+
+	std::shared_ptr<const Entry> entry = std::make_shared<const Entry>(Entry{ path, pathLength, publisherId });
+	std::shared_ptr<const Entry> expected = std::atomic_load(&m_best);
+	do {
+		if (expected && expected->pathLength <= pathLength)
+			return false;
+	} while (!std::atomic_compare_exchange_weak(&m_best, &expected, entry));
+
+	// Lower the cached length. A concurrent publisher may already have
+	// lowered it further, in which case it is left alone.
+	double cachedLength = m_bestLength.load(std::memory_order_acquire);
+	while (pathLength < cachedLength
+	       && !m_bestLength.compare_exchange_weak(cachedLength, pathLength, std::memory_order_acq_rel)) {
+	}
+
+	return true;
+}
+
+std::shared_ptr<const BestTourBoard::Entry> BestTourBoard::getBest() const
+{
+	return std::atomic_load(&m_best);
+}
@@ -0,0 +1,60 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Lock-free board holding the shortest tour found by any of
+//                a group of concurrently running solvers.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+class BestTourBoard {
+public:
+	// An immutable published tour.
+	struct Entry {
+		std::vector<size_t> path;
+		double pathLength;
+
+		// Identifies the solver that published the tour.
+		size_t publisherId;
+	};
+
+	BestTourBoard();
+
+	// Removes the current best tour.
+	// Note: Must not be called while solvers are publishing.
+	void reset();
+
+	// Offers a tour to the board. The tour replaces the current best only if
+	// it is shorter.
+	// Returns true if the tour was accepted.
+	bool publish(const std::vector<size_t>& path, double pathLength, size_t publisherId);
+
+	// Returns the current best tour, or nullptr if nothing was published.
+	// The returned entry stays valid while it is held, even if a better tour
+	// is published in the meantime.
+	std::shared_ptr<const Entry> getBest() const;
+
+	// Returns the length of the current best tour without touching the tour
+	// itself, or infinity if nothing was published.
+	double getBestLength() const { return m_bestLength.load(std::memory_order_acquire); }
+
+private:
+	// Only accessed through the std::atomic_* shared_ptr functions.
+	std::shared_ptr<const Entry> m_best;
+
+	// Cached copy of m_best's length so that losing tours are rejected
+	// without copying them.
+	std::atomic<double> m_bestLength;
+};
@@ -11,73 +11,184 @@
 // Mail         : lance.cha7337@mediadesign.school.nz
 //
 
+#include <cmath>
+
+#include <nanogui/screen.h>
+
 #include "Canvas.h"
-#include "Node.h"
 #include "PathFinder.h"
 
 using namespace nanogui;
 
+namespace {
+	// Zoom factor for each step of the scroll wheel
+	const double s_kZoomPerStep = 1.1;
+}
+
 Canvas::Canvas(Widget* parent, PathFinder& pathFinder)
 	: Widget(parent)
 	, m_pathFinder{ pathFinder }
+	, m_dragNodeIdx{ PointLayer::s_kNoPoint }
+	, m_panning{ false }
+	, m_panMoved{ false }
 {
 }
 
 bool Canvas::mouseButtonEvent(const nanogui::Vector2i & p, int button, bool down, int modifiers)
 {
+	Widget::mouseButtonEvent(p, button, down, modifiers);
+	Eigen::Vector2d pos = getWorldPos(p);
+
+	// Nodes keep their size on screen, so the pick size shrinks in the world
+	// as the view zooms in
+	double pickHalfSize = PointLayer::s_kHalfSize / m_view.scale;
+
 	// Handle removing nodes on right click
 	if (button == GLFW_MOUSE_BUTTON_2 && down) {
-		for (size_t i = 0; i < mChildren.size(); ++i) {
-			Node* node = dynamic_cast<Node*>(mChildren[i]);
-			if (node && node->contains(p)) {
-				bool restart = m_pathFinder.stop();
+		size_t nodeIdx = m_pointLayer.pick(pos, pickHalfSize);
+		if (nodeIdx == PointLayer::s_kNoPoint)
+			return false;
 
-				m_pathFinder.removeNode(node);
-				removeChild(static_cast<int>(i));
+		// The solver moves its last node into the removed index, and the
+		// point layer does the same, so indices stay in sync.
+		bool restart = m_pathFinder.stop();
+		m_pathFinder.removeNode(nodeIdx);
+		m_pointLayer.removePoint(nodeIdx);
+		m_dragNodeIdx = PointLayer::s_kNoPoint;
 
-				if (restart)
-					m_pathFinder.calculatePathAsync();
+		if (restart)
+			m_pathFinder.calculatePathAsync();
 
-				return true;
-			}
-		}
+		return true;
 	}
 
-	bool handled = Widget::mouseButtonEvent(p, button, down, modifiers);
+	if (button != GLFW_MOUSE_BUTTON_1)
+		return false;
 
-	// Handle adding nodes on left click
-	if (!handled && button == GLFW_MOUSE_BUTTON_1 && down) {
-		bool restart = m_pathFinder.stop();
-
-		auto node = new Node(this);
-		node->setPosition(p);
+	// Handle dropping a dragged node. The solver only sees the final 
+	// position, since moving a node restarts it.
+	if (!down) {
+		bool clicked = m_panning && !m_panMoved;
+		m_panning = false;
+		if (clicked)
+			return addNode(pos);
+		if (m_dragNodeIdx == PointLayer::s_kNoPoint)
+			return false;
 
-		// Setup drag handler for dragging nodes around
-		node->setDragCallback([node, this](const Vector2i& p, const Vector2i& rel, int buttonState, int modifiers) {
-			if (buttonState & 0x1) { // Not GLFW mouse button apparently (seems to have 1 bit set, going from right to left, for each mouse button pressed)
-				bool restart = m_pathFinder.stop();
+		bool restart = m_pathFinder.stop();
+		m_pathFinder.setNodePosition(m_dragNodeIdx, pos);
+		m_pointLayer.setPointPosition(m_dragNodeIdx, pos);
+		m_dragNodeIdx = PointLayer::s_kNoPoint;
 
-				node->setPosition(node->position() + rel);
+		if (restart)
+			m_pathFinder.calculatePathAsync();
 
-				if (restart)
-					m_pathFinder.calculatePathAsync();
-			}
-		});
+		return true;
+	}
 
-		m_pathFinder.addNode(node);
+	// Handle picking up a node, or panning on empty space. A node is only
+	// added on release, if the view was not panned.
+	m_dragNodeIdx = m_pointLayer.pick(pos, pickHalfSize);
+	if (m_dragNodeIdx == PointLayer::s_kNoPoint) {
+		m_panning = true;
+		m_panMoved = false;
+	}
 
-		if (restart)
-			m_pathFinder.calculatePathAsync();
+	return true;
+}
 
+bool Canvas::mouseDragEvent(const nanogui::Vector2i& p, const nanogui::Vector2i& rel, int /* button */, int /* modifiers */)
+{
+	if (m_panning) {
+		m_view.offset -= rel.cast<double>() / m_view.scale;
+		m_panMoved = true;
 		return true;
 	}
 
-	return handled;
+	if (m_dragNodeIdx == PointLayer::s_kNoPoint)
+		return false;
+
+	m_pointLayer.setPointPosition(m_dragNodeIdx, getWorldPos(p));
+	return true;
+}
+
+bool Canvas::scrollEvent(const nanogui::Vector2i& p, const nanogui::Vector2f& rel)
+{
+	m_view.zoom(std::pow(s_kZoomPerStep, rel.y()), getCanvasPos(p));
+	return true;
 }
 
-void Canvas::draw(NVGcontext * ctx)
+void Canvas::syncNodes()
+{
+	PointList points = m_pathFinder.getNodePositions();
+	m_pointLayer.setPoints(points);
+	m_dragNodeIdx = PointLayer::s_kNoPoint;
+	m_panning = false;
+
+	if (points.empty())
+		return;
+	Eigen::AlignedBox2d bounds;
+	for (const Eigen::Vector2d& point : points)
+		bounds.extend(point);
+	m_view.canvasSize = mSize.cast<double>();
+	m_view.fit(bounds, 2 * PointLayer::s_kHalfSize);
+}
+
+void Canvas::draw(NVGcontext* ctx)
 {
 	Widget::draw(ctx);
 
-	m_pathFinder.draw(ctx);
+	// Draw from the solver's latest render snapshot only, so drawing never
+	// waits on the solver. The tour renderer keeps its geometry until the
+	// snapshot holds a new tour.
+	std::shared_ptr<const RenderSnapshot> snapshot = m_pathFinder.getRenderSnapshot();
+
+	// Flush NanoVG so that the nodes and tour are drawn over the window,
+	// then draw the statistics over them
+	nvgEndFrame(ctx);
+
+	// Limit drawing to the canvas. GL's origin is the bottom left of the
+	// framebuffer, which may have more pixels than the screen.
+	float pixelRatio = screen()->pixelRatio();
+	Vector2i position = absolutePosition();
+	GLint storedViewport[4];
+	glGetIntegerv(GL_VIEWPORT, storedViewport);
+	glViewport(static_cast<GLint>(position.x() * pixelRatio),
+	           static_cast<GLint>((screen()->size().y() - position.y() - mSize.y()) * pixelRatio),
+	           static_cast<GLsizei>(mSize.x() * pixelRatio),
+	           static_cast<GLsizei>(mSize.y() * pixelRatio));
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	m_view.canvasSize = mSize.cast<double>();
+	m_pointLayer.draw(m_view);
+	if (snapshot)
+		m_tourRenderer.draw(*snapshot, m_view);
+
+	glViewport(storedViewport[0], storedViewport[1], storedViewport[2], storedViewport[3]);
+
+	if (snapshot)
+		PathFinder::draw(ctx, snapshot->stats);
+}
+
+bool Canvas::addNode(const Eigen::Vector2d& pos)
+{
+	bool restart = m_pathFinder.stop();
+	m_pathFinder.addNode(pos);
+	m_pointLayer.addPoint(pos);
+
+	if (restart)
+		m_pathFinder.calculatePathAsync();
+
+	return true;
+}
+
+Eigen::Vector2d Canvas::getCanvasPos(const nanogui::Vector2i& p) const
+{
+	return (p - mPos).cast<double>();
+}
+
+Eigen::Vector2d Canvas::getWorldPos(const nanogui::Vector2i& p) const
+{
+	return m_view.toWorld(getCanvasPos(p));
 }
@@ -14,22 +14,60 @@
 
 #pragma once
 
-#include <nanogui\widget.h>
+#include <Eigen/Dense>
+#include <nanogui/widget.h>
+
+#include "PointLayer.h"
+#include "TourRenderer.h"
+#include "ViewTransform.h"
 
-class Node;
 class PathFinder;
 
 class Canvas : public nanogui::Widget {
 public:
 	Canvas(nanogui::Widget* parent, PathFinder& pathFinder);
 
-	// Handles various mouse click events on the canvas
+	// Adds nodes on left click, starts dragging a node or panning the view
+	// on left press, and removes nodes on right click.
 	bool mouseButtonEvent(const nanogui::Vector2i& p, int button, bool down, int modifiers) override;
 
+	// Moves the node being dragged, or pans the view.
+	bool mouseDragEvent(const nanogui::Vector2i& p, const nanogui::Vector2i& rel, int button, int modifiers) override;
+
+	// Zooms the view around the cursor.
+	bool scrollEvent(const nanogui::Vector2i& p, const nanogui::Vector2f& rel) override;
+
 	// Draws the canvas, nodes, and current solver (PathFinder) state.
 	void draw(NVGcontext* ctx) override;
 
-	std::vector<Node*> nodes;
+	// Reloads all nodes from the solver's node positions, e.g. after
+	// loading a checkpoint, and fits the view to them.
+	void syncNodes();
+
+private:
+	// Adds a node at a world position, restarting the solver if it was
+	// running. Always returns true, as the event is handled.
+	bool addNode(const Eigen::Vector2d& pos);
+
+	// Returns the canvas position of a point given in the parent's
+	// coordinates, as mouse events are.
+	Eigen::Vector2d getCanvasPos(const nanogui::Vector2i& p) const;
+
+	// Returns the world (solver) position under a point given in the
+	// parent's coordinates.
+	Eigen::Vector2d getWorldPos(const nanogui::Vector2i& p) const;
+
 	PathFinder& m_pathFinder;
-};
+	PointLayer m_pointLayer;
+	TourRenderer m_tourRenderer;
+
+	ViewTransform m_view;
 
+	// Index of the node being dragged, or PointLayer::s_kNoPoint.
+	size_t m_dragNodeIdx;
+
+	// Whether the left button is down over empty space, and whether the
+	// view has been panned since, in which case releasing it adds no node.
+	bool m_panning;
+	bool m_panMoved;
+};
@@ -0,0 +1,401 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Saving and loading of solver state to a compact, versioned
+//                binary checkpoint file, plus a background writer so that
+//                solvers can checkpoint without waiting on the disk.
+//
+//                File layout (all integers little endian):
+//                  "TSPC", uint32 version, snapshot, uint32 FNV-1a checksum
+//                Tours are stored as zigzag varint deltas between
+//                consecutive indices, which keeps them small for the
+//                mostly local orders produced by the solvers.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+#include "Checkpoint.h"
+#include "Tracing.h"
+
+namespace {
+	const char s_kMagic[4] = { 'T', 'S', 'P', 'C' };
+	const uint32_t s_kVersion = 2;
+
+	// Portfolio snapshots may not nest deeper than this.
+	const size_t s_kMaxDepth = 1;
+
+	uint32_t fnv1a(const uint8_t* data, size_t size)
+	{
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < size; ++i) {
+			hash ^= data[i];
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	// Appends encoded values to a byte buffer.
+	class Encoder {
+	public:
+		explicit Encoder(std::vector<uint8_t>& buffer) : m_buffer{ buffer } {}
+
+		void writeBytes(const void* data, size_t size)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+		}
+
+		void writeU8(uint8_t value) { m_buffer.push_back(value); }
+
+		void writeU32(uint32_t value)
+		{
+			for (int i = 0; i < 4; ++i)
+				m_buffer.push_back(static_cast<uint8_t>(value >> (8 * i)));
+		}
+
+		void writeDouble(double value)
+		{
+			uint64_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			for (int i = 0; i < 8; ++i)
+				m_buffer.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+		}
+
+		void writeVarint(uint64_t value)
+		{
+			while (value >= 0x80) {
+				m_buffer.push_back(static_cast<uint8_t>(value | 0x80));
+				value >>= 7;
+			}
+			m_buffer.push_back(static_cast<uint8_t>(value));
+		}
+
+		void writeTour(const std::vector<size_t>& tour)
+		{
+			writeVarint(tour.size());
+			int64_t prev = 0;
+			for (size_t city : tour) {
+				int64_t delta = static_cast<int64_t>(city) - prev;
+				writeVarint((static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63));
+				prev = static_cast<int64_t>(city);
+			}
+		}
+
+		void writeSnapshot(const SolverSnapshot& snapshot)
+		{
+			writeU8(static_cast<uint8_t>(snapshot.mode));
+			writeVarint(snapshot.points.size());
+			for (const Eigen::Vector2d& point : snapshot.points) {
+				writeDouble(point.x());
+				writeDouble(point.y());
+			}
+			writeTour(snapshot.path);
+			writeDouble(snapshot.pathLength);
+			writeDouble(snapshot.temperature);
+			writeDouble(snapshot.tempDecay);
+			writeDouble(snapshot.threshold);
+			writeVarint(snapshot.population.size());
+			for (const std::vector<size_t>& individual : snapshot.population)
+				writeTour(individual);
+			writeU8(snapshot.localSearchQueueValid ? 1 : 0);
+			writeTour(snapshot.localSearchQueue);
+			writeVarint(snapshot.randomState.size());
+			writeBytes(snapshot.randomState.data(), snapshot.randomState.size());
+			writeDouble(snapshot.pathsPerSecond);
+			writeDouble(snapshot.generationsPerSecond);
+			writeDouble(snapshot.kicksPerSecond);
+			writeDouble(snapshot.avgAcceptanceProb);
+			writeVarint(snapshot.portfolio.size());
+			for (const SolverSnapshot& member : snapshot.portfolio)
+				writeSnapshot(member);
+		}
+
+	private:
+		std::vector<uint8_t>& m_buffer;
+	};
+
+	// Reads encoded values from a byte buffer. Every read checks the bounds
+	// of the buffer and returns false once the data runs out.
+	class Decoder {
+	public:
+		Decoder(const uint8_t* data, size_t size) : m_data{ data }, m_size{ size }, m_pos{ 0 } {}
+
+		bool readBytes(void* outData, size_t size)
+		{
+			if (size > m_size - m_pos)
+				return false;
+			std::memcpy(outData, m_data + m_pos, size);
+			m_pos += size;
+			return true;
+		}
+
+		bool readU8(uint8_t& outValue) { return readBytes(&outValue, 1); }
+
+		bool readU32(uint32_t& outValue)
+		{
+			uint8_t bytes[4];
+			if (!readBytes(bytes, sizeof(bytes)))
+				return false;
+			outValue = 0;
+			for (int i = 0; i < 4; ++i)
+				outValue |= static_cast<uint32_t>(bytes[i]) << (8 * i);
+			return true;
+		}
+
+		bool readDouble(double& outValue)
+		{
+			uint8_t bytes[8];
+			if (!readBytes(bytes, sizeof(bytes)))
+				return false;
+			uint64_t bits = 0;
+			for (int i = 0; i < 8; ++i)
+				bits |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+			std::memcpy(&outValue, &bits, sizeof(outValue));
+			return true;
+		}
+
+		bool readVarint(uint64_t& outValue)
+		{
+			outValue = 0;
+			for (int shift = 0; shift < 64; shift += 7) {
+				uint8_t byte;
+				if (!readU8(byte))
+					return false;
+				outValue |= static_cast<uint64_t>(byte & 0x7f) << shift;
+				if (!(byte & 0x80))
+					return true;
+			}
+			return false;
+		}
+
+		// Reads a count and checks that at least that many bytes remain,
+		// so corrupt counts cannot trigger huge allocations.
+		bool readCount(size_t& outCount, size_t minBytesEach)
+		{
+			uint64_t count;
+			if (!readVarint(count) || count > (m_size - m_pos) / minBytesEach)
+				return false;
+			outCount = static_cast<size_t>(count);
+			return true;
+		}
+
+		bool readTour(std::vector<size_t>& outTour)
+		{
+			size_t size;
+			if (!readCount(size, 1))
+				return false;
+			outTour.resize(size);
+			int64_t prev = 0;
+			for (size_t i = 0; i < size; ++i) {
+				uint64_t zigzag;
+				if (!readVarint(zigzag))
+					return false;
+				int64_t delta = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+				prev += delta;
+				if (prev < 0)
+					return false;
+				outTour[i] = static_cast<size_t>(prev);
+			}
+			return true;
+		}
+
+		bool readSnapshot(SolverSnapshot& outSnapshot, size_t depth)
+		{
+			uint8_t mode;
+			size_t pointCount;
+			if (!readU8(mode) || !readCount(pointCount, 16))
+				return false;
+			outSnapshot.mode = mode;
+			outSnapshot.points.resize(pointCount);
+			for (Eigen::Vector2d& point : outSnapshot.points) {
+				if (!readDouble(point.x()) || !readDouble(point.y()))
+					return false;
+			}
+
+			size_t populationSize;
+			if (!readTour(outSnapshot.path)
+			    || !readDouble(outSnapshot.pathLength)
+			    || !readDouble(outSnapshot.temperature)
+			    || !readDouble(outSnapshot.tempDecay)
+			    || !readDouble(outSnapshot.threshold)
+			    || !readCount(populationSize, 1))
+				return false;
+			outSnapshot.population.resize(populationSize);
+			for (std::vector<size_t>& individual : outSnapshot.population) {
+				if (!readTour(individual))
+					return false;
+			}
+
+			uint8_t queueValid;
+			size_t randomStateSize;
+			if (!readU8(queueValid)
+			    || !readTour(outSnapshot.localSearchQueue)
+			    || !readCount(randomStateSize, 1))
+				return false;
+			outSnapshot.localSearchQueueValid = queueValid != 0;
+			outSnapshot.randomState.resize(randomStateSize);
+			if (randomStateSize > 0 && !readBytes(&outSnapshot.randomState[0], randomStateSize))
+				return false;
+
+			size_t portfolioSize;
+			if (!readDouble(outSnapshot.pathsPerSecond)
+			    || !readDouble(outSnapshot.generationsPerSecond)
+			    || !readDouble(outSnapshot.kicksPerSecond)
+			    || !readDouble(outSnapshot.avgAcceptanceProb)
+			    || !readCount(portfolioSize, 1))
+				return false;
+			if (portfolioSize > 0 && depth >= s_kMaxDepth)
+				return false;
+			outSnapshot.portfolio.resize(portfolioSize);
+			for (SolverSnapshot& member : outSnapshot.portfolio) {
+				if (!readSnapshot(member, depth + 1))
+					return false;
+			}
+			return true;
+		}
+
+		bool atEnd() const { return m_pos == m_size; }
+
+	private:
+		const uint8_t* m_data;
+		size_t m_size;
+		size_t m_pos;
+	};
+}
+
+SolverSnapshot::SolverSnapshot()
+	: mode{ 0 }
+	, pathLength{ 0 }
+	, temperature{ 0 }
+	, tempDecay{ 0 }
+	, threshold{ 0 }
+	, localSearchQueueValid{ false }
+	, pathsPerSecond{ 0 }
+	, generationsPerSecond{ 0 }
+	, kicksPerSecond{ 0 }
+	, avgAcceptanceProb{ 0 }
+{
+}
+
+bool saveCheckpoint(const std::string& fileName, const SolverSnapshot& snapshot)
+{
+	std::vector<uint8_t> buffer;
+	Encoder encoder{ buffer };
+	encoder.writeBytes(s_kMagic, sizeof(s_kMagic));
+	encoder.writeU32(s_kVersion);
+	encoder.writeSnapshot(snapshot);
+	encoder.writeU32(fnv1a(buffer.data(), buffer.size()));
+
+	std::string tempFileName = fileName + ".tmp";
+	{
+		std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+		file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+		if (!file)
+			return false;
+	}
+
+	// Replace the old checkpoint in a single step, so that there is always
+	// a complete one on disk. rename does not replace existing files on
+	// Windows, but MoveFileEx can.
+#ifdef _WIN32
+	return MoveFileExA(tempFileName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return std::rename(tempFileName.c_str(), fileName.c_str()) == 0;
+#endif
+}
+
+bool loadCheckpoint(const std::string& fileName, SolverSnapshot& outSnapshot)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file)
+		return false;
+	std::vector<uint8_t> buffer{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+	const size_t kHeaderSize = sizeof(s_kMagic) + 4;
+	const size_t kChecksumSize = 4;
+	if (buffer.size() < kHeaderSize + kChecksumSize)
+		return false;
+
+	size_t bodyEnd = buffer.size() - kChecksumSize;
+	Decoder checksumDecoder{ buffer.data() + bodyEnd, kChecksumSize };
+	uint32_t checksum;
+	if (!checksumDecoder.readU32(checksum) || checksum != fnv1a(buffer.data(), bodyEnd))
+		return false;
+
+	Decoder decoder{ buffer.data(), bodyEnd };
+	char magic[sizeof(s_kMagic)];
+	uint32_t version;
+	if (!decoder.readBytes(magic, sizeof(magic))
+	    || std::memcmp(magic, s_kMagic, sizeof(magic)) != 0
+	    || !decoder.readU32(version)
+	    || version != s_kVersion)
+		return false;
+
+	return decoder.readSnapshot(outSnapshot, 0) && decoder.atEnd();
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& fileName)
+	: m_fileName{ fileName }
+	, m_quit{ false }
+{
+	m_thread = std::thread(&CheckpointWriter::run, this);
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_quit = true;
+	lock.unlock();
+	m_condition.notify_one();
+	m_thread.join();
+}
+
+void CheckpointWriter::submit(std::unique_ptr<SolverSnapshot> snapshot)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_pending = std::move(snapshot);
+	lock.unlock();
+	m_condition.notify_one();
+}
+
+void CheckpointWriter::run()
+{
+	setTraceThreadName("Checkpoint Writer");
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true) {
+		m_condition.wait(lock, [this]() { return m_pending || m_quit; });
+		if (!m_pending)
+			return;
+
+		// Encode and write without holding the lock so submit never waits
+		// on the disk
+		std::unique_ptr<SolverSnapshot> snapshot = std::move(m_pending);
+		lock.unlock();
+		{
+			TRACE_SCOPE("Write Checkpoint");
+			saveCheckpoint(m_fileName, *snapshot);
+			snapshot.reset();
+		}
+		lock.lock();
+	}
+}
@@ -0,0 +1,96 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Saving and loading of solver state to a compact, versioned
+//                binary checkpoint file, plus a background writer so that
+//                solvers can checkpoint without waiting on the disk.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Geometry.h"
+
+// Solver state captured at one point in time. Holds everything needed to
+// continue a run.
+struct SolverSnapshot {
+	SolverSnapshot();
+
+	int mode;
+
+	// Node positions. Empty for portfolio members, which share the
+	// positions of the snapshot that contains them.
+	PointList points;
+
+	std::vector<size_t> path;
+	double pathLength;
+	double temperature;
+	double tempDecay;
+	double threshold;
+	std::vector<std::vector<size_t>> population;
+	bool localSearchQueueValid;
+	std::vector<size_t> localSearchQueue;
+
+	// Random generator state as written by operator<<, or empty if the
+	// solver has not run yet.
+	std::string randomState;
+
+	double pathsPerSecond;
+	double generationsPerSecond;
+	double kicksPerSecond;
+	double avgAcceptanceProb;
+
+	// Snapshots of the solvers in a portfolio.
+	std::vector<SolverSnapshot> portfolio;
+};
+
+// Writes a snapshot to a checkpoint file. The file is written under a
+// temporary name first so an existing checkpoint is never left half
+// written.
+// Returns false if the file could not be written.
+bool saveCheckpoint(const std::string& fileName, const SolverSnapshot& snapshot);
+
+// Reads a snapshot from a checkpoint file.
+// Returns false if the file could not be read, has an unknown version or is
+// corrupt, in which case outSnapshot is left unspecified.
+bool loadCheckpoint(const std::string& fileName, SolverSnapshot& outSnapshot);
+
+// Writes snapshots to a checkpoint file on a background thread.
+class CheckpointWriter {
+public:
+	explicit CheckpointWriter(const std::string& fileName);
+
+	// Writes any pending snapshot before returning.
+	~CheckpointWriter();
+
+	// Hands a snapshot to the writer thread and returns immediately.
+	// If the previous snapshot has not been written yet it is replaced,
+	// since only the latest state is worth keeping.
+	void submit(std::unique_ptr<SolverSnapshot> snapshot);
+
+	const std::string& getFileName() const { return m_fileName; }
+
+private:
+	// Writer thread main loop.
+	void run();
+
+	std::string m_fileName;
+	std::unique_ptr<SolverSnapshot> m_pending;
+	bool m_quit;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::thread m_thread;
+};
@@ -0,0 +1,72 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Memory bounded history of a solver's progress over time.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <algorithm>
+
+#include "ConvergenceHistory.h"
+
+ConvergenceHistory::ConvergenceHistory(size_t capacity)
+	: m_capacity{ std::max<size_t>(2, capacity + capacity % 2) }
+	, m_stride{ 1 }
+	, m_offered{ 0 }
+	, m_latest{}
+	, m_hasLatest{ false }
+	, m_latestKept{ false }
+{
+	m_samples.reserve(m_capacity);
+}
+
+void ConvergenceHistory::record(double seconds, double pathLength, double temperature, double acceptanceRate)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	double bestPathLength = m_hasLatest ? std::min(m_latest.bestPathLength, pathLength) : pathLength;
+	m_latest = ConvergenceSample{ seconds, bestPathLength, pathLength, temperature, acceptanceRate };
+	m_hasLatest = true;
+	m_latestKept = false;
+
+	if (++m_offered < m_stride)
+		return;
+	m_offered = 0;
+
+	// Halve the resolution when full. Keeping the even samples keeps the
+	// spacing even, since they are exactly the new stride apart.
+	if (m_samples.size() == m_capacity) {
+		for (size_t i = 0; i < m_capacity / 2; ++i)
+			m_samples[i] = m_samples[2 * i];
+		m_samples.resize(m_capacity / 2);
+		m_stride *= 2;
+	}
+
+	m_samples.push_back(m_latest);
+	m_latestKept = true;
+}
+
+void ConvergenceHistory::clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_samples.clear();
+	m_stride = 1;
+	m_offered = 0;
+	m_hasLatest = false;
+	m_latestKept = false;
+}
+
+std::vector<ConvergenceSample> ConvergenceHistory::getSamples() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::vector<ConvergenceSample> samples = m_samples;
+	if (m_hasLatest && !m_latestKept)
+		samples.push_back(m_latest);
+	return samples;
+}
@@ -0,0 +1,71 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Memory bounded history of a solver's progress over time.
+//                Samples are offered at the solvers' stats report interval,
+//                never from the inner loops. Once the buffer is full every
+//                other sample is dropped and the sampling stride doubles,
+//                so the history always spans the whole run at an evenly
+//                spaced, ever coarser resolution.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+struct ConvergenceSample {
+	// Solver running time, excluding time spent stopped.
+	double seconds;
+
+	double bestPathLength;
+	double pathLength;
+
+	// Annealing temperature or threshold accepting threshold, or 0 for
+	// solvers without one.
+	double temperature;
+
+	// Fraction of moves tried since the previous sample that were accepted.
+	double acceptanceRate;
+};
+
+class ConvergenceHistory {
+public:
+	// Keeps at most capacity samples. The capacity is rounded up to an even
+	// number of at least 2.
+	explicit ConvergenceHistory(size_t capacity = s_kDefaultCapacity);
+
+	// Offers a sample. The best path length is tracked over every offered
+	// sample, including those that are not kept.
+	void record(double seconds, double pathLength, double temperature, double acceptanceRate);
+
+	// Removes all samples and resets the stride.
+	void clear();
+
+	// Returns the kept samples in time order, followed by the latest
+	// offered sample if it was not kept.
+	std::vector<ConvergenceSample> getSamples() const;
+
+	static const size_t s_kDefaultCapacity = 1024;
+
+private:
+	mutable std::mutex m_mutex;
+	std::vector<ConvergenceSample> m_samples;
+	size_t m_capacity;
+
+	// Only every m_stride-th offered sample is kept. m_offered counts the
+	// samples offered since the last one was kept.
+	size_t m_stride;
+	size_t m_offered;
+
+	ConvergenceSample m_latest;
+	bool m_hasLatest;
+	bool m_latestKept;
+};
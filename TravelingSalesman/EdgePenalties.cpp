@@ -0,0 +1,60 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Edge penalties of guided local search.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <algorithm>
+
+#include "EdgePenalties.h"
+
+EdgePenalties::EdgePenalties(const PointList& points, const NeighbourLists& neighbours)
+	: m_points{ points }
+	, m_neighbours{ neighbours }
+	, m_candidatePenalties(points.size() * neighbours.getNeighbourCount(), 0)
+	, m_cityPenaltyCounts(points.size(), 0)
+	, m_penaltyWeight{ 0 }
+{
+}
+
+uint32_t EdgePenalties::lookup(size_t a, size_t b) const
+{
+	size_t k = m_neighbours.getNeighbourCount();
+	size_t i = m_neighbours.findNeighbour(a, b);
+	if (i < k)
+		return m_candidatePenalties[a * k + i];
+	i = m_neighbours.findNeighbour(b, a);
+	if (i < k)
+		return m_candidatePenalties[b * k + i];
+
+	auto it = m_otherPenalties.find(getEdgeKey(a, b));
+	return it == m_otherPenalties.end() ? 0 : it->second;
+}
+
+void EdgePenalties::penalise(size_t a, size_t b)
+{
+	++m_cityPenaltyCounts[a];
+	++m_cityPenaltyCounts[b];
+
+	size_t k = m_neighbours.getNeighbourCount();
+	size_t ab = m_neighbours.findNeighbour(a, b);
+	size_t ba = m_neighbours.findNeighbour(b, a);
+	if (ab < k)
+		++m_candidatePenalties[a * k + ab];
+	if (ba < k)
+		++m_candidatePenalties[b * k + ba];
+	if (ab == k && ba == k)
+		++m_otherPenalties[getEdgeKey(a, b)];
+}
+
+uint64_t EdgePenalties::getEdgeKey(size_t a, size_t b)
+{
+	return static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b);
+}
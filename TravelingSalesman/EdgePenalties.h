@@ -0,0 +1,128 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Edge penalties of guided local search, which raise the cost
+//                of edges that keep showing up in local optima so that local
+//                search is pushed out of them.
+//                Penalties of candidate edges are stored next to the
+//                neighbour lists and any others in a hash map. Most cities
+//                have no penalised edges at all, which is checked first so
+//                that looking up an unpenalised edge is almost free.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Geometry.h"
+#include "NeighbourLists.h"
+
+class EdgePenalties {
+public:
+	EdgePenalties(const PointList& points, const NeighbourLists& neighbours);
+
+	// Returns the number of times the edge between a and b was penalised.
+	uint32_t get(size_t a, size_t b) const
+	{
+		if (m_cityPenaltyCounts[a] == 0 || m_cityPenaltyCounts[b] == 0)
+			return 0;
+		return lookup(a, b);
+	}
+
+	// Penalises the edges of the tour with the highest utility, i.e. the
+	// longest edges relative to how often they have been penalised already.
+	// Only the scanLength edges following the city are considered, so that
+	// penalising a large tour does not cost O(n).
+	// Outputs the cities at the ends of the penalised edges, and returns the
+	// city after the last edge looked at, where the next call can carry on.
+	template <typename TourT>
+	size_t penaliseTour(const TourT& tour, size_t city, size_t scanLength, std::vector<size_t>& outCities);
+
+	// Sets the cost of one penalty, which the guided local search paper
+	// suggests setting relative to the average edge length of a local
+	// optimum.
+	void setPenaltyWeight(double weight) { m_penaltyWeight = weight; }
+	double getPenaltyWeight() const { return m_penaltyWeight; }
+
+	// Returns true if the penalty weight has been set.
+	bool hasPenaltyWeight() const { return m_penaltyWeight > 0; }
+
+private:
+	// Returns the penalty of an edge whose ends both have penalised edges.
+	uint32_t lookup(size_t a, size_t b) const;
+
+	// Adds a penalty to the edge between a and b.
+	void penalise(size_t a, size_t b);
+
+	static uint64_t getEdgeKey(size_t a, size_t b);
+
+	const PointList& m_points;
+	const NeighbourLists& m_neighbours;
+
+	// Penalties of candidate edges, indexed like the neighbour lists. Both
+	// directions of an edge are kept up to date.
+	std::vector<uint32_t> m_candidatePenalties;
+
+	// Penalties of edges that are not candidates of either end.
+	std::unordered_map<uint64_t, uint32_t> m_otherPenalties;
+
+	// Number of penalised edges at each city, counting repeats.
+	std::vector<uint32_t> m_cityPenaltyCounts;
+
+	double m_penaltyWeight;
+
+	// Scratch space for penaliseTour.
+	std::vector<size_t> m_maxUtilityEdges;
+};
+
+// Edge cost of guided local search, the distance plus the edge's penalties.
+class PenalisedCost {
+public:
+	explicit PenalisedCost(const EdgePenalties& penalties) : m_penalties{ &penalties } {}
+
+	// Returns the cost of the edge between a and b, given their distance.
+	double operator()(size_t a, size_t b, double distance) const
+	{
+		return distance + m_penalties->getPenaltyWeight() * m_penalties->get(a, b);
+	}
+
+private:
+	const EdgePenalties* m_penalties;
+};
+
+template <typename TourT>
+size_t EdgePenalties::penaliseTour(const TourT& tour, size_t city, size_t scanLength, std::vector<size_t>& outCities)
+{
+	// Ties are all penalised, as in the guided local search paper
+	double maxUtility = -1;
+	m_maxUtilityEdges.clear();
+	for (size_t i = 0; i < scanLength; ++i) {
+		size_t next = tour.next(city);
+		double utility = euclideanDist(m_points, city, next) / (1 + get(city, next));
+		if (utility > maxUtility) {
+			maxUtility = utility;
+			m_maxUtilityEdges.clear();
+		}
+		if (utility == maxUtility)
+			m_maxUtilityEdges.push_back(city);
+		city = next;
+	}
+
+	outCities.clear();
+	for (size_t from : m_maxUtilityEdges) {
+		size_t to = tour.next(from);
+		penalise(from, to);
+		outCities.push_back(from);
+		outCities.push_back(to);
+	}
+	return city;
+}
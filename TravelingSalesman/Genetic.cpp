@@ -0,0 +1,100 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Selection, crossover and mutation operators used by the 
+//                genetic algorithm solver.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+#include "Genetic.h"
+#include "Utils.h"
+
+const std::vector<size_t>& selectBest(const PointList& points, const std::vector<std::vector<size_t>>& selectionPool, double* outPathLength)
+{
+	size_t bestPathIdx = 0;
+	double bestPathLength = calculatePathLength(points, selectionPool.at(bestPathIdx));
+	for (size_t i = 1; i < selectionPool.size(); ++i) {
+		double candidatePathLength = calculatePathLength(points, selectionPool.at(i));
+		if (candidatePathLength < bestPathLength) {
+			bestPathLength = candidatePathLength;
+			bestPathIdx = i;
+		}
+	}
+
+	if (outPathLength)
+		*outPathLength = bestPathLength;
+
+	return selectionPool.at(bestPathIdx);
+}
+
+std::vector<size_t> crossover(const std::vector<size_t>& parent1, const std::vector<size_t>& parent2)
+{
+	assert(parent1.size() == parent2.size());
+
+	size_t cutPoint = randomInt(static_cast<size_t>(0), parent1.size());
+	std::vector<size_t> childPath(parent1.size());
+
+	// Take genes from parent 1
+	for (size_t i = 0; i < cutPoint; ++i) {
+		childPath.at(i) = parent1.at(i);
+	}
+
+	// Take genes from parent 2
+	for (size_t i = cutPoint; i < parent2.size(); ++i) {
+		// Make sure we don't take duplicate nodes
+		auto curChildPathEnd = std::next(childPath.begin(), i);
+		if (notIn(childPath.begin(), curChildPathEnd, parent2.at(i)))
+			childPath.at(i) = parent2.at(i);
+		else if (notIn(childPath.begin(), curChildPathEnd, parent1.at(i)))
+			childPath.at(i) = parent1.at(i);
+		else {
+			// If we couldn't take either of the parents nodes at this position,
+			// then walk backwards over both parents and select the first unused
+			// node.
+			for (size_t j = i; j-- > 0;) {
+				if (notIn(childPath.begin(), curChildPathEnd, parent2.at(j))) {
+					childPath.at(i) = parent2.at(j);
+					break;
+				}
+				if (notIn(childPath.begin(), curChildPathEnd, parent1.at(j))) {
+					childPath.at(i) = parent1.at(j);
+					break;
+				}
+			}
+		}
+	}
+
+	return childPath;
+}
+
+std::vector<size_t>& mutate(std::vector<size_t>& path)
+{
+	const double kMutationSelectionProbability = 0.5;
+	auto it1 = selectRandomly(path.begin(), path.end());
+	auto it2 = selectRandomly(path.begin(), path.end());
+	if (randomReal() < kMutationSelectionProbability) {
+		// Mutate by swapping two nodes in the path
+		std::swap(*it1, *it2);
+	} else {
+		// Mutate by selecting two nodes in the path and 
+		// reversing the order of all nodes between them
+		auto it1Idx = std::distance(path.begin(), it1);
+		auto it2Idx = std::distance(path.begin(), it2);
+		if (it1Idx < it2Idx)
+			std::reverse(it1, std::next(it2));
+		else
+			std::reverse(it2, std::next(it1));
+	}
+
+	return path;
+}
@@ -0,0 +1,29 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Selection, crossover and mutation operators used by the 
+//                genetic algorithm solver.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <vector>
+
+#include "Geometry.h"
+
+// Selects the best candidate path from a list.
+// Takes an optional pointer to output the path length into.
+const std::vector<size_t>& selectBest(const PointList& points, const std::vector<std::vector<size_t>>& selectionPool, double* outPathLength = nullptr);
+
+// Constructs a new path from two other parent paths
+std::vector<size_t> crossover(const std::vector<size_t>& parent1, const std::vector<size_t>& parent2);
+
+// Mutates the path in place and returns the result
+std::vector<size_t>& mutate(std::vector<size_t>& path);
@@ -0,0 +1,57 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Point storage and distance functions shared by the solvers.
+//                Cities are referred to by their index into a PointList.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <vector>
+#include <cmath>
+
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+
+// A list of city positions, indexed by city.
+using PointList = std::vector<Eigen::Vector2d, Eigen::aligned_allocator<Eigen::Vector2d>>;
+
+// Returns the squared distance between two points.
+inline double euclideanDistSquared(const Eigen::Vector2d& src, const Eigen::Vector2d& dst)
+{
+	Eigen::Vector2d displacement = dst - src;
+	return displacement.dot(displacement);
+}
+
+// Returns the distance between two points.
+inline double euclideanDist(const Eigen::Vector2d& src, const Eigen::Vector2d& dst)
+{
+	return std::sqrt(euclideanDistSquared(src, dst));
+}
+
+// Returns the distance between two cities.
+inline double euclideanDist(const PointList& points, size_t src, size_t dst)
+{
+	return euclideanDist(points[src], points[dst]);
+}
+
+// Calculates the total length of a closed tour visiting the cities in the
+// order given by path.
+inline double calculatePathLength(const PointList& points, const std::vector<size_t>& path)
+{
+	double accumDist = 0;
+	for (size_t i = 0; i < path.size(); ++i) {
+		size_t from = path[i];
+		size_t to = path[(i + 1) % path.size()];
+		accumDist += euclideanDist(points, from, to);
+	}
+
+	return accumDist;
+}
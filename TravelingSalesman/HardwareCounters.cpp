@@ -0,0 +1,178 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Hardware performance counters for the calling thread, read
+//                through perf_event_open on Linux.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include "HardwareCounters.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif // __linux__
+
+HardwareCounterValues::HardwareCounterValues()
+	: values{}
+	, available{}
+	, solverThreadOnly{ false }
+{
+}
+
+HardwareCounterValues& HardwareCounterValues::operator+=(const HardwareCounterValues& other)
+{
+	for (size_t i = 0; i < CounterCount; ++i) {
+		values[i] += other.values[i];
+		available[i] = available[i] || other.available[i];
+	}
+	solverThreadOnly = solverThreadOnly || other.solverThreadOnly;
+	return *this;
+}
+
+HardwareCounterValues& HardwareCounterValues::operator-=(const HardwareCounterValues& other)
+{
+	for (size_t i = 0; i < CounterCount; ++i)
+		values[i] = values[i] > other.values[i] ? values[i] - other.values[i] : 0;
+	return *this;
+}
+
+double HardwareCounterValues::getInstructionsPerCycle() const
+{
+	if (values[Cycles] == 0)
+		return 0;
+	return static_cast<double>(values[Instructions]) / values[Cycles];
+}
+
+std::string HardwareCounterValues::getCounterName(Counter counter)
+{
+	switch (counter) {
+	case Cycles:
+		return "Cycles";
+	case Instructions:
+		return "Instructions";
+	case CacheMisses:
+		return "Cache Misses";
+	case BranchMisses:
+		return "Branch Misses";
+	case TlbMisses:
+		return "TLB Misses";
+	default:
+		return "";
+	}
+}
+
+#ifdef __linux__
+
+namespace {
+	int openCounter(uint32_t type, uint64_t config, int groupFd)
+	{
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+
+		// Only the solver's own work is of interest, and counting user
+		// space alone is allowed at the default paranoia level
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		if (groupFd == -1)
+			attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0));
+	}
+}
+
+HardwareCounters::HardwareCounters()
+{
+	const uint64_t kTlbReadMiss = PERF_COUNT_HW_CACHE_DTLB
+	                            | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+	                            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+	m_fds[HardwareCounterValues::Cycles] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+	int leader = m_fds[HardwareCounterValues::Cycles];
+
+	// Counters missing from the CPU (common in virtual machines) are left
+	// out without giving up on the rest
+	bool hasLeader = leader != -1;
+	m_fds[HardwareCounterValues::Instructions] = hasLeader ? openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, leader) : -1;
+	m_fds[HardwareCounterValues::CacheMisses] = hasLeader ? openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, leader) : -1;
+	m_fds[HardwareCounterValues::BranchMisses] = hasLeader ? openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, leader) : -1;
+	m_fds[HardwareCounterValues::TlbMisses] = hasLeader ? openCounter(PERF_TYPE_HW_CACHE, kTlbReadMiss, leader) : -1;
+}
+
+HardwareCounters::~HardwareCounters()
+{
+	// Close the leader last
+	for (size_t i = HardwareCounterValues::CounterCount; i-- > 0;) {
+		if (m_fds[i] != -1)
+			close(m_fds[i]);
+	}
+}
+
+bool HardwareCounters::isAvailable() const
+{
+	return m_fds[HardwareCounterValues::Cycles] != -1;
+}
+
+HardwareCounterValues HardwareCounters::read() const
+{
+	HardwareCounterValues result;
+	if (!isAvailable())
+		return result;
+
+	// Layout of a group read: member count, time enabled, time running,
+	// then one value per member in the order they were opened
+	uint64_t data[3 + HardwareCounterValues::CounterCount];
+	ssize_t bytesRead = ::read(m_fds[HardwareCounterValues::Cycles], data, sizeof(data));
+	if (bytesRead < static_cast<ssize_t>(3 * sizeof(uint64_t)))
+		return result;
+
+	uint64_t memberCount = data[0];
+	uint64_t timeEnabled = data[1];
+	uint64_t timeRunning = data[2];
+	double scale = timeRunning > 0 ? static_cast<double>(timeEnabled) / timeRunning : 0;
+
+	size_t member = 0;
+	for (size_t i = 0; i < HardwareCounterValues::CounterCount && member < memberCount; ++i) {
+		if (m_fds[i] == -1)
+			continue;
+		result.values[i] = static_cast<uint64_t>(data[3 + member] * scale);
+		result.available[i] = true;
+		++member;
+	}
+	return result;
+}
+
+#else
+
+HardwareCounters::HardwareCounters()
+{
+	for (int& fd : m_fds)
+		fd = -1;
+}
+
+HardwareCounters::~HardwareCounters()
+{
+}
+
+bool HardwareCounters::isAvailable() const
+{
+	return false;
+}
+
+HardwareCounterValues HardwareCounters::read() const
+{
+	return HardwareCounterValues();
+}
+
+#endif // __linux__
@@ -0,0 +1,78 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Hardware performance counters (cycles, instructions, cache
+//                misses, branch mispredictions and TLB misses) for the
+//                calling thread, read through perf_event_open.
+//                Only Linux is supported. On other platforms, or when the
+//                kernel refuses access (see
+//                /proc/sys/kernel/perf_event_paranoid), the counters report
+//                themselves as unavailable and read as zero.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Counter readings, or the difference between two readings.
+struct HardwareCounterValues {
+	enum Counter {
+		Cycles,
+		Instructions,
+		CacheMisses,
+		BranchMisses,
+		TlbMisses,
+		CounterCount
+	};
+
+	HardwareCounterValues();
+
+	HardwareCounterValues& operator+=(const HardwareCounterValues& other);
+	HardwareCounterValues& operator-=(const HardwareCounterValues& other);
+
+	// Returns instructions per cycle, or 0 if either was not counted.
+	double getInstructionsPerCycle() const;
+
+	// Returns a display name for a counter.
+	static std::string getCounterName(Counter counter);
+
+	uint64_t values[CounterCount];
+
+	// False for counters the CPU or kernel could not provide.
+	bool available[CounterCount];
+
+	// True if part of the counted work ran on helper threads that the
+	// counters do not follow, so the values only cover the solver thread.
+	bool solverThreadOnly;
+};
+
+// Counts hardware events on the thread that created it, from construction
+// until destruction. Must only be read from that thread.
+class HardwareCounters {
+public:
+	HardwareCounters();
+	~HardwareCounters();
+
+	HardwareCounters(const HardwareCounters&) = delete;
+	HardwareCounters& operator=(const HardwareCounters&) = delete;
+
+	// Returns true if at least the cycle counter could be opened.
+	bool isAvailable() const;
+
+	// Returns the events counted since construction. Counters the kernel
+	// had to multiplex are scaled up to estimate the full count.
+	HardwareCounterValues read() const;
+
+private:
+	// The cycle counter leads a group so that all counters are scheduled
+	// onto the PMU together.
+	int m_fds[HardwareCounterValues::CounterCount];
+};
@@ -0,0 +1,266 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Reading and writing of problem instances, either in the 
+//                TSPLIB text format to share them with other tools, or in a 
+//                compact binary format for instances with millions of nodes.
+//
+//                Binary layout (all values little endian):
+//                  "TSPI", uint32 version, uint64 node count,
+//                  node count * (double x, double y), uint32 FNV-1a checksum
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "Instance.h"
+
+namespace {
+	const char s_kMagic[4] = { 'T', 'S', 'P', 'I' };
+	const uint32_t s_kVersion = 1;
+
+	// Nodes are encoded and checksummed in blocks of this many, so huge
+	// instances never need a second full size buffer.
+	const size_t s_kBlockSize = 65536;
+
+	const size_t s_kHeaderSize = sizeof(s_kMagic) + 4 + 8;
+	const size_t s_kNodeSize = 16;
+	const size_t s_kChecksumSize = 4;
+
+	// Continues an FNV-1a hash over more data.
+	uint32_t fnv1a(const uint8_t* data, size_t size, uint32_t hash = 2166136261u)
+	{
+		for (size_t i = 0; i < size; ++i) {
+			hash ^= data[i];
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	void encodeU64(uint64_t value, size_t byteCount, uint8_t* outBytes)
+	{
+		for (size_t i = 0; i < byteCount; ++i)
+			outBytes[i] = static_cast<uint8_t>(value >> (8 * i));
+	}
+
+	uint64_t decodeU64(const uint8_t* bytes, size_t byteCount)
+	{
+		uint64_t value = 0;
+		for (size_t i = 0; i < byteCount; ++i)
+			value |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+		return value;
+	}
+
+	void encodeDouble(double value, uint8_t* outBytes)
+	{
+		uint64_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		encodeU64(bits, 8, outBytes);
+	}
+
+	double decodeDouble(const uint8_t* bytes)
+	{
+		uint64_t bits = decodeU64(bytes, 8);
+		double value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	// Removes leading and trailing whitespace.
+	std::string trim(const std::string& str)
+	{
+		const char* kWhitespace = " \t\r\n";
+		size_t begin = str.find_first_not_of(kWhitespace);
+		if (begin == std::string::npos)
+			return "";
+		size_t end = str.find_last_not_of(kWhitespace);
+		return str.substr(begin, end - begin + 1);
+	}
+}
+
+bool loadTsplib(const std::string& fileName, PointList& outPoints)
+{
+	std::ifstream file(fileName);
+	if (!file)
+		return false;
+
+	// Read the "KEY : VALUE" specification part
+	size_t dimension = 0;
+	bool hasCoordinates = false;
+	std::string line;
+	while (std::getline(file, line)) {
+		line = trim(line);
+		if (line == "NODE_COORD_SECTION") {
+			hasCoordinates = true;
+			break;
+		}
+		if (line.empty())
+			continue;
+
+		size_t colon = line.find(':');
+		std::string key = trim(line.substr(0, colon));
+		std::string value = colon == std::string::npos ? "" : trim(line.substr(colon + 1));
+		if (key == "TYPE" && value != "TSP") {
+			return false;
+		}
+		else if (key == "DIMENSION") {
+			std::istringstream(value) >> dimension;
+		}
+		else if (key == "EDGE_WEIGHT_TYPE" && value != "EUC_2D" && value != "CEIL_2D" && value != "ATT") {
+			return false;
+		}
+		else if (key == "EOF") {
+			break;
+		}
+	}
+	if (!hasCoordinates || dimension == 0)
+		return false;
+
+	// Nodes are numbered from 1 and may be listed in any order
+	outPoints.assign(dimension, Eigen::Vector2d::Zero());
+	std::vector<bool> seen(dimension, false);
+	for (size_t i = 0; i < dimension; ++i) {
+		size_t id;
+		double x, y;
+		if (!(file >> id >> x >> y) || id < 1 || id > dimension || seen.at(id - 1))
+			return false;
+		seen.at(id - 1) = true;
+		outPoints.at(id - 1) = { x, y };
+	}
+
+	return true;
+}
+
+bool saveTsplib(const std::string& fileName, const PointList& points, const std::string& name)
+{
+	std::string tempFileName = fileName + ".tmp";
+	std::ofstream file(tempFileName);
+	if (!file)
+		return false;
+
+	file << "NAME : " << name << "\n";
+	file << "TYPE : TSP\n";
+	file << "DIMENSION : " << points.size() << "\n";
+	file << "EDGE_WEIGHT_TYPE : EUC_2D\n";
+	file << "NODE_COORD_SECTION\n";
+
+	// Enough digits to read back the exact same doubles
+	file.precision(17);
+	for (size_t i = 0; i < points.size(); ++i)
+		file << i + 1 << " " << points.at(i).x() << " " << points.at(i).y() << "\n";
+	file << "EOF\n";
+
+	file.close();
+	if (!file)
+		return false;
+
+	// Replace the old file only once the new one is complete
+	std::remove(fileName.c_str());
+	return std::rename(tempFileName.c_str(), fileName.c_str()) == 0;
+}
+
+bool saveBinaryInstance(const std::string& fileName, const PointList& points)
+{
+	std::string tempFileName = fileName + ".tmp";
+	{
+		std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+
+		uint8_t header[s_kHeaderSize];
+		std::memcpy(header, s_kMagic, sizeof(s_kMagic));
+		encodeU64(s_kVersion, 4, header + 4);
+		encodeU64(points.size(), 8, header + 8);
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		uint32_t checksum = fnv1a(header, sizeof(header));
+
+		std::vector<uint8_t> block(s_kBlockSize * s_kNodeSize);
+		for (size_t begin = 0; begin < points.size(); begin += s_kBlockSize) {
+			size_t end = std::min(begin + s_kBlockSize, points.size());
+			for (size_t i = begin; i < end; ++i) {
+				encodeDouble(points[i].x(), &block[(i - begin) * s_kNodeSize]);
+				encodeDouble(points[i].y(), &block[(i - begin) * s_kNodeSize + 8]);
+			}
+			size_t blockBytes = (end - begin) * s_kNodeSize;
+			file.write(reinterpret_cast<const char*>(block.data()), blockBytes);
+			checksum = fnv1a(block.data(), blockBytes, checksum);
+		}
+
+		uint8_t checksumBytes[s_kChecksumSize];
+		encodeU64(checksum, s_kChecksumSize, checksumBytes);
+		file.write(reinterpret_cast<const char*>(checksumBytes), sizeof(checksumBytes));
+		if (!file)
+			return false;
+	}
+
+	// rename does not replace existing files on Windows
+	std::remove(fileName.c_str());
+	return std::rename(tempFileName.c_str(), fileName.c_str()) == 0;
+}
+
+bool loadBinaryInstance(const std::string& fileName, PointList& outPoints)
+{
+	std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+	uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+	file.seekg(0);
+
+	uint8_t header[s_kHeaderSize];
+	if (!file.read(reinterpret_cast<char*>(header), sizeof(header))
+	    || std::memcmp(header, s_kMagic, sizeof(s_kMagic)) != 0
+	    || decodeU64(header + 4, 4) != s_kVersion)
+		return false;
+
+	// The count must match the file size, so a corrupt count cannot 
+	// trigger a huge allocation
+	uint64_t count = decodeU64(header + 8, 8);
+	if (fileSize < s_kHeaderSize + s_kChecksumSize
+	    || count != (fileSize - s_kHeaderSize - s_kChecksumSize) / s_kNodeSize
+	    || (fileSize - s_kHeaderSize - s_kChecksumSize) % s_kNodeSize != 0)
+		return false;
+	uint32_t checksum = fnv1a(header, sizeof(header));
+
+	outPoints.resize(static_cast<size_t>(count));
+	std::vector<uint8_t> block(s_kBlockSize * s_kNodeSize);
+	for (size_t begin = 0; begin < outPoints.size(); begin += s_kBlockSize) {
+		size_t end = std::min(begin + s_kBlockSize, outPoints.size());
+		size_t blockBytes = (end - begin) * s_kNodeSize;
+		if (!file.read(reinterpret_cast<char*>(block.data()), blockBytes))
+			return false;
+		checksum = fnv1a(block.data(), blockBytes, checksum);
+		for (size_t i = begin; i < end; ++i) {
+			outPoints[i] = { decodeDouble(&block[(i - begin) * s_kNodeSize]),
+			                 decodeDouble(&block[(i - begin) * s_kNodeSize + 8]) };
+		}
+	}
+
+	uint8_t checksumBytes[s_kChecksumSize];
+	return file.read(reinterpret_cast<char*>(checksumBytes), sizeof(checksumBytes))
+	    && decodeU64(checksumBytes, s_kChecksumSize) == checksum;
+}
+
+bool loadInstance(const std::string& fileName, PointList& outPoints)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	char magic[sizeof(s_kMagic)];
+	if (!file.read(magic, sizeof(magic)))
+		return false;
+	file.close();
+
+	if (std::memcmp(magic, s_kMagic, sizeof(magic)) == 0)
+		return loadBinaryInstance(fileName, outPoints);
+	return loadTsplib(fileName, outPoints);
+}
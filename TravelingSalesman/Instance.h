@@ -0,0 +1,45 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Reading and writing of problem instances, either in the 
+//                TSPLIB text format to share them with other tools, or in a 
+//                compact binary format for instances with millions of nodes.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <string>
+
+#include "Geometry.h"
+
+// Reads the node coordinates of a TSPLIB instance with a planar edge weight
+// type (EUC_2D, CEIL_2D or ATT).
+// Note: The solvers measure tours with unrounded euclidean distances, not 
+// the rounded distances TSPLIB defines for these types.
+// Returns false if the file could not be read or is not a supported 
+// instance, in which case outPoints is left unspecified.
+bool loadTsplib(const std::string& fileName, PointList& outPoints);
+
+// Writes the points as an EUC_2D TSPLIB instance.
+// Returns false if the file could not be written.
+bool saveTsplib(const std::string& fileName, const PointList& points, const std::string& name);
+
+// Writes the points as a binary instance.
+// Returns false if the file could not be written.
+bool saveBinaryInstance(const std::string& fileName, const PointList& points);
+
+// Reads a binary instance.
+// Returns false if the file could not be read, has an unknown version or is
+// corrupt, in which case outPoints is left unspecified.
+bool loadBinaryInstance(const std::string& fileName, PointList& outPoints);
+
+// Reads an instance in either format, telling them apart by their contents.
+// Returns false if the file could not be read as either.
+bool loadInstance(const std::string& fileName, PointList& outPoints);
@@ -0,0 +1,224 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Reproducible generation of synthetic problem instances, for
+//                testing the solvers at sizes that cannot be placed by hand.
+//                Generation is split into fixed size chunks that run in 
+//                parallel, each drawing from its own counter based random 
+//                stream, so the output depends only on the settings and 
+//                never on the number of threads.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "InstanceGenerator.h"
+
+namespace {
+	// Nodes generated from one random stream. Fixed so that the output does
+	// not depend on how chunks are spread over threads.
+	const size_t s_kChunkSize = 65536;
+
+	// Streams for the shared structure of an instance, kept clear of the 
+	// per chunk streams.
+	const uint64_t s_kClusterStream = ~0ull;
+	const uint64_t s_kRoadStream = ~0ull - 1;
+
+	const double s_kPi = 3.14159265358979323846;
+
+	// SplitMix64 finalizer. Scrambles the bits of its input well enough that
+	// consecutive inputs give independent looking outputs.
+	uint64_t mix(uint64_t value)
+	{
+		value ^= value >> 30;
+		value *= 0xbf58476d1ce4e5b9ull;
+		value ^= value >> 27;
+		value *= 0x94d049bb133111ebull;
+		value ^= value >> 31;
+		return value;
+	}
+
+	// A random stream where the n-th value is a pure function of the seed,
+	// stream and n, so any stream can be started without generating the 
+	// ones before it.
+	class CounterRandom {
+	public:
+		CounterRandom(uint64_t seed, uint64_t stream)
+			: m_key{ mix(seed ^ mix(stream + 0x9e3779b97f4a7c15ull)) }
+			, m_counter{ 0 }
+		{
+		}
+
+		uint64_t next() { return mix(m_key + 0x9e3779b97f4a7c15ull * ++m_counter); }
+
+		// Returns a real number uniformly distributed in [0, 1).
+		double real() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+		double real(double min, double max) { return min + (max - min) * real(); }
+
+		// Returns an integer uniformly distributed in [0, count).
+		size_t index(size_t count) { return static_cast<size_t>(real() * count); }
+
+		// Returns a normally distributed number (Box-Muller).
+		double gaussian(double mean, double stdDev)
+		{
+			double u1 = 1 - real();
+			double u2 = real();
+			return mean + stdDev * std::sqrt(-2 * std::log(u1)) * std::cos(2 * s_kPi * u2);
+		}
+
+	private:
+		uint64_t m_key;
+		uint64_t m_counter;
+	};
+
+	struct Road {
+		Eigen::Vector2d from;
+		Eigen::Vector2d to;
+	};
+
+	// Shared structure that nodes are placed around, generated once before
+	// the chunks.
+	struct Layout {
+		PointList clusterCentres;
+		std::vector<Road, Eigen::aligned_allocator<Road>> roads;
+
+		// Running total of road lengths, so that roads are picked in 
+		// proportion to their length.
+		std::vector<double> cumulativeRoadLength;
+
+		size_t gridWidth;
+	};
+
+	Layout makeLayout(const GeneratorSettings& settings)
+	{
+		Layout layout;
+		layout.gridWidth = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(settings.nodeCount))));
+
+		CounterRandom clusterRandom(settings.seed, s_kClusterStream);
+		for (size_t i = 0; i < std::max(settings.clusterCount, static_cast<size_t>(1)); ++i)
+			layout.clusterCentres.push_back({ clusterRandom.real(0, settings.size), clusterRandom.real(0, settings.size) });
+
+		// Half the roads are long straight streets across the whole area, the
+		// rest connect random towns, which gives a mix of near parallel 
+		// streets and crossings at all angles
+		CounterRandom roadRandom(settings.seed, s_kRoadStream);
+		double totalLength = 0;
+		for (size_t i = 0; i < std::max(settings.roadCount, static_cast<size_t>(1)); ++i) {
+			Road road;
+			double offset = roadRandom.real(0, settings.size);
+			if (i % 4 == 0)
+				road = { { 0, offset }, { settings.size, offset } };
+			else if (i % 4 == 1)
+				road = { { offset, 0 }, { offset, settings.size } };
+			else
+				road = { { offset, roadRandom.real(0, settings.size) }, { roadRandom.real(0, settings.size), roadRandom.real(0, settings.size) } };
+			totalLength += (road.to - road.from).norm();
+			layout.roads.push_back(road);
+			layout.cumulativeRoadLength.push_back(totalLength);
+		}
+
+		return layout;
+	}
+
+	Eigen::Vector2d generateNode(const GeneratorSettings& settings, const Layout& layout, size_t nodeIdx, CounterRandom& random)
+	{
+		switch (settings.distribution) {
+		case GeneratorSettings::Clustered: {
+			const Eigen::Vector2d& centre = layout.clusterCentres.at(random.index(layout.clusterCentres.size()));
+			double stdDev = settings.clusterSpread * settings.size;
+			return { random.gaussian(centre.x(), stdDev), random.gaussian(centre.y(), stdDev) };
+		}
+		case GeneratorSettings::Grid: {
+			double spacing = settings.size / layout.gridWidth;
+			double maxOffset = settings.gridJitter * spacing / 2;
+			double x = (nodeIdx % layout.gridWidth + 0.5) * spacing;
+			double y = (nodeIdx / layout.gridWidth + 0.5) * spacing;
+			return { x + random.real(-maxOffset, maxOffset), y + random.real(-maxOffset, maxOffset) };
+		}
+		case GeneratorSettings::RoadNetwork: {
+			double distAlong = random.real(0, layout.cumulativeRoadLength.back());
+			size_t roadIdx = std::upper_bound(layout.cumulativeRoadLength.begin(), layout.cumulativeRoadLength.end(), distAlong) - layout.cumulativeRoadLength.begin();
+			const Road& road = layout.roads.at(std::min(roadIdx, layout.roads.size() - 1));
+			Eigen::Vector2d direction = road.to - road.from;
+			Eigen::Vector2d normal = Eigen::Vector2d{ -direction.y(), direction.x() }.normalized();
+			return road.from + random.real() * direction + random.gaussian(0, settings.roadSpread * settings.size) * normal;
+		}
+		case GeneratorSettings::Uniform:
+		default:
+			return { random.real(0, settings.size), random.real(0, settings.size) };
+		}
+	}
+}
+
+GeneratorSettings::GeneratorSettings()
+	: distribution{ Uniform }
+	, nodeCount{ 1000 }
+	, seed{ 1 }
+	, size{ 1000 }
+	, clusterCount{ 10 }
+	, clusterSpread{ 0.03 }
+	, gridJitter{ 0.2 }
+	, roadCount{ 40 }
+	, roadSpread{ 0.002 }
+{
+}
+
+PointList generateInstance(const GeneratorSettings& settings)
+{
+	PointList points(settings.nodeCount);
+	Layout layout = makeLayout(settings);
+
+	// Threads take the next unclaimed chunk until none are left
+	size_t chunkCount = (settings.nodeCount + s_kChunkSize - 1) / s_kChunkSize;
+	std::atomic<size_t> nextChunk{ 0 };
+	auto generateChunks = [&]() {
+		for (size_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++) {
+			CounterRandom random(settings.seed, chunk);
+			size_t end = std::min((chunk + 1) * s_kChunkSize, settings.nodeCount);
+			for (size_t nodeIdx = chunk * s_kChunkSize; nodeIdx < end; ++nodeIdx) {
+				Eigen::Vector2d point = generateNode(settings, layout, nodeIdx, random);
+
+				// Keep the tails of the gaussians inside the area
+				points[nodeIdx] = { std::min(std::max(point.x(), 0.0), settings.size),
+				                    std::min(std::max(point.y(), 0.0), settings.size) };
+			}
+		}
+	};
+
+	size_t threadCount = std::min(static_cast<size_t>(std::max(std::thread::hardware_concurrency(), 1u)), chunkCount);
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < threadCount; ++i)
+		threads.emplace_back(generateChunks);
+	generateChunks();
+	for (std::thread& thread : threads)
+		thread.join();
+
+	return points;
+}
+
+bool parseDistribution(const std::string& name, GeneratorSettings::Distribution& outDistribution)
+{
+	if (name == "uniform")
+		outDistribution = GeneratorSettings::Uniform;
+	else if (name == "clustered")
+		outDistribution = GeneratorSettings::Clustered;
+	else if (name == "grid")
+		outDistribution = GeneratorSettings::Grid;
+	else if (name == "road")
+		outDistribution = GeneratorSettings::RoadNetwork;
+	else
+		return false;
+
+	return true;
+}
@@ -0,0 +1,64 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Reproducible generation of synthetic problem instances, for
+//                testing the solvers at sizes that cannot be placed by hand.
+//                Generation is split into fixed size chunks that run in 
+//                parallel, each drawing from its own counter based random 
+//                stream, so the output depends only on the settings and 
+//                never on the number of threads.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "Geometry.h"
+
+struct GeneratorSettings {
+	enum Distribution {
+		Uniform,
+		Clustered,
+		Grid,
+		RoadNetwork
+	};
+
+	GeneratorSettings();
+
+	Distribution distribution;
+	size_t nodeCount;
+	uint64_t seed;
+
+	// Nodes are placed in the square [0, size] x [0, size]. Clustered and
+	// road nodes that fall outside it are clamped to its edges.
+	double size;
+
+	// Clustered: Number of clusters and their standard deviation as a 
+	// fraction of size.
+	size_t clusterCount;
+	double clusterSpread;
+
+	// Grid: Maximum offset of a node from its grid position, as a fraction 
+	// of the grid spacing.
+	double gridJitter;
+
+	// RoadNetwork: Number of roads and the standard deviation of a node's 
+	// distance from its road, as a fraction of size.
+	size_t roadCount;
+	double roadSpread;
+};
+
+// Generates an instance. The same settings always give the same nodes.
+PointList generateInstance(const GeneratorSettings& settings);
+
+// Returns the distribution with the given name (uniform, clustered, grid or
+// road). Returns false if the name is not recognised.
+bool parseDistribution(const std::string& name, GeneratorSettings::Distribution& outDistribution);
@@ -0,0 +1,164 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Low overhead counters for the solvers' hot paths.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "Instrumentation.h"
+
+namespace {
+	thread_local CounterBlock* s_threadBlock = nullptr;
+}
+
+#ifdef INSTRUMENT_ALLOCATIONS
+void* operator new(size_t size)
+{
+	if (CounterBlock* block = CounterBlock::getThreadBlock())
+		block->addAllocation();
+	if (void* ptr = std::malloc(size ? size : 1))
+		return ptr;
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	operator delete(ptr);
+}
+#endif // INSTRUMENT_ALLOCATIONS
+
+CounterTotals::CounterTotals()
+{
+	std::memset(this, 0, sizeof(*this));
+}
+
+CounterTotals& CounterTotals::operator+=(const CounterTotals& other)
+{
+	for (size_t move = 0; move < MoveCount; ++move) {
+		tried[move] += other.tried[move];
+		accepted[move] += other.accepted[move];
+		for (size_t bucket = 0; bucket < s_kBucketCount; ++bucket)
+			deltaHistogram[move][bucket] += other.deltaHistogram[move][bucket];
+	}
+	improvements += other.improvements;
+	for (size_t wait = 0; wait < WaitCount; ++wait) {
+		waits[wait] += other.waits[wait];
+		waitNanoseconds[wait] += other.waitNanoseconds[wait];
+	}
+	allocations += other.allocations;
+	return *this;
+}
+
+size_t CounterTotals::getBucket(double delta)
+{
+	// Read the exponent straight from the bits, which is much cheaper than
+	// a logarithm
+	uint64_t bits;
+	std::memcpy(&bits, &delta, sizeof(bits));
+	int exponent = static_cast<int>((bits >> 52) & 0x7ff) - 1023;
+	int magnitudeBucket = std::min(std::max(exponent - s_kMinExponent, 0), static_cast<int>(s_kHalfBucketCount) - 1);
+	return (delta < 0 ? 0 : s_kHalfBucketCount) + magnitudeBucket;
+}
+
+std::string CounterTotals::getMoveName(Move move)
+{
+	switch (move) {
+	case AnnealingTwoOpt:
+		return "2-opt";
+	case LocalSearchTwoOpt:
+		return "LS 2-opt";
+	case LocalSearchOrOpt:
+		return "LS Or-opt";
+	case DoubleBridgeKick:
+		return "Double Bridge";
+	case Crossover:
+		return "Crossover";
+	case Mutation:
+		return "Mutation";
+	case AntTour:
+		return "Ant Tour";
+	case TabuTwoOpt:
+		return "Tabu 2-opt";
+	case PenaltyDescent:
+		return "GLS Descent";
+	case PartitionCrossover:
+		return "GPX";
+	default:
+		return "";
+	}
+}
+
+std::string CounterTotals::getWaitName(Wait wait)
+{
+	switch (wait) {
+	case PathLock:
+		return "Path Lock";
+	case BoardPublish:
+		return "Board Publish";
+	default:
+		return "";
+	}
+}
+
+CounterBlock::CounterBlock()
+{
+	for (size_t move = 0; move < CounterTotals::MoveCount; ++move) {
+		m_tried[move] = 0;
+		m_accepted[move] = 0;
+		for (size_t bucket = 0; bucket < CounterTotals::s_kBucketCount; ++bucket)
+			m_deltaHistogram[move][bucket] = 0;
+	}
+	m_improvements = 0;
+	for (size_t wait = 0; wait < CounterTotals::WaitCount; ++wait) {
+		m_waits[wait] = 0;
+		m_waitNanoseconds[wait] = 0;
+	}
+	m_allocations = 0;
+}
+
+void CounterBlock::addTo(CounterTotals& totals) const
+{
+	for (size_t move = 0; move < CounterTotals::MoveCount; ++move) {
+		totals.tried[move] += m_tried[move].load(std::memory_order_relaxed);
+		totals.accepted[move] += m_accepted[move].load(std::memory_order_relaxed);
+		for (size_t bucket = 0; bucket < CounterTotals::s_kBucketCount; ++bucket)
+			totals.deltaHistogram[move][bucket] += m_deltaHistogram[move][bucket].load(std::memory_order_relaxed);
+	}
+	totals.improvements += m_improvements.load(std::memory_order_relaxed);
+	for (size_t wait = 0; wait < CounterTotals::WaitCount; ++wait) {
+		totals.waits[wait] += m_waits[wait].load(std::memory_order_relaxed);
+		totals.waitNanoseconds[wait] += m_waitNanoseconds[wait].load(std::memory_order_relaxed);
+	}
+	totals.allocations += m_allocations.load(std::memory_order_relaxed);
+}
+
+void CounterBlock::setThreadBlock(CounterBlock* block)
+{
+	s_threadBlock = block;
+}
+
+CounterBlock* CounterBlock::getThreadBlock()
+{
+	return s_threadBlock;
+}
@@ -0,0 +1,156 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Low overhead counters for the solvers' hot paths.
+//                Every solver thread writes to its own CounterBlock, padded 
+//                so that no two blocks share a cache line. Counters have a
+//                single writer and use relaxed loads and stores, which 
+//                compile to plain memory accesses, so the inner loops never
+//                execute an atomic read-modify-write. Blocks are summed into
+//                CounterTotals on demand.
+//
+//                Allocations are only counted when the solver is built with
+//                INSTRUMENT_ALLOCATIONS defined, which replaces the global 
+//                operator new.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Plain totals of one or more counter blocks.
+struct CounterTotals {
+	enum Move {
+		AnnealingTwoOpt,
+		LocalSearchTwoOpt,
+		LocalSearchOrOpt,
+		DoubleBridgeKick,
+		Crossover,
+		Mutation,
+		AntTour,
+		TabuTwoOpt,
+		PenaltyDescent,
+		PartitionCrossover,
+		MoveCount
+	};
+
+	enum Wait {
+		PathLock,
+		BoardPublish,
+		WaitCount
+	};
+
+	// Deltas are bucketed by sign and power of two magnitude. The first 
+	// half of the buckets hold improving (negative) deltas, the second half
+	// the rest. Bucket i of a half holds magnitudes in 
+	// [2^(i + s_kMinExponent), 2^(i + s_kMinExponent + 1)), with the first 
+	// and last buckets also holding anything smaller or larger.
+	static const int s_kMinExponent = -10;
+	static const size_t s_kHalfBucketCount = 32;
+	static const size_t s_kBucketCount = 2 * s_kHalfBucketCount;
+
+	CounterTotals();
+
+	CounterTotals& operator+=(const CounterTotals& other);
+
+	// Returns the histogram bucket of a tour length change.
+	static size_t getBucket(double delta);
+
+	// Returns a display name for a move type.
+	static std::string getMoveName(Move move);
+
+	// Returns a display name for a wait type.
+	static std::string getWaitName(Wait wait);
+
+	uint64_t tried[MoveCount];
+	uint64_t accepted[MoveCount];
+	uint64_t deltaHistogram[MoveCount][s_kBucketCount];
+
+	// Number of times a solver found a tour shorter than any it had before.
+	uint64_t improvements;
+
+	uint64_t waits[WaitCount];
+	uint64_t waitNanoseconds[WaitCount];
+
+	uint64_t allocations;
+};
+
+// Counters written by a single solver thread.
+class CounterBlock {
+public:
+	CounterBlock();
+
+	// Records a move that was evaluated, and whether it was applied.
+	void addMove(CounterTotals::Move move, double delta, bool accepted)
+	{
+		add(m_tried[move], 1);
+		if (accepted)
+			add(m_accepted[move], 1);
+		add(m_deltaHistogram[move][CounterTotals::getBucket(delta)], 1);
+	}
+
+	// Records a move whose effect on the tour length is not measured.
+	void addMove(CounterTotals::Move move, bool accepted)
+	{
+		add(m_tried[move], 1);
+		if (accepted)
+			add(m_accepted[move], 1);
+	}
+
+	// Records that a new best tour was found.
+	void addImprovement() { add(m_improvements, 1); }
+
+	// Records time spent waiting for another thread.
+	void addWait(CounterTotals::Wait wait, uint64_t nanoseconds)
+	{
+		add(m_waits[wait], 1);
+		add(m_waitNanoseconds[wait], nanoseconds);
+	}
+
+	void addAllocation() { add(m_allocations, 1); }
+
+	// Adds the counters to a total. Safe to call from any thread while the
+	// owner is writing, though the totals may be slightly out of date.
+	void addTo(CounterTotals& totals) const;
+
+	// Sets the block that allocations on the calling thread are counted in,
+	// or nullptr to stop counting them.
+	static void setThreadBlock(CounterBlock* block);
+
+	// Returns the block set for the calling thread, or nullptr.
+	static CounterBlock* getThreadBlock();
+
+private:
+	typedef std::atomic<uint64_t> Counter;
+
+	// Only the owning thread writes, so a separate load and store is enough
+	// and avoids the locked instructions of fetch_add.
+	static void add(Counter& counter, uint64_t value)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+
+	// Keeps the counters off the cache lines of whatever is allocated next
+	// to the block, without relying on over-aligned allocation.
+	static const size_t s_kCacheLineSize = 64;
+	char m_frontPadding[s_kCacheLineSize];
+
+	Counter m_tried[CounterTotals::MoveCount];
+	Counter m_accepted[CounterTotals::MoveCount];
+	Counter m_deltaHistogram[CounterTotals::MoveCount][CounterTotals::s_kBucketCount];
+	Counter m_improvements;
+	Counter m_waits[CounterTotals::WaitCount];
+	Counter m_waitNanoseconds[CounterTotals::WaitCount];
+	Counter m_allocations;
+
+	char m_backPadding[s_kCacheLineSize];
+};
@@ -0,0 +1,487 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Neighbour list driven 2-opt / Or-opt local search with a
+//                queue of "don't look bits", so that after a small change
+//                only the cities around that change are re-optimized.
+//                Works on any tour with the ArrayTour interface, and with
+//                any edge cost that is never below the Euclidean distance,
+//                e.g. the penalised costs of guided local search.
+//                When a city has many candidate moves, their distances are
+//                computed together in a batch before the moves are tried
+//                in order.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <array>
+#include <vector>
+#include <cstddef>
+
+#include "Geometry.h"
+#include "NeighbourLists.h"
+#include "BatchDistances.h"
+#include "Instrumentation.h"
+
+// Edge cost of plain local search, the Euclidean distance.
+struct EuclideanCost {
+	// Returns the cost of the edge between a and b, given their distance.
+	double operator()(size_t, size_t, double distance) const { return distance; }
+};
+
+template <typename TourT, typename CostT = EuclideanCost>
+class LocalSearch {
+public:
+	LocalSearch(TourT& tour, const PointList& points, const NeighbourLists& neighbours, const CostT& cost = CostT{});
+
+	// Queues a city to be looked at by the next call to optimize.
+	void push(size_t city);
+
+	// Queues every city in the tour.
+	void pushAll();
+
+	// Applies improving 2-opt and Or-opt moves around the queued cities until
+	// the queue is empty, or until *stopped becomes true.
+	// Returns the change in tour cost (zero or negative).
+	double optimize(const std::atomic<bool>* stopped = nullptr);
+
+	// Outputs the cities still waiting in the queue, so that an interrupted
+	// search can be resumed by pushing them again.
+	void getQueued(std::vector<size_t>& outCities) const;
+
+	// Performs a double bridge kick, swapping the two consecutive segments of
+	// length len1 and len2 that follow the specified city. The cities at the
+	// ends of the changed edges are queued.
+	// Requires len1 + len2 + 2 <= tour size.
+	// Returns the change in tour cost.
+	double doubleBridgeKick(size_t city, size_t len1, size_t len2);
+
+	// Starts recording applied moves so they can be undone.
+	void startLog();
+
+	// Undoes all moves recorded since startLog and stops recording.
+	void undo();
+
+	// Stops recording and forgets the recorded moves.
+	void clearLog();
+
+	// Returns the change in Euclidean tour length made by the moves recorded
+	// since startLog, whatever the edge cost.
+	double getLoggedLengthDelta() const;
+
+	// Sets the block that evaluated moves are counted in, or nullptr to not
+	// count them.
+	void setCounters(CounterBlock* counters) { m_counters = counters; }
+
+	// Turns evaluating candidates as a batch on or off. On by default, off
+	// is for benchmarking the one at a time path on its own.
+	void setBatching(bool batching) { m_batching = batching; }
+
+private:
+	// Tries to find an improving move around a city and applies it.
+	// Returns true if the tour was changed.
+	bool improveCity(size_t city, double& outDelta);
+
+	// Tries improving 2-opt moves that add an edge from t1 to one of its
+	// neighbours, removing the edge from t1 to its successor (forward) or
+	// predecessor (!forward).
+	bool try2Opt(size_t t1, bool forward, double& outDelta);
+
+	// Tries moving the segment s1..s2 (s2 after s1) between two neighbouring
+	// cities elsewhere in the tour, in either direction.
+	bool tryOrOpt(size_t s1, size_t s2, double& outDelta);
+
+	// Replaces the edges (t1, t2) and (t3, t4) with (t1, t3) and (t2, t4).
+	// t2 and t4 must either be the successors or the predecessors of t1 and
+	// t3 respectively.
+	void apply2OptMove(size_t t1, size_t t2, size_t t3, size_t t4);
+
+	// Returns true if the city is one of the cities from s1 to s2.
+	bool inSegment(size_t city, size_t s1, size_t s2) const;
+
+	// Returns how many of the first candidates of a city to evaluate as a
+	// batch. Fewer candidates than fill a vector, the usual case once the
+	// tour is good, are cheaper to evaluate one at a time since most
+	// searches stop at the first improvement.
+	size_t getBatchSize(size_t candidateCount) const
+	{
+		if (!m_batching || candidateCount < PointBatch::s_kMinSize)
+			return 0;
+		return std::min(candidateCount, PointBatch::s_kMaxSize);
+	}
+
+	double dist(size_t a, size_t b) const { return euclideanDist(m_points, a, b); }
+	double cost(size_t a, size_t b) const { return m_cost(a, b, dist(a, b)); }
+
+	// Moves smaller than this are treated as rounding error, which stops the
+	// search from cycling between equal length tours.
+	static const double s_kEpsilon;
+
+	// Longest segment considered for Or-opt moves.
+	static const size_t s_kMaxOrOptLength = 3;
+
+	TourT& m_tour;
+	const PointList& m_points;
+	const NeighbourLists& m_neighbours;
+	CostT m_cost;
+
+	// FIFO queue of cities to look at. A city's don't look bit is clear while
+	// it is in the queue.
+	std::vector<size_t> m_queue;
+	size_t m_queueHead;
+	std::vector<bool> m_queued;
+
+	// Moves applied since startLog, in order.
+	std::vector<std::array<size_t, 4>> m_log;
+	bool m_logging;
+
+	bool m_batching;
+	CounterBlock* m_counters;
+};
+
+template <typename TourT, typename CostT>
+const double LocalSearch<TourT, CostT>::s_kEpsilon = 1e-9;
+
+template <typename TourT, typename CostT>
+LocalSearch<TourT, CostT>::LocalSearch(TourT& tour, const PointList& points, const NeighbourLists& neighbours, const CostT& cost)
+	: m_tour{ tour }
+	, m_points{ points }
+	, m_neighbours{ neighbours }
+	, m_cost(cost)
+	, m_queueHead{ 0 }
+	, m_queued(tour.size(), false)
+	, m_logging{ false }
+	, m_batching{ true }
+	, m_counters{ nullptr }
+{
+}
+
+template <typename TourT, typename CostT>
+void LocalSearch<TourT, CostT>::push(size_t city)
+{
+	if (m_queued[city])
+		return;
+
+	m_queued[city] = true;
+	m_queue.push_back(city);
+}
+
+template <typename TourT, typename CostT>
+void LocalSearch<TourT, CostT>::pushAll()
+{
+	for (size_t city = 0; city < m_tour.size(); ++city)
+		push(city);
+}
+
+template <typename TourT, typename CostT>
+double LocalSearch<TourT, CostT>::optimize(const std::atomic<bool>* stopped)
+{
+	double totalDelta = 0;
+	while (m_queueHead < m_queue.size() && !(stopped && *stopped)) {
+		size_t city = m_queue[m_queueHead++];
+		m_queued[city] = false;
+
+		// Keep looking at the city until nothing around it improves
+		double delta;
+		while (improveCity(city, delta))
+			totalDelta += delta;
+
+		// Reclaim the queue storage once it has been drained
+		if (m_queueHead == m_queue.size()) {
+			m_queue.clear();
+			m_queueHead = 0;
+		}
+	}
+
+	return totalDelta;
+}
+
+template <typename TourT, typename CostT>
+void LocalSearch<TourT, CostT>::getQueued(std::vector<size_t>& outCities) const
+{
+	outCities.assign(m_queue.begin() + m_queueHead, m_queue.end());
+}
+
+template <typename TourT, typename CostT>
+double LocalSearch<TourT, CostT>::doubleBridgeKick(size_t city, size_t len1, size_t len2)
+{
+	size_t a1 = city;
+	size_t a2 = m_tour.next(a1);
+	size_t b1 = a2;
+	for (size_t i = 1; i < len1; ++i)
+		b1 = m_tour.next(b1);
+	size_t b2 = m_tour.next(b1);
+	size_t c1 = b2;
+	for (size_t i = 1; i < len2; ++i)
+		c1 = m_tour.next(c1);
+	size_t c2 = m_tour.next(c1);
+
+	double delta = cost(a1, b2) + cost(c1, a2) + cost(b1, c2)
+	             - cost(a1, a2) - cost(b1, b2) - cost(c1, c2);
+
+	// a1 [a2..b1] [b2..c1] c2 becomes a1 [b2..c1] [a2..b1] c2 after three
+	// reversals, each of which only touches the two short segments
+	apply2OptMove(a1, a2, c1, c2);
+	apply2OptMove(a1, c1, b2, b1);
+	apply2OptMove(c1, b1, a2, c2);
+
+	push(a1);
+	push(a2);
+	push(b1);
+	push(b2);
+	push(c1);
+	push(c2);
+
+	return delta;
+}
+
+template <typename TourT, typename CostT>
+void LocalSearch<TourT, CostT>::startLog()
+{
+	m_log.clear();
+	m_logging = true;
+}
+
+template <typename TourT, typename CostT>
+void LocalSearch<TourT, CostT>::undo()
+{
+	m_logging = false;
+	for (auto it = m_log.rbegin(); it != m_log.rend(); ++it) {
+		const std::array<size_t, 4>& move = *it;
+		apply2OptMove(move[0], move[2], move[1], move[3]);
+	}
+	m_log.clear();
+}
+
+template <typename TourT, typename CostT>
+void LocalSearch<TourT, CostT>::clearLog()
+{
+	m_logging = false;
+	m_log.clear();
+}
+
+template <typename TourT, typename CostT>
+double LocalSearch<TourT, CostT>::getLoggedLengthDelta() const
+{
+	// Each move replaced the edges (t1, t2) and (t3, t4) with (t1, t3) and
+	// (t2, t4)
+	double delta = 0;
+	for (const std::array<size_t, 4>& move : m_log)
+		delta += dist(move[0], move[2]) + dist(move[1], move[3]) - dist(move[0], move[1]) - dist(move[2], move[3]);
+	return delta;
+}
+
+template <typename TourT, typename CostT>
+bool LocalSearch<TourT, CostT>::improveCity(size_t city, double& outDelta)
+{
+	if (try2Opt(city, true, outDelta) || try2Opt(city, false, outDelta))
+		return true;
+
+	// Segments starting and ending at the city
+	size_t segmentEnd = city;
+	size_t segmentStart = city;
+	for (size_t length = 1; length <= s_kMaxOrOptLength; ++length) {
+		if (tryOrOpt(city, segmentEnd, outDelta))
+			return true;
+		if (length > 1 && tryOrOpt(segmentStart, city, outDelta))
+			return true;
+		segmentEnd = m_tour.next(segmentEnd);
+		segmentStart = m_tour.prev(segmentStart);
+	}
+
+	return false;
+}
+
+template <typename TourT, typename CostT>
+bool LocalSearch<TourT, CostT>::try2Opt(size_t t1, bool forward, double& outDelta)
+{
+	size_t t2 = forward ? m_tour.next(t1) : m_tour.prev(t1);
+	double removedCost = cost(t1, t2);
+
+	// Neighbours are sorted by distance, and no cost is below the distance,
+	// so only the neighbours closer than the removed edge can give a gain
+	const size_t* neighbours = m_neighbours.getNeighbours(t1);
+	const double* addedDists = m_neighbours.getNeighbourDistances(t1);
+	size_t inRange = 0;
+	while (inRange < m_neighbours.getNeighbourCount() && addedDists[inRange] < removedCost)
+		++inRange;
+
+	size_t batchSize = getBatchSize(inRange);
+	size_t t4s[PointBatch::s_kMaxSize];
+	double t2t4Dists[PointBatch::s_kMaxSize];
+	double t3t4Dists[PointBatch::s_kMaxSize];
+	if (batchSize > 0) {
+		for (size_t i = 0; i < batchSize; ++i)
+			t4s[i] = forward ? m_tour.next(neighbours[i]) : m_tour.prev(neighbours[i]);
+
+		PointBatch t3Points;
+		PointBatch t4Points;
+		t3Points.gather(m_points, neighbours, batchSize);
+		t4Points.gather(m_points, t4s, batchSize);
+		calculateDistances(m_points[t2], t4Points, batchSize, t2t4Dists);
+		calculatePairDistances(t3Points, t4Points, batchSize, t3t4Dists);
+	}
+
+	for (size_t i = 0; i < inRange; ++i) {
+		size_t t3 = neighbours[i];
+		bool batched = i < batchSize;
+		size_t t4 = batched ? t4s[i] : forward ? m_tour.next(t3) : m_tour.prev(t3);
+		if (t3 == t2 || t4 == t1)
+			continue;
+
+		double addedCost = m_cost(t1, t3, addedDists[i]) + m_cost(t2, t4, batched ? t2t4Dists[i] : dist(t2, t4));
+		double delta = addedCost - removedCost - m_cost(t3, t4, batched ? t3t4Dists[i] : dist(t3, t4));
+		if (m_counters)
+			m_counters->addMove(CounterTotals::LocalSearchTwoOpt, delta, delta < -s_kEpsilon);
+		if (delta < -s_kEpsilon) {
+			apply2OptMove(t1, t2, t3, t4);
+			push(t1);
+			push(t2);
+			push(t3);
+			push(t4);
+			outDelta = delta;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+template <typename TourT, typename CostT>
+bool LocalSearch<TourT, CostT>::tryOrOpt(size_t s1, size_t s2, double& outDelta)
+{
+	size_t p = m_tour.prev(s1);
+	size_t n = m_tour.next(s2);
+
+	// The segment must leave enough of the tour to be inserted into
+	if (inSegment(p, s1, s2) || inSegment(n, s1, s2) || p == n)
+		return false;
+
+	double removeGain = cost(p, s1) + cost(s2, n) - cost(p, n);
+	if (removeGain <= s_kEpsilon)
+		return false;
+
+	for (size_t end = 0; end < 2; ++end) {
+		size_t endpoint = end == 0 ? s1 : s2;
+		const size_t* neighbours = m_neighbours.getNeighbours(endpoint);
+		const double* endpointDists = m_neighbours.getNeighbourDistances(endpoint);
+		size_t inRange = 0;
+		while (inRange < m_neighbours.getNeighbourCount() && endpointDists[inRange] < removeGain)
+			++inRange;
+
+		// Distances along the tour on either side of each neighbour, and from
+		// both ends of the segment to the neighbours and the cities on
+		// either side of them, indexed 0 for the neighbour, 1 for the next
+		// city and 2 for the previous one
+		size_t batchSize = getBatchSize(inRange);
+		size_t nexts[PointBatch::s_kMaxSize];
+		size_t prevs[PointBatch::s_kMaxSize];
+		double nextDists[PointBatch::s_kMaxSize];
+		double prevDists[PointBatch::s_kMaxSize];
+		double s1Dists[3][PointBatch::s_kMaxSize];
+		double s2Dists[3][PointBatch::s_kMaxSize];
+		if (batchSize > 0) {
+			for (size_t i = 0; i < batchSize; ++i) {
+				nexts[i] = m_tour.next(neighbours[i]);
+				prevs[i] = m_tour.prev(neighbours[i]);
+			}
+
+			PointBatch batches[3];
+			batches[0].gather(m_points, neighbours, batchSize);
+			batches[1].gather(m_points, nexts, batchSize);
+			batches[2].gather(m_points, prevs, batchSize);
+			calculatePairDistances(batches[0], batches[1], batchSize, nextDists);
+			calculatePairDistances(batches[2], batches[0], batchSize, prevDists);
+			for (size_t j = 0; j < 3; ++j) {
+				calculateDistances(m_points[s1], batches[j], batchSize, s1Dists[j]);
+				calculateDistances(m_points[s2], batches[j], batchSize, s2Dists[j]);
+			}
+		}
+
+		for (size_t i = 0; i < inRange; ++i) {
+			size_t c = neighbours[i];
+			if (inSegment(c, s1, s2))
+				continue;
+
+			// Try the edges on both sides of the neighbour
+			bool batched = i < batchSize;
+			for (size_t side = 0; side < 2; ++side) {
+				size_t e1 = side == 0 ? c : batched ? prevs[i] : m_tour.prev(c);
+				size_t e2 = side == 0 ? (batched ? nexts[i] : m_tour.next(c)) : c;
+
+				// Insertions right next to the gap are covered by moving
+				// the neighbouring city instead
+				if (e1 == n || e2 == p || inSegment(e1, s1, s2) || inSegment(e2, s1, s2))
+					continue;
+
+				size_t e1Index = side == 0 ? 0 : 2;
+				size_t e2Index = side == 0 ? 1 : 0;
+				double edgeCost = m_cost(e1, e2, batched ? (side == 0 ? nextDists[i] : prevDists[i]) : dist(e1, e2));
+				double e1s2Cost = m_cost(e1, s2, batched ? s2Dists[e1Index][i] : dist(e1, s2));
+				double s1e2Cost = m_cost(s1, e2, batched ? s1Dists[e2Index][i] : dist(s1, e2));
+				double e1s1Cost = m_cost(e1, s1, batched ? s1Dists[e1Index][i] : dist(e1, s1));
+				double s2e2Cost = m_cost(s2, e2, batched ? s2Dists[e2Index][i] : dist(s2, e2));
+				double reversedDelta = e1s2Cost + s1e2Cost - edgeCost - removeGain;
+				double forwardDelta = e1s1Cost + s2e2Cost - edgeCost - removeGain;
+				bool improves = reversedDelta < -s_kEpsilon || forwardDelta < -s_kEpsilon;
+				if (m_counters)
+					m_counters->addMove(CounterTotals::LocalSearchOrOpt, std::min(reversedDelta, forwardDelta), improves);
+				if (!improves)
+					continue;
+
+				// p [s1..s2] n .. e1 e2 becomes p n .. e1 [s2..s1] e2
+				apply2OptMove(p, s1, e1, e2);
+				apply2OptMove(p, e1, n, s2);
+				if (forwardDelta < reversedDelta && s1 != s2) {
+					apply2OptMove(e1, s2, s1, e2);
+					outDelta = forwardDelta;
+				}
+				else {
+					outDelta = reversedDelta;
+				}
+
+				push(p);
+				push(n);
+				push(s1);
+				push(s2);
+				push(e1);
+				push(e2);
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+template <typename TourT, typename CostT>
+void LocalSearch<TourT, CostT>::apply2OptMove(size_t t1, size_t t2, size_t t3, size_t t4)
+{
+	if (t2 == m_tour.next(t1))
+		m_tour.flip(t1, t2, t3, t4);
+	else
+		m_tour.flip(t2, t1, t4, t3);
+
+	if (m_logging)
+		m_log.push_back({ { t1, t2, t3, t4 } });
+}
+
+template <typename TourT, typename CostT>
+bool LocalSearch<TourT, CostT>::inSegment(size_t city, size_t s1, size_t s2) const
+{
+	for (size_t segmentCity = s1; ; segmentCity = m_tour.next(segmentCity)) {
+		if (segmentCity == city)
+			return true;
+		if (segmentCity == s2)
+			return false;
+	}
+}
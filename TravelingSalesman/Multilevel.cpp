@@ -0,0 +1,240 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Multilevel tour construction for very large instances.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+
+#include "Multilevel.h"
+#include "ArrayTour.h"
+#include "TwoLevelList.h"
+#include "LocalSearch.h"
+#include "ParallelLocalSearch.h"
+#include "Tracing.h"
+#include "Utils.h"
+
+namespace {
+	// Coarsening stops once a level has this few nodes, which are then
+	// toured by local search alone.
+	const size_t s_kCoarsestNodeCount = 50;
+
+	// Coarsening also stops if a level does not shrink the one below it to
+	// at least this fraction, which happens when few neighbours are left
+	// unmatched, e.g. with many duplicate points.
+	const double s_kMinShrinkFactor = 0.9;
+
+	// Levels of at least this many nodes are first refined by the parallel
+	// local search when there is more than one thread. Smaller levels are
+	// not worth starting threads for.
+	const size_t s_kMinParallelRefineSize = 50000;
+
+	// Marks a super-node that was made from a single node.
+	const size_t s_kNoChild = static_cast<size_t>(-1);
+
+	// A coarsened copy of the level below it.
+	struct Level {
+		PointList points;
+
+		// Number of cities merged into each node.
+		std::vector<uint32_t> weights;
+
+		// The nodes of the level below that each node was made from. The
+		// second child is s_kNoChild if the node was not matched.
+		std::vector<std::array<size_t, 2>> children;
+	};
+
+	// Builds the next coarser level by matching every node with its nearest
+	// unmatched neighbour. Nodes are visited in random order so that the
+	// matching does not follow the order of the input file.
+	// Fine weights may be empty if every node holds one city.
+	void coarsen(const PointList& finePoints, const std::vector<uint32_t>& fineWeights, const NeighbourLists& neighbours, Level& outLevel)
+	{
+		size_t fineCount = finePoints.size();
+		std::vector<size_t> order(fineCount);
+		std::iota(order.begin(), order.end(), static_cast<size_t>(0));
+		std::shuffle(order.begin(), order.end(), getRandomGenerator());
+
+		outLevel.points.clear();
+		outLevel.weights.clear();
+		outLevel.children.clear();
+		outLevel.points.reserve(fineCount / 2 + 1);
+		outLevel.weights.reserve(fineCount / 2 + 1);
+		outLevel.children.reserve(fineCount / 2 + 1);
+
+		std::vector<char> matched(fineCount, 0);
+		for (size_t city : order) {
+			if (matched[city])
+				continue;
+			matched[city] = 1;
+
+			size_t partner = s_kNoChild;
+			const size_t* cityNeighbours = neighbours.getNeighbours(city);
+			for (size_t i = 0; i < neighbours.getNeighbourCount(); ++i) {
+				if (!matched[cityNeighbours[i]]) {
+					partner = cityNeighbours[i];
+					matched[partner] = 1;
+					break;
+				}
+			}
+
+			// Super-nodes sit at the centroid of the cities merged into them
+			uint32_t weight = fineWeights.empty() ? 1 : fineWeights[city];
+			Eigen::Vector2d point = finePoints[city] * weight;
+			if (partner != s_kNoChild) {
+				uint32_t partnerWeight = fineWeights.empty() ? 1 : fineWeights[partner];
+				point += finePoints[partner] * partnerWeight;
+				weight += partnerWeight;
+			}
+			outLevel.points.push_back(point / weight);
+			outLevel.weights.push_back(weight);
+			outLevel.children.push_back({ city, partner });
+		}
+	}
+
+	// Expands a tour of the coarse level into a tour of the level below,
+	// putting each pair of children the way round that joins up with the
+	// previous city and the next super-node more cheaply.
+	void uncoarsen(const Level& coarse, const PointList& finePoints, const std::vector<size_t>& coarsePath, std::vector<size_t>& outPath)
+	{
+		outPath.clear();
+		for (size_t i = 0; i < coarsePath.size(); ++i) {
+			const std::array<size_t, 2>& children = coarse.children[coarsePath[i]];
+			if (children[1] == s_kNoChild) {
+				outPath.push_back(children[0]);
+				continue;
+			}
+
+			const Eigen::Vector2d& prev = outPath.empty() ? coarse.points[coarsePath.back()] : finePoints[outPath.back()];
+			const Eigen::Vector2d& next = coarse.points[coarsePath[(i + 1) % coarsePath.size()]];
+			double forwardDist = euclideanDist(prev, finePoints[children[0]]) + euclideanDist(finePoints[children[1]], next);
+			double reverseDist = euclideanDist(prev, finePoints[children[1]]) + euclideanDist(finePoints[children[0]], next);
+			if (forwardDist <= reverseDist) {
+				outPath.push_back(children[0]);
+				outPath.push_back(children[1]);
+			}
+			else {
+				outPath.push_back(children[1]);
+				outPath.push_back(children[0]);
+			}
+		}
+	}
+
+	// Runs local search over the whole of a level's tour. Starting from the
+	// expanded tour of the level above, most cities are already locally
+	// optimal, so this takes time linear in the level's size.
+	template <typename TourT>
+	bool refine(const PointList& points, const NeighbourLists& neighbours, std::vector<size_t>& path, const std::atomic<bool>* stopped, CounterBlock* counters)
+	{
+		TourT tour(path);
+		LocalSearch<TourT> localSearch(tour, points, neighbours);
+		localSearch.setCounters(counters);
+		localSearch.pushAll();
+		localSearch.optimize(stopped);
+		if (stopped && *stopped)
+			return false;
+
+		tour.getOrder(path);
+		return true;
+	}
+
+	bool refine(const PointList& points, const NeighbourLists& neighbours, size_t twoLevelListThreshold, size_t threadCount,
+	            std::vector<size_t>& path, const std::atomic<bool>* stopped, CounterBlock* counters)
+	{
+		TRACE_SCOPE("Refine Level");
+
+		// Local search needs room for a 2-opt move
+		if (path.size() < 4)
+			return true;
+
+		// The expanded tour is already coherent, so nearly all of its
+		// improving moves are short and batch well across the threads. The
+		// serial pass after it only picks up the few moves left over.
+		if (threadCount > 1 && path.size() >= s_kMinParallelRefineSize) {
+			ParallelLocalSearch parallelSearch(points, neighbours, threadCount);
+			parallelSearch.setCounters(counters);
+			parallelSearch.optimize(path, stopped);
+			if (stopped && *stopped)
+				return false;
+		}
+
+		if (path.size() >= twoLevelListThreshold)
+			return refine<TwoLevelList>(points, neighbours, path, stopped, counters);
+		else
+			return refine<ArrayTour>(points, neighbours, path, stopped, counters);
+	}
+}
+
+bool buildMultilevelTour(const PointList& points, const NeighbourLists& neighbours, size_t twoLevelListThreshold,
+                         size_t threadCount, std::vector<size_t>& outPath, const std::atomic<bool>* stopped, CounterBlock* counters)
+{
+	size_t neighbourCount = neighbours.getNeighbourCount();
+
+	// Coarsen until the instance is small. Only the finest level's
+	// neighbour lists are kept around, the others are rebuilt on the way
+	// back up rather than holding them all at once.
+	std::vector<Level> levels;
+	std::unique_ptr<NeighbourLists> levelNeighbours;
+	{
+		TRACE_SCOPE("Coarsen");
+		const PointList* finePoints = &points;
+		const NeighbourLists* fineNeighbours = &neighbours;
+		std::vector<uint32_t> noWeights;
+		while (finePoints->size() > s_kCoarsestNodeCount) {
+			if (stopped && *stopped)
+				return false;
+
+			Level level;
+			coarsen(*finePoints, levels.empty() ? noWeights : levels.back().weights, *fineNeighbours, level);
+			if (level.points.size() > finePoints->size() * s_kMinShrinkFactor)
+				break;
+
+			levels.push_back(std::move(level));
+			finePoints = &levels.back().points;
+			levelNeighbours.reset(new NeighbourLists(*finePoints, neighbourCount));
+			fineNeighbours = levelNeighbours.get();
+		}
+	}
+
+	// Tour the coarsest level from scratch, which is the instance itself if
+	// it was too small to coarsen
+	const PointList& coarsestPoints = levels.empty() ? points : levels.back().points;
+	const NeighbourLists& coarsestNeighbours = levels.empty() ? neighbours : *levelNeighbours;
+	std::vector<size_t> path(coarsestPoints.size());
+	std::iota(path.begin(), path.end(), static_cast<size_t>(0));
+	if (!refine(coarsestPoints, coarsestNeighbours, twoLevelListThreshold, threadCount, path, stopped, counters))
+		return false;
+
+	// Expand and refine one level at a time
+	std::vector<size_t> finePath;
+	for (size_t i = levels.size(); i > 0; --i) {
+		const PointList& finePoints = i > 1 ? levels[i - 2].points : points;
+		uncoarsen(levels[i - 1], finePoints, path, finePath);
+		path.swap(finePath);
+
+		// The coarse level is no longer needed
+		levels.pop_back();
+
+		if (i > 1)
+			levelNeighbours.reset(new NeighbourLists(finePoints, neighbourCount));
+		else
+			levelNeighbours.reset();
+		const NeighbourLists& fineNeighbours = i > 1 ? *levelNeighbours : neighbours;
+		if (!refine(finePoints, fineNeighbours, twoLevelListThreshold, threadCount, path, stopped, counters))
+			return false;
+	}
+
+	outPath.swap(path);
+	return true;
+}
@@ -0,0 +1,39 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Multilevel tour construction for very large instances.
+//                The instance is coarsened by matching every city with its
+//                nearest unmatched neighbour into a super-node at their
+//                centroid, over and over until only a handful of nodes are
+//                left. The coarsest tour is then expanded one level at a
+//                time, ordering each pair the cheaper way round, and
+//                refined with 2-opt / Or-opt local search at every level.
+//                Every level does work linear in its size, so the whole
+//                build is linear in the number of cities. Large levels are
+//                refined on several threads first.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include "Geometry.h"
+#include "NeighbourLists.h"
+#include "Instrumentation.h"
+
+// Builds a tour of the points from scratch by multilevel refinement. The
+// neighbour lists of the points are used for the last level, and levels of
+// at least twoLevelListThreshold nodes are refined on a TwoLevelList.
+// Large levels are also refined by ParallelLocalSearch on threadCount
+// threads.
+// Returns false and leaves outPath unchanged if *stopped becomes true first.
+bool buildMultilevelTour(const PointList& points, const NeighbourLists& neighbours, size_t twoLevelListThreshold,
+                         size_t threadCount, std::vector<size_t>& outPath, const std::atomic<bool>* stopped, CounterBlock* counters);
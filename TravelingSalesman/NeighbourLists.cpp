@@ -0,0 +1,135 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Candidate lists holding the k nearest neighbours of every
+//                city.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <utility>
+
+#include "NeighbourLists.h"
+
+NeighbourLists::NeighbourLists(const PointList& points, size_t k)
+	: m_k{ 0 }
+{
+	size_t n = points.size();
+	if (n < 2)
+		return;
+
+	m_k = std::min(k, n - 1);
+	m_neighbours.resize(n * m_k);
+	m_distances.resize(n * m_k);
+
+	// Bucket the points into a grid with roughly two points per cell
+	Eigen::Vector2d minPos = points[0];
+	Eigen::Vector2d maxPos = points[0];
+	for (const Eigen::Vector2d& point : points) {
+		minPos = minPos.cwiseMin(point);
+		maxPos = maxPos.cwiseMax(point);
+	}
+	Eigen::Vector2d extent = maxPos - minPos;
+	double area = std::max(extent.x() * extent.y(), extent.maxCoeff() * extent.maxCoeff() / n);
+	double cellSize = std::sqrt(area * 2 / n);
+	if (cellSize <= 0)
+		cellSize = 1;
+	size_t cols = static_cast<size_t>(extent.x() / cellSize) + 1;
+	size_t rows = static_cast<size_t>(extent.y() / cellSize) + 1;
+
+	auto getCell = [&](const Eigen::Vector2d& point, size_t& outCol, size_t& outRow) {
+		outCol = std::min(cols - 1, static_cast<size_t>((point.x() - minPos.x()) / cellSize));
+		outRow = std::min(rows - 1, static_cast<size_t>((point.y() - minPos.y()) / cellSize));
+	};
+
+	std::vector<size_t> cellStart(cols * rows + 1, 0);
+	std::vector<size_t> cellItems(n);
+	for (const Eigen::Vector2d& point : points) {
+		size_t col, row;
+		getCell(point, col, row);
+		++cellStart[row * cols + col + 1];
+	}
+	for (size_t i = 1; i < cellStart.size(); ++i)
+		cellStart[i] += cellStart[i - 1];
+	std::vector<size_t> cellFill(cellStart.begin(), cellStart.end() - 1);
+	for (size_t i = 0; i < n; ++i) {
+		size_t col, row;
+		getCell(points[i], col, row);
+		cellItems[cellFill[row * cols + col]++] = i;
+	}
+
+	// Search outwards ring by ring until no closer point can exist
+	auto findNeighbours = [&](size_t begin, size_t end) {
+		std::vector<std::pair<double, size_t>> heap;
+		heap.reserve(m_k + 1);
+		for (size_t city = begin; city < end; ++city) {
+			heap.clear();
+			size_t col, row;
+			getCell(points[city], col, row);
+			size_t maxRing = std::max(cols, rows);
+			for (size_t ring = 0; ring <= maxRing; ++ring) {
+				ptrdiff_t r = static_cast<ptrdiff_t>(ring);
+				for (ptrdiff_t dy = -r; dy <= r; ++dy) {
+					ptrdiff_t y = static_cast<ptrdiff_t>(row) + dy;
+					if (y < 0 || y >= static_cast<ptrdiff_t>(rows))
+						continue;
+
+					// Only visit the border of the ring
+					ptrdiff_t step = (dy == -r || dy == r) ? 1 : std::max(static_cast<ptrdiff_t>(1), 2 * r);
+					for (ptrdiff_t dx = -r; dx <= r; dx += step) {
+						ptrdiff_t x = static_cast<ptrdiff_t>(col) + dx;
+						if (x < 0 || x >= static_cast<ptrdiff_t>(cols))
+							continue;
+
+						size_t cell = static_cast<size_t>(y) * cols + static_cast<size_t>(x);
+						for (size_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+							size_t other = cellItems[i];
+							if (other == city)
+								continue;
+							double distSquared = euclideanDistSquared(points[city], points[other]);
+							if (heap.size() < m_k) {
+								heap.emplace_back(distSquared, other);
+								std::push_heap(heap.begin(), heap.end());
+							}
+							else if (distSquared < heap.front().first) {
+								std::pop_heap(heap.begin(), heap.end());
+								heap.back() = { distSquared, other };
+								std::push_heap(heap.begin(), heap.end());
+							}
+						}
+					}
+				}
+
+				// Anything outside this ring is at least ring * cellSize away
+				double ringDist = ring * cellSize;
+				if (heap.size() == m_k && ringDist * ringDist >= heap.front().first)
+					break;
+			}
+
+			std::sort_heap(heap.begin(), heap.end());
+			for (size_t i = 0; i < m_k; ++i) {
+				m_neighbours[city * m_k + i] = heap[i].second;
+				m_distances[city * m_k + i] = std::sqrt(heap[i].first);
+			}
+		}
+	};
+
+	// Split the work evenly over the available cores
+	size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = std::min(threadCount, (n + 1023) / 1024);
+	std::vector<std::thread> threads;
+	size_t chunkSize = (n + threadCount - 1) / threadCount;
+	for (size_t i = 1; i < threadCount; ++i)
+		threads.emplace_back(findNeighbours, std::min(n, i * chunkSize), std::min(n, (i + 1) * chunkSize));
+	findNeighbours(0, std::min(n, chunkSize));
+	for (std::thread& thread : threads)
+		thread.join();
+}
@@ -0,0 +1,57 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Candidate lists holding the k nearest neighbours of every
+//                city. Local search only considers moves that create an
+//                edge to one of these candidates.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <vector>
+
+#include "Geometry.h"
+
+class NeighbourLists {
+public:
+	// Finds the k nearest neighbours of every point using a uniform grid.
+	// Fewer neighbours are stored if there are not enough points.
+	NeighbourLists(const PointList& points, size_t k);
+
+	// Returns the number of neighbours stored for every city.
+	size_t getNeighbourCount() const { return m_k; }
+
+	// Returns the neighbours of a city, sorted closest first.
+	// Points to getNeighbourCount() cities.
+	const size_t* getNeighbours(size_t city) const { return m_neighbours.data() + city * m_k; }
+
+	// Returns the distances from a city to its neighbours, in the same
+	// order as getNeighbours.
+	const double* getNeighbourDistances(size_t city) const { return m_distances.data() + city * m_k; }
+
+	// Returns the position of b in a's neighbour list, or
+	// getNeighbourCount() if b is not one of a's neighbours.
+	size_t findNeighbour(size_t a, size_t b) const
+	{
+		const size_t* neighbours = getNeighbours(a);
+		size_t i = 0;
+		while (i < m_k && neighbours[i] != b)
+			++i;
+		return i;
+	}
+
+private:
+	size_t m_k;
+	std::vector<size_t> m_neighbours;
+
+	// Kept so that local search can rule out far neighbours without
+	// loading their positions.
+	std::vector<double> m_distances;
+};
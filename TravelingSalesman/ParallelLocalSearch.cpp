@@ -0,0 +1,378 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Best improvement 2-opt / Or-opt local search that scans for
+//                moves on all cores.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <algorithm>
+#include <map>
+#include <string>
+
+#include "ParallelLocalSearch.h"
+#include "Tracing.h"
+
+const double ParallelLocalSearch::s_kEpsilon = 1e-9;
+
+ParallelLocalSearch::ParallelLocalSearch(const PointList& points, const NeighbourLists& neighbours, size_t threadCount)
+	: m_points{ points }
+	, m_neighbours{ neighbours }
+	, m_threadCount{ std::max<size_t>(threadCount, 1) }
+	, m_counters{ nullptr }
+	, m_work{ nullptr }
+	, m_workCount{ 0 }
+	, m_chunkSize{ 0 }
+	, m_job{ 0 }
+	, m_busyThreads{ 0 }
+	, m_shuttingDown{ false }
+{
+	for (size_t i = 1; i < m_threadCount; ++i)
+		m_threads.emplace_back(&ParallelLocalSearch::workerLoop, this, i);
+}
+
+ParallelLocalSearch::~ParallelLocalSearch()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_poolMutex);
+		m_shuttingDown = true;
+	}
+	m_jobStarted.notify_all();
+	for (std::thread& thread : m_threads)
+		thread.join();
+}
+
+double ParallelLocalSearch::optimize(std::vector<size_t>& path, const std::atomic<bool>* stopped)
+{
+	size_t n = path.size();
+	if (n < 8)
+		return 0;
+
+	m_path.swap(path);
+
+	// Moves may not remove the edge between the ends of the path, so the
+	// path is rotated to start after the shortest edge, which improving
+	// moves are least likely to need to remove
+	size_t shortestEdge = 0;
+	for (size_t i = 1; i < n; ++i) {
+		if (dist(m_path[i], m_path[(i + 1) % n]) < dist(m_path[shortestEdge], m_path[(shortestEdge + 1) % n]))
+			shortestEdge = i;
+	}
+	std::rotate(m_path.begin(), m_path.begin() + (shortestEdge + 1) % n, m_path.end());
+	m_positions.resize(n);
+	for (size_t i = 0; i < n; ++i)
+		m_positions[m_path[i]] = i;
+	m_activeCities.resize(n);
+	for (size_t city = 0; city < n; ++city)
+		m_activeCities[city] = city;
+	m_isActive.assign(n, 1);
+	auto activate = [this](size_t city) {
+		if (!m_isActive[city]) {
+			m_isActive[city] = 1;
+			m_activeCities.push_back(city);
+		}
+	};
+
+	double totalDelta = 0;
+	std::vector<size_t> cities;
+	std::vector<Move> moves;
+	std::vector<char> found;
+	std::vector<size_t> candidates;
+	std::vector<size_t> selected;
+	std::map<size_t, size_t> windows;
+	while (!m_activeCities.empty() && !(stopped && *stopped)) {
+		cities.swap(m_activeCities);
+		m_activeCities.clear();
+		for (size_t city : cities)
+			m_isActive[city] = 0;
+
+		// Scan for the best move of every active city. The tour is only
+		// read, so the threads need no locks.
+		moves.resize(cities.size());
+		found.assign(cities.size(), 0);
+		{
+			TRACE_SCOPE("Parallel Scan");
+			parallelFor(cities.size(), [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i)
+					found[i] = findBestMove(cities[i], moves[i]);
+			});
+		}
+
+		candidates.clear();
+		for (size_t i = 0; i < cities.size(); ++i) {
+			if (found[i])
+				candidates.push_back(i);
+		}
+		if (candidates.empty())
+			break;
+
+		// Take the best moves first, skipping any whose window overlaps one
+		// already taken. Ties are broken by position so that the batch is
+		// the same whatever the thread count.
+		std::sort(candidates.begin(), candidates.end(), [&moves](size_t a, size_t b) {
+			if (moves[a].delta != moves[b].delta)
+				return moves[a].delta < moves[b].delta;
+			if (moves[a].begin != moves[b].begin)
+				return moves[a].begin < moves[b].begin;
+			return moves[a].end < moves[b].end;
+		});
+		selected.clear();
+		windows.clear();
+		for (size_t i : candidates) {
+			const Move& move = moves[i];
+			auto after = windows.lower_bound(move.begin);
+			if (after != windows.end() && after->first <= move.end)
+				continue;
+			if (after != windows.begin() && std::prev(after)->second >= move.begin)
+				continue;
+
+			windows.emplace(move.begin, move.end);
+			selected.push_back(i);
+		}
+
+		// Windows are disjoint, so every thread changes its own part of
+		// the path
+		{
+			TRACE_SCOPE("Apply Batch");
+			parallelFor(selected.size(), [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i)
+					applyMove(moves[selected[i]]);
+			});
+		}
+
+		// Cities whose move lost out to an overlapping one try again next
+		// round, along with the cities around every applied move
+		for (size_t i : candidates)
+			activate(cities[i]);
+		for (size_t i : selected) {
+			const Move& move = moves[i];
+			totalDelta += move.delta;
+			if (m_counters)
+				m_counters->addMove(move.type, move.delta, true);
+			for (size_t j = 0; j < move.cityCount; ++j) {
+				activate(move.cities[j]);
+				const size_t* neighbours = m_neighbours.getNeighbours(move.cities[j]);
+				for (size_t k = 0; k < m_neighbours.getNeighbourCount(); ++k)
+					activate(neighbours[k]);
+			}
+		}
+	}
+
+	path.swap(m_path);
+	return totalDelta;
+}
+
+bool ParallelLocalSearch::findBestMove(size_t city, Move& outMove) const
+{
+	outMove.delta = -s_kEpsilon;
+	consider2Opt(city, true, outMove);
+	consider2Opt(city, false, outMove);
+
+	// Segments starting and ending at the city, as in LocalSearch
+	size_t segmentEnd = city;
+	size_t segmentStart = city;
+	for (size_t length = 1; length <= s_kMaxOrOptLength; ++length) {
+		considerOrOpt(city, segmentEnd, outMove);
+		if (length > 1)
+			considerOrOpt(segmentStart, city, outMove);
+		segmentEnd = next(segmentEnd);
+		segmentStart = prev(segmentStart);
+	}
+
+	return outMove.delta < -s_kEpsilon;
+}
+
+void ParallelLocalSearch::consider2Opt(size_t t1, bool forward, Move& bestMove) const
+{
+	size_t t2 = forward ? next(t1) : prev(t1);
+	if (!hasInnerNextEdge(forward ? t1 : t2))
+		return;
+
+	double removedDist = dist(t1, t2);
+	const size_t* neighbours = m_neighbours.getNeighbours(t1);
+	const double* neighbourDists = m_neighbours.getNeighbourDistances(t1);
+	for (size_t i = 0; i < m_neighbours.getNeighbourCount(); ++i) {
+		size_t t3 = neighbours[i];
+		double addedDist = neighbourDists[i];
+		if (addedDist >= removedDist)
+			break;
+
+		size_t t4 = forward ? next(t3) : prev(t3);
+		if (t3 == t2 || t4 == t1 || !hasInnerNextEdge(forward ? t3 : t4))
+			continue;
+
+		double delta = addedDist + dist(t2, t4) - removedDist - dist(t3, t4);
+		if (delta >= bestMove.delta)
+			continue;
+
+		Move move;
+		move.delta = delta;
+		move.type = CounterTotals::LocalSearchTwoOpt;
+		move.twoOptCount = 1;
+		move.twoOpts[0][0] = t1;
+		move.twoOpts[0][1] = t2;
+		move.twoOpts[0][2] = t3;
+		move.twoOpts[0][3] = t4;
+		move.cityCount = 4;
+		std::copy(move.twoOpts[0], move.twoOpts[0] + 4, move.cities);
+		if (setWindow(move))
+			bestMove = move;
+	}
+}
+
+void ParallelLocalSearch::considerOrOpt(size_t s1, size_t s2, Move& bestMove) const
+{
+	// Segments wrapping around the end of the path would need a window
+	// covering the whole tour
+	size_t segmentBegin = m_positions[s1];
+	size_t segmentEnd = m_positions[s2];
+	if (segmentBegin > segmentEnd)
+		return;
+	auto inSegment = [&](size_t city) {
+		return m_positions[city] >= segmentBegin && m_positions[city] <= segmentEnd;
+	};
+
+	size_t p = prev(s1);
+	size_t n = next(s2);
+	if (inSegment(p) || inSegment(n) || p == n || !hasInnerNextEdge(p) || !hasInnerNextEdge(s2))
+		return;
+
+	double removeGain = dist(p, s1) + dist(s2, n) - dist(p, n);
+	if (removeGain <= s_kEpsilon)
+		return;
+
+	for (size_t end = 0; end < 2; ++end) {
+		size_t endpoint = end == 0 ? s1 : s2;
+		const size_t* neighbours = m_neighbours.getNeighbours(endpoint);
+		const double* neighbourDists = m_neighbours.getNeighbourDistances(endpoint);
+		for (size_t i = 0; i < m_neighbours.getNeighbourCount(); ++i) {
+			size_t c = neighbours[i];
+			if (neighbourDists[i] >= removeGain)
+				break;
+			if (inSegment(c))
+				continue;
+
+			for (size_t side = 0; side < 2; ++side) {
+				size_t e1 = side == 0 ? c : prev(c);
+				size_t e2 = side == 0 ? next(c) : c;
+				if (e1 == n || e2 == p || inSegment(e1) || inSegment(e2) || !hasInnerNextEdge(e1))
+					continue;
+
+				double edgeDist = dist(e1, e2);
+				double reversedDelta = dist(e1, s2) + dist(s1, e2) - edgeDist - removeGain;
+				double forwardDelta = dist(e1, s1) + dist(s2, e2) - edgeDist - removeGain;
+				bool forward = forwardDelta < reversedDelta && s1 != s2;
+				double delta = forward ? forwardDelta : reversedDelta;
+				if (delta >= bestMove.delta)
+					continue;
+
+				// p [s1..s2] n .. e1 e2 becomes p n .. e1 [s2..s1] e2, as in
+				// LocalSearch::tryOrOpt
+				Move move;
+				move.delta = delta;
+				move.type = CounterTotals::LocalSearchOrOpt;
+				size_t twoOpts[3][4] = { { p, s1, e1, e2 }, { p, e1, n, s2 }, { e1, s2, s1, e2 } };
+				move.twoOptCount = forward ? 3 : 2;
+				std::copy(&twoOpts[0][0], &twoOpts[0][0] + 12, &move.twoOpts[0][0]);
+				size_t cities[6] = { p, n, s1, s2, e1, e2 };
+				move.cityCount = 6;
+				std::copy(cities, cities + 6, move.cities);
+				if (setWindow(move))
+					bestMove = move;
+			}
+		}
+	}
+}
+
+bool ParallelLocalSearch::setWindow(Move& move) const
+{
+	move.begin = m_positions[move.cities[0]];
+	move.end = move.begin;
+	for (size_t i = 1; i < move.cityCount; ++i) {
+		move.begin = std::min(move.begin, m_positions[move.cities[i]]);
+		move.end = std::max(move.end, m_positions[move.cities[i]]);
+	}
+	return move.end - move.begin <= s_kMaxMoveSpan;
+}
+
+void ParallelLocalSearch::applyMove(const Move& move)
+{
+	// Only positions inside the window are read, since other threads are
+	// changing the rest of the path. Moves never remove the edge between
+	// the ends of the path, so no edge wraps around.
+	for (size_t i = 0; i < move.twoOptCount; ++i) {
+		const size_t* twoOpt = move.twoOpts[i];
+		if (m_positions[twoOpt[1]] == m_positions[twoOpt[0]] + 1)
+			reverse(twoOpt[0], twoOpt[2]);
+		else
+			reverse(twoOpt[1], twoOpt[3]);
+	}
+}
+
+void ParallelLocalSearch::reverse(size_t a, size_t c)
+{
+	size_t first = std::min(m_positions[a], m_positions[c]) + 1;
+	size_t last = std::max(m_positions[a], m_positions[c]);
+	std::reverse(m_path.begin() + first, m_path.begin() + last + 1);
+	for (size_t i = first; i <= last; ++i)
+		m_positions[m_path[i]] = i;
+}
+
+void ParallelLocalSearch::parallelFor(size_t count, const std::function<void(size_t, size_t)>& work)
+{
+	// Small rounds are not worth waking the threads for. Threads past the
+	// last chunk get empty ranges.
+	const size_t kMinChunkSize = 1024;
+	size_t threadCount = std::min(m_threadCount, (count + kMinChunkSize - 1) / kMinChunkSize);
+	if (threadCount <= 1) {
+		work(0, count);
+		return;
+	}
+
+	size_t chunkSize = (count + threadCount - 1) / threadCount;
+	{
+		std::lock_guard<std::mutex> lock(m_poolMutex);
+		m_work = &work;
+		m_workCount = count;
+		m_chunkSize = chunkSize;
+		++m_job;
+		m_busyThreads = m_threads.size();
+	}
+	m_jobStarted.notify_all();
+	work(0, std::min(count, chunkSize));
+	{
+		std::unique_lock<std::mutex> lock(m_poolMutex);
+		m_jobFinished.wait(lock, [this]() { return m_busyThreads == 0; });
+	}
+}
+
+void ParallelLocalSearch::workerLoop(size_t workerIdx)
+{
+	setTraceThreadName("Local Search Worker " + std::to_string(workerIdx));
+
+	uint64_t seenJob = 0;
+	std::unique_lock<std::mutex> lock(m_poolMutex);
+	while (true) {
+		m_jobStarted.wait(lock, [this, seenJob]() { return m_shuttingDown || m_job != seenJob; });
+		if (m_shuttingDown)
+			return;
+		seenJob = m_job;
+		const std::function<void(size_t, size_t)>& work = *m_work;
+		size_t begin = std::min(m_workCount, workerIdx * m_chunkSize);
+		size_t end = std::min(m_workCount, (workerIdx + 1) * m_chunkSize);
+
+		lock.unlock();
+		if (begin < end)
+			work(begin, end);
+		lock.lock();
+
+		if (--m_busyThreads == 0)
+			m_jobFinished.notify_one();
+	}
+}
@@ -0,0 +1,155 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Best improvement 2-opt / Or-opt local search that scans for
+//                moves on all cores.
+//                Every round, the threads find the best improving move of
+//                each active city without changing the tour. Each move only
+//                touches a window of tour positions, so the moves are taken
+//                best first as long as their windows do not overlap, and the
+//                batch is applied in parallel. The result does not depend on
+//                the number of threads, and no locks are taken.
+//                Moves spanning a large part of the tour would block too
+//                many others, so they are left to the serial local search.
+//                The threads are started once and reused every round.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Geometry.h"
+#include "NeighbourLists.h"
+#include "Instrumentation.h"
+
+class ParallelLocalSearch {
+public:
+	ParallelLocalSearch(const PointList& points, const NeighbourLists& neighbours, size_t threadCount);
+	~ParallelLocalSearch();
+
+	ParallelLocalSearch(const ParallelLocalSearch&) = delete;
+	ParallelLocalSearch& operator=(const ParallelLocalSearch&) = delete;
+
+	// Improves the tour in place until no improving move is left that fits
+	// in a batch, or until *stopped becomes true.
+	// Returns the change in tour length.
+	double optimize(std::vector<size_t>& path, const std::atomic<bool>* stopped = nullptr);
+
+	// Sets the block that applied moves are counted in, or nullptr to not
+	// count them. Only the calling thread writes to it.
+	void setCounters(CounterBlock* counters) { m_counters = counters; }
+
+	// Longest segment moved by an Or-opt move, as in LocalSearch.
+	static const size_t s_kMaxOrOptLength = 3;
+
+	// Most tour positions that one move may span.
+	static const size_t s_kMaxMoveSpan = 50000;
+
+private:
+	// An improving move, made up of up to three 2-opt moves that each
+	// remove the edges from t1 to t2 and from t3 to t4, as in
+	// LocalSearch::apply2OptMove.
+	struct Move {
+		double delta;
+		CounterTotals::Move type;
+
+		// First and last tour positions touched by the move.
+		size_t begin;
+		size_t end;
+
+		size_t twoOpts[3][4];
+		size_t twoOptCount;
+
+		// Cities at the ends of the changed edges, which are looked at
+		// again next round.
+		size_t cities[6];
+		size_t cityCount;
+	};
+
+	// Finds the best improving move around the city. Returns false if
+	// there is none.
+	bool findBestMove(size_t city, Move& outMove) const;
+
+	// Keeps the 2-opt move removing the edge from t1 to its successor or
+	// predecessor if it beats the best move so far.
+	void consider2Opt(size_t t1, bool forward, Move& bestMove) const;
+
+	// Keeps the move of the segment from s1 to s2 next to a neighbour of
+	// either end if it beats the best move so far.
+	void considerOrOpt(size_t s1, size_t s2, Move& bestMove) const;
+
+	// Fills in the window of positions touched by the move. Returns false
+	// if it is too wide.
+	bool setWindow(Move& move) const;
+
+	// Applies the move. Only tour positions inside its window change.
+	void applyMove(const Move& move);
+
+	// Reverses the tour between the edges starting at a and at c.
+	void reverse(size_t a, size_t c);
+
+	// Runs work(begin, end) over ranges covering [0, count) on the pool.
+	void parallelFor(size_t count, const std::function<void(size_t, size_t)>& work);
+
+	// Runs chunks of each job until the search is destroyed. Runs on each
+	// of m_threads.
+	void workerLoop(size_t workerIdx);
+
+	size_t next(size_t city) const
+	{
+		size_t pos = m_positions[city] + 1;
+		return m_path[pos == m_path.size() ? 0 : pos];
+	}
+
+	size_t prev(size_t city) const
+	{
+		size_t pos = m_positions[city];
+		return m_path[pos == 0 ? m_path.size() - 1 : pos - 1];
+	}
+
+	// Returns true if an edge from the city to its successor does not wrap
+	// around the end of the path.
+	bool hasInnerNextEdge(size_t city) const { return m_positions[city] + 1 < m_path.size(); }
+
+	double dist(size_t a, size_t b) const { return euclideanDist(m_points, a, b); }
+
+	static const double s_kEpsilon;
+
+	const PointList& m_points;
+	const NeighbourLists& m_neighbours;
+	size_t m_threadCount;
+
+	std::vector<size_t> m_path;
+	std::vector<size_t> m_positions;
+
+	// Cities to look at next round, flagged in m_isActive.
+	std::vector<size_t> m_activeCities;
+	std::vector<char> m_isActive;
+
+	CounterBlock* m_counters;
+
+	// Thread pool. Workers run their chunk of m_work whenever m_job
+	// changes, and the calling thread runs the first chunk.
+	std::vector<std::thread> m_threads;
+	std::mutex m_poolMutex;
+	std::condition_variable m_jobStarted;
+	std::condition_variable m_jobFinished;
+	const std::function<void(size_t, size_t)>* m_work;
+	size_t m_workCount;
+	size_t m_chunkSize;
+	uint64_t m_job;
+	size_t m_busyThreads;
+	bool m_shuttingDown;
+};
@@ -0,0 +1,253 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Spatially partitioned tour construction.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <thread>
+
+#include "Partition.h"
+#include "Multilevel.h"
+#include "ArrayTour.h"
+#include "TwoLevelList.h"
+#include "LocalSearch.h"
+#include "Tracing.h"
+#include "Utils.h"
+
+namespace {
+	// Regions are not split below this size, since every region boundary
+	// costs some tour length that the repair has to win back.
+	const size_t s_kMinRegionSize = 10000;
+
+	// Regions per thread, so that threads that finish their regions early
+	// can take on more rather than sitting idle.
+	const size_t s_kRegionsPerThread = 4;
+
+	// A range of the partitioned cities.
+	struct Region {
+		size_t begin;
+		size_t end;
+		Eigen::Vector2d centroid;
+		uint32_t seed;
+	};
+
+	// Splits the cities at the median of the longer side of their bounding
+	// box until no region has more than maxRegionSize cities. The second
+	// half of every split is listed backwards, so that consecutive regions
+	// share a side and the last region is next to the first.
+	void splitRegions(const PointList& points, std::vector<size_t>& cities, size_t begin, size_t end, size_t maxRegionSize,
+	                  bool reversed, std::vector<Region>& outRegions)
+	{
+		Eigen::Vector2d min = points[cities[begin]];
+		Eigen::Vector2d max = min;
+		Eigen::Vector2d sum = Eigen::Vector2d::Zero();
+		for (size_t i = begin; i < end; ++i) {
+			const Eigen::Vector2d& point = points[cities[i]];
+			min = min.cwiseMin(point);
+			max = max.cwiseMax(point);
+			sum += point;
+		}
+
+		if (end - begin <= maxRegionSize) {
+			outRegions.push_back({ begin, end, sum / static_cast<double>(end - begin), 0 });
+			return;
+		}
+
+		Eigen::Vector2d extent = max - min;
+		int axis = extent.x() >= extent.y() ? 0 : 1;
+		size_t mid = begin + (end - begin) / 2;
+		std::nth_element(cities.begin() + begin, cities.begin() + mid, cities.begin() + end, [&points, axis](size_t a, size_t b) {
+			return points[a][axis] < points[b][axis];
+		});
+
+		if (!reversed) {
+			splitRegions(points, cities, begin, mid, maxRegionSize, false, outRegions);
+			splitRegions(points, cities, mid, end, maxRegionSize, true, outRegions);
+		}
+		else {
+			splitRegions(points, cities, mid, end, maxRegionSize, false, outRegions);
+			splitRegions(points, cities, begin, mid, maxRegionSize, true, outRegions);
+		}
+	}
+
+	// Replaces a region's cities with a tour of them, built by the
+	// multilevel construction on a copy of just the region's points.
+	bool solveRegion(const PointList& points, size_t neighbourCount, size_t twoLevelListThreshold, const Region& region,
+	                 std::vector<size_t>& cities, const std::atomic<bool>* stopped)
+	{
+		TRACE_SCOPE("Solve Region");
+		size_t regionSize = region.end - region.begin;
+		PointList regionPoints(regionSize);
+		for (size_t i = 0; i < regionSize; ++i)
+			regionPoints[i] = points[cities[region.begin + i]];
+
+		getRandomGenerator().seed(region.seed);
+		NeighbourLists regionNeighbours(regionPoints, neighbourCount);
+		std::vector<size_t> regionPath;
+		// Every region already has a thread of its own
+		if (!buildMultilevelTour(regionPoints, regionNeighbours, twoLevelListThreshold, 1, regionPath, stopped, nullptr))
+			return false;
+
+		std::vector<size_t> regionCities(cities.begin() + region.begin, cities.begin() + region.end);
+		for (size_t i = 0; i < regionSize; ++i)
+			cities[region.begin + i] = regionCities[regionPath[i]];
+		return true;
+	}
+
+	// Opens each region's tour at the edge that joins it up with the
+	// previous region and the centroid of the next one most cheaply, and
+	// chains them together.
+	void stitchRegions(const PointList& points, const std::vector<size_t>& cities, const std::vector<Region>& regions,
+	                   std::vector<size_t>& outPath)
+	{
+		TRACE_SCOPE("Stitch Regions");
+		outPath.clear();
+		outPath.reserve(cities.size());
+		for (size_t r = 0; r < regions.size(); ++r) {
+			const Region& region = regions[r];
+			size_t regionSize = region.end - region.begin;
+			const Eigen::Vector2d& prev = outPath.empty() ? regions.back().centroid : points[outPath.back()];
+			const Eigen::Vector2d& next = regions[(r + 1) % regions.size()].centroid;
+
+			// Cutting the edge from i to i + 1 leaves a path that enters at
+			// one end of the edge and leaves at the other
+			size_t bestCut = 0;
+			bool bestForward = true;
+			double bestCost = std::numeric_limits<double>::infinity();
+			for (size_t i = 0; i < regionSize; ++i) {
+				const Eigen::Vector2d& a = points[cities[region.begin + i]];
+				const Eigen::Vector2d& b = points[cities[region.begin + (i + 1) % regionSize]];
+				double removed = euclideanDist(a, b);
+				double forwardCost = euclideanDist(prev, b) + euclideanDist(a, next) - removed;
+				double backwardCost = euclideanDist(prev, a) + euclideanDist(b, next) - removed;
+				if (forwardCost < bestCost) {
+					bestCost = forwardCost;
+					bestCut = i;
+					bestForward = true;
+				}
+				if (backwardCost < bestCost) {
+					bestCost = backwardCost;
+					bestCut = i;
+					bestForward = false;
+				}
+			}
+
+			for (size_t j = 1; j <= regionSize; ++j) {
+				size_t i = bestForward ? (bestCut + j) % regionSize : (bestCut + regionSize + 1 - j) % regionSize;
+				outPath.push_back(cities[region.begin + i]);
+			}
+		}
+	}
+
+	// Runs local search from the cities with a candidate neighbour in
+	// another region, which covers every edge the stitching added.
+	template <typename TourT>
+	bool repairBoundaries(const PointList& points, const NeighbourLists& neighbours, const std::vector<uint32_t>& cityRegions,
+	                      std::vector<size_t>& path, const std::atomic<bool>* stopped, CounterBlock* counters)
+	{
+		TourT tour(path);
+		LocalSearch<TourT> localSearch(tour, points, neighbours);
+		localSearch.setCounters(counters);
+		for (size_t city = 0; city < points.size(); ++city) {
+			const size_t* cityNeighbours = neighbours.getNeighbours(city);
+			for (size_t i = 0; i < neighbours.getNeighbourCount(); ++i) {
+				if (cityRegions[cityNeighbours[i]] != cityRegions[city]) {
+					localSearch.push(city);
+					break;
+				}
+			}
+		}
+		localSearch.optimize(stopped);
+		if (stopped && *stopped)
+			return false;
+
+		tour.getOrder(path);
+		return true;
+	}
+}
+
+bool buildPartitionedTour(const PointList& points, const NeighbourLists& neighbours, size_t twoLevelListThreshold, size_t threadCount,
+                          std::vector<size_t>& outPath, const std::atomic<bool>* stopped, CounterBlock* counters)
+{
+	size_t nodeCount = points.size();
+	if (nodeCount == 0)
+		return true;
+
+	threadCount = std::max<size_t>(threadCount, 1);
+	size_t maxRegionSize = std::max(s_kMinRegionSize, (nodeCount + threadCount * s_kRegionsPerThread - 1) / (threadCount * s_kRegionsPerThread));
+
+	std::vector<size_t> cities(nodeCount);
+	for (size_t city = 0; city < nodeCount; ++city)
+		cities[city] = city;
+	std::vector<Region> regions;
+	{
+		TRACE_SCOPE("Split Regions");
+		splitRegions(points, cities, 0, nodeCount, maxRegionSize, false, regions);
+	}
+
+	// Seeds are drawn up front so that the tour does not depend on which
+	// thread solves which region
+	for (Region& region : regions)
+		region.seed = static_cast<uint32_t>(getRandomGenerator()());
+
+	// Largest regions first, so that the last ones to finish are short
+	std::vector<size_t> solveOrder(regions.size());
+	for (size_t r = 0; r < regions.size(); ++r)
+		solveOrder[r] = r;
+	std::sort(solveOrder.begin(), solveOrder.end(), [&regions](size_t a, size_t b) {
+		return regions[a].end - regions[a].begin > regions[b].end - regions[b].begin;
+	});
+
+	// Regions are solved on their own threads, which keeps this thread's
+	// random sequence untouched
+	std::atomic<size_t> nextRegion{ 0 };
+	std::atomic<bool> solved{ true };
+	auto solveRegions = [&](size_t workerIdx) {
+		setTraceThreadName("Region Worker " + std::to_string(workerIdx));
+		for (size_t i = nextRegion++; i < solveOrder.size(); i = nextRegion++) {
+			if (!solveRegion(points, neighbours.getNeighbourCount(), twoLevelListThreshold, regions[solveOrder[i]], cities, stopped))
+				solved = false;
+		}
+	};
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < std::min(threadCount, regions.size()); ++i)
+		threads.emplace_back(solveRegions, i);
+	for (std::thread& thread : threads)
+		thread.join();
+	if (!solved)
+		return false;
+
+	std::vector<size_t> path;
+	stitchRegions(points, cities, regions, path);
+	if (regions.size() > 1) {
+		TRACE_SCOPE("Repair Boundaries");
+		std::vector<uint32_t> cityRegions(nodeCount);
+		for (size_t r = 0; r < regions.size(); ++r) {
+			for (size_t i = regions[r].begin; i < regions[r].end; ++i)
+				cityRegions[cities[i]] = static_cast<uint32_t>(r);
+		}
+
+		bool repaired;
+		if (nodeCount >= twoLevelListThreshold)
+			repaired = repairBoundaries<TwoLevelList>(points, neighbours, cityRegions, path, stopped, counters);
+		else
+			repaired = repairBoundaries<ArrayTour>(points, neighbours, cityRegions, path, stopped, counters);
+		if (!repaired)
+			return false;
+	}
+
+	outPath.swap(path);
+	return true;
+}
@@ -0,0 +1,40 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Spatially partitioned tour construction for instances too
+//                large for a single solver thread, after Karp's partitioning
+//                algorithm.
+//                The plane is split at the median into k-d regions, whose
+//                tours are built in parallel by the multilevel construction.
+//                Regions are ordered so that consecutive ones share a side,
+//                and each region's tour is cut where it joins its
+//                neighbours most cheaply. Local search then repairs the tour
+//                around the region boundaries, where the stitching left it
+//                worst.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include "Geometry.h"
+#include "NeighbourLists.h"
+#include "Instrumentation.h"
+
+// Builds a tour of the points from scratch by solving spatial regions in
+// parallel on threadCount threads and stitching them together. The neighbour
+// lists of the points are used to repair the boundaries, and tours of at
+// least twoLevelListThreshold nodes are improved on a TwoLevelList.
+// Only the boundary repair is counted in the counters, since the blocks
+// are written by a single thread.
+// Returns false and leaves outPath unchanged if *stopped becomes true first.
+bool buildPartitionedTour(const PointList& points, const NeighbourLists& neighbours, size_t twoLevelListThreshold, size_t threadCount,
+                          std::vector<size_t>& outPath, const std::atomic<bool>* stopped, CounterBlock* counters);
@@ -0,0 +1,185 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Generalized partition crossover (GPX).
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <algorithm>
+
+#include "PartitionCrossover.h"
+
+namespace {
+	const size_t s_kNone = static_cast<size_t>(-1);
+
+	// Improvements smaller than this are treated as floating point error.
+	const double s_kEpsilon = 1e-9;
+
+	// Neighbours of every city in one tour, found through the positions of
+	// the cities.
+	class TourAdjacency {
+	public:
+		explicit TourAdjacency(const std::vector<size_t>& path)
+			: m_path{ path }
+			, m_positions(path.size())
+		{
+			for (size_t i = 0; i < path.size(); ++i)
+				m_positions[path[i]] = i;
+		}
+
+		size_t next(size_t city) const
+		{
+			size_t pos = m_positions[city] + 1;
+			return m_path[pos == m_path.size() ? 0 : pos];
+		}
+
+		size_t prev(size_t city) const
+		{
+			size_t pos = m_positions[city];
+			return m_path[pos == 0 ? m_path.size() - 1 : pos - 1];
+		}
+
+		bool hasEdge(size_t a, size_t b) const { return next(a) == b || prev(a) == b; }
+
+	private:
+		const std::vector<size_t>& m_path;
+		std::vector<size_t> m_positions;
+	};
+
+	// Union-find with path halving, used to label the components.
+	size_t findRoot(std::vector<size_t>& parents, size_t city)
+	{
+		while (parents[city] != city) {
+			parents[city] = parents[parents[city]];
+			city = parents[city];
+		}
+		return city;
+	}
+
+	// Walks the tour through the components, pairing up the cities at
+	// either end of each maximal run of the tour inside one component and
+	// summing the length of the runs per component.
+	// Returns false if the whole tour is a single component.
+	bool walkRuns(const PointList& points, const std::vector<size_t>& path, const std::vector<size_t>& components,
+	              std::vector<size_t>& outPartners, std::vector<double>& outLengths, std::vector<size_t>& outRunCounts)
+	{
+		size_t n = path.size();
+
+		// Start at the beginning of a run
+		size_t start = 0;
+		while (start < n && components[path[start]] == components[path[start == 0 ? n - 1 : start - 1]])
+			++start;
+		if (start == n)
+			return false;
+
+		size_t runStart = path[start];
+		for (size_t i = 0; i < n; ++i) {
+			size_t city = path[(start + i) % n];
+			size_t next = path[(start + i + 1) % n];
+			size_t component = components[city];
+			if (components[next] == component) {
+				outLengths[component] += euclideanDist(points, city, next);
+				continue;
+			}
+
+			outPartners[runStart] = city;
+			outPartners[city] = runStart;
+			++outRunCounts[component];
+			runStart = next;
+		}
+		return true;
+	}
+}
+
+bool partitionCrossover(const PointList& points, const std::vector<size_t>& parent1, const std::vector<size_t>& parent2,
+                        std::vector<size_t>& outChild)
+{
+	size_t n = parent1.size();
+	if (n < 4 || parent2.size() != n)
+		return false;
+
+	// The child is built from the shorter parent, so it can only get shorter
+	double length1 = calculatePathLength(points, parent1);
+	double length2 = calculatePathLength(points, parent2);
+	const std::vector<size_t>& base = length1 <= length2 ? parent1 : parent2;
+	const std::vector<size_t>& other = length1 <= length2 ? parent2 : parent1;
+	double baseLength = std::min(length1, length2);
+	TourAdjacency baseTour(base);
+	TourAdjacency otherTour(other);
+
+	// Label the components joined by the edges only one parent has
+	std::vector<size_t> components(n);
+	for (size_t city = 0; city < n; ++city)
+		components[city] = city;
+	for (size_t city = 0; city < n; ++city) {
+		size_t baseNext = baseTour.next(city);
+		if (!otherTour.hasEdge(city, baseNext))
+			components[findRoot(components, city)] = findRoot(components, baseNext);
+		size_t otherNext = otherTour.next(city);
+		if (!baseTour.hasEdge(city, otherNext))
+			components[findRoot(components, city)] = findRoot(components, otherNext);
+	}
+	for (size_t city = 0; city < n; ++city)
+		components[city] = findRoot(components, city);
+
+	// A component can take the other parent's paths if they join up the
+	// same pairs of cities as the base parent's paths
+	std::vector<size_t> basePartners(n, s_kNone);
+	std::vector<size_t> otherPartners(n, s_kNone);
+	std::vector<double> baseLengths(n, 0);
+	std::vector<double> otherLengths(n, 0);
+	std::vector<size_t> baseRunCounts(n, 0);
+	std::vector<size_t> otherRunCounts(n, 0);
+	if (!walkRuns(points, base, components, basePartners, baseLengths, baseRunCounts))
+		return false;
+	walkRuns(points, other, components, otherPartners, otherLengths, otherRunCounts);
+
+	std::vector<char> feasible(n, 0);
+	for (size_t city = 0; city < n; ++city) {
+		size_t component = components[city];
+		if (city == component)
+			feasible[component] = baseRunCounts[component] == otherRunCounts[component];
+	}
+	for (size_t city = 0; city < n; ++city) {
+		if (otherPartners[city] != s_kNone && basePartners[city] != otherPartners[city])
+			feasible[components[city]] = 0;
+	}
+
+	std::vector<char> useOther(n, 0);
+	double childLength = baseLength;
+	for (size_t component = 0; component < n; ++component) {
+		if (components[component] != component || !feasible[component])
+			continue;
+		if (otherLengths[component] < baseLengths[component] - s_kEpsilon) {
+			useOther[component] = 1;
+			childLength += otherLengths[component] - baseLengths[component];
+		}
+	}
+	if (childLength >= baseLength - s_kEpsilon)
+		return false;
+
+	// Every edge between components is shared, so following each city's
+	// edges in its component's parent traces out a single tour
+	std::vector<size_t> child;
+	child.reserve(n);
+	size_t prev = s_kNone;
+	size_t city = base.front();
+	do {
+		child.push_back(city);
+		const TourAdjacency& tour = useOther[components[city]] ? otherTour : baseTour;
+		size_t next = tour.next(city) != prev ? tour.next(city) : tour.prev(city);
+		prev = city;
+		city = next;
+	} while (city != base.front() && child.size() <= n);
+	if (child.size() != n)
+		return false;
+
+	outChild.swap(child);
+	return true;
+}
@@ -0,0 +1,34 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Generalized partition crossover (GPX), which merges two
+//                tours into one at least as short as either of them.
+//                Removing the edges the parents share splits the cities into
+//                components where the parents differ. Where both parents
+//                pass through a component between the same pairs of entry
+//                and exit cities, either parent's paths can be used there
+//                independently of the other components, so the child takes
+//                the shorter ones. Components that do not partition this
+//                way keep the shorter parent's paths.
+//                Everything is done in a few passes over the tours, so a
+//                merge takes time linear in the number of cities.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <vector>
+
+#include "Geometry.h"
+
+// Merges two tours of the same points with generalized partition crossover.
+// Returns true and outputs the child if it is shorter than both parents,
+// otherwise returns false and leaves outChild unchanged.
+bool partitionCrossover(const PointList& points, const std::vector<size_t>& parent1, const std::vector<size_t>& parent2,
+                        std::vector<size_t>& outChild);
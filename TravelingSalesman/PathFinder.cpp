@@ -7,7 +7,8 @@
 // (c) 2017 Media Design School
 //
 // Description  : Solver for the traveling salesman problem.
-//                Is able to draw current solution and statistics.
+//                Drawing lives in PathFinderDraw.cpp so that the solver can be
+//                built without the GUI libraries.
 // Author       : Lance Chaney
 // Mail         : lance.cha7337@mediadesign.school.nz
 //
@@ -16,57 +17,269 @@
 #include <math.h>
 #include <algorithm>
 #include <string>
+#include <limits>
+#include <sstream>
 #ifdef _DEBUG
 #include <iostream>
 #endif // _DEBUG
 
-#include <nanovg.h>
-#include <Eigen\Dense>
+#include <Eigen/Dense>
 
 #include "PathFinder.h"
-#include "Node.h"
+#include "ArrayTour.h"
+#include "TwoLevelList.h"
+#include "NeighbourLists.h"
+#include "LocalSearch.h"
+#include "Checkpoint.h"
+#include "Genetic.h"
+#include "PartitionCrossover.h"
+#include "AntColony.h"
+#include "TabuSearch.h"
+#include "EdgePenalties.h"
+#include "Multilevel.h"
+#include "Partition.h"
+#include "Tracing.h"
 #include "Utils.h"
 
+namespace {
+	// Builds the tour structure for a path. Large tours take long enough to
+	// build that this shows up in traces.
+	template <typename TourT>
+	TourT buildTour(const std::vector<size_t>& path)
+	{
+		TRACE_SCOPE("Build Tour");
+		return TourT(path);
+	}
+}
+
 const double PathFinder::s_kStartingTemperature = 1000;
+const size_t PathFinder::s_kLateAcceptanceSpan = 300000;
+const size_t PathFinder::s_kMinLateAcceptanceLength = 20;
+const size_t PathFinder::s_kMaxLateAcceptanceLength = 5000;
+const double PathFinder::s_kRecordDeviation = 0.5;
+const double PathFinder::s_kStartingThreshold = 0.5;
+const double PathFinder::s_kThresholdHalfLife = 100;
+const size_t PathFinder::s_kTwoLevelListThreshold = 5000;
+const size_t PathFinder::s_kNeighbourCount = 8;
+const size_t PathFinder::s_kMaxKickSegmentLength = 50;
+const std::chrono::milliseconds PathFinder::s_kRestartStagnationTime{ 3000 };
 
 PathFinder::PathFinder()
-	: m_stopped{ true }
-	, m_path{}
+	: m_path{}
 	, m_pathLength{ 0 }
+	, m_pathVersion{ 0 }
+	, m_nodesVersion{ 0 }
+	, m_temperature{ s_kStartingTemperature }
+	, m_tempDecay{ 1 }
+	, m_threshold{ s_kStartingThreshold }
+	, m_stopped{ true }
 	, m_pathsPerSecond{ 0 }
 	, m_generationsPerSecond{ 0 }
-	, m_temperature{ s_kStartingTemperature }
+	, m_kicksPerSecond{ 0 }
+	, m_antIterationsPerSecond{ 0 }
+	, m_avgAcceptanceProb{ 0 }
+	, m_threadHardwareCounters{ nullptr }
+	, m_usedUncountedThreads{ false }
+	, m_finishedRunSeconds{ 0 }
+	, m_historyMovesTried{ 0 }
+	, m_historyMovesAccepted{ 0 }
 	, m_mode{ HillClimbing }
-	, m_tempDecay{ 1 }
+	, m_boardId{ 0 }
+	, m_bestOwnPathLength{ std::numeric_limits<double>::infinity() }
+	, m_antLocalSearch{ true }
+	, m_constructionMode{ ModeCount }
+	, m_localSearchQueueValid{ false }
+	, m_hasRandomState{ false }
+	, m_checkpointInterval{ 0 }
+	, m_renderSnapshotRate{ 0 }
+	, m_renderNodesVersion{ 0 }
 {
 }
 
 PathFinder::~PathFinder()
 {
 	stop();
+	setRenderSnapshotRate(0);
 }
 
-void PathFinder::addNode(Node* node)
+size_t PathFinder::addNode(const Eigen::Vector2d& pos)
 {
 	stop();
 
 	std::lock_guard<std::mutex> lock{ m_mutex };
-	m_path.push_back(node);
-	m_pathLength = calculatePathLength(m_path);
+	size_t nodeIdx = m_points.size();
+	m_points.push_back(pos);
+	++m_nodesVersion;
+	m_path.push_back(nodeIdx);
+	m_pathLength = calculatePathLength(m_points, m_path);
+	resetSolverState();
+	return nodeIdx;
 }
 
-void PathFinder::removeNode(Node* node)
+void PathFinder::removeNode(size_t nodeIdx)
 {
 	stop();
 
 	std::lock_guard<std::mutex> lock{ m_mutex };
+	size_t lastIdx = m_points.size() - 1;
+	unorderedErase(m_points, nodeIdx);
+	++m_nodesVersion;
 	unorderedErase(
 		m_path,
 		std::find(
 			m_path.begin(),
 			m_path.end(),
-			node));
-	m_pathLength = calculatePathLength(m_path);
+			nodeIdx));
+
+	// The last node now lives at the removed node's index
+	std::replace(m_path.begin(), m_path.end(), lastIdx, nodeIdx);
+	m_pathLength = calculatePathLength(m_points, m_path);
+	resetSolverState();
+}
+
+void PathFinder::setNodePosition(size_t nodeIdx, const Eigen::Vector2d& pos)
+{
+	stop();
+
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	m_points.at(nodeIdx) = pos;
+	++m_nodesVersion;
+	m_pathLength = calculatePathLength(m_points, m_path);
+	resetSolverState();
+}
+
+void PathFinder::setNodes(const PointList& points)
+{
+	stop();
+
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	m_points = points;
+	++m_nodesVersion;
+	m_path.resize(m_points.size());
+	for (size_t i = 0; i < m_path.size(); ++i)
+		m_path.at(i) = i;
+	m_pathLength = calculatePathLength(m_points, m_path);
+	resetSolverState();
+}
+
+void PathFinder::setSeed(unsigned seed)
+{
+	stop();
+
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	m_randomGenerator.seed(seed);
+	m_hasRandomState = true;
+}
+
+bool PathFinder::setPath(const std::vector<size_t>& path)
+{
+	// Only accept a permutation of the current nodes
+	if (path.size() != m_points.size())
+		return false;
+	std::vector<bool> visited(path.size(), false);
+	for (size_t nodeIdx : path) {
+		if (nodeIdx >= path.size() || visited.at(nodeIdx))
+			return false;
+		visited.at(nodeIdx) = true;
+	}
+
+	stop();
+
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	m_path = path;
+	m_pathLength = calculatePathLength(m_points, m_path);
+	++m_pathVersion;
+
+	// The annealing temperature and GA population are kept so the new tour 
+	// acts as a warm start. Only state tied to the old tour is dropped.
+	m_localSearchQueueValid = false;
+	m_portfolio.clear();
+	return true;
+}
+
+std::vector<size_t> PathFinder::getPath()
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	return m_path;
+}
+
+double PathFinder::getPathLength()
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	return m_pathLength;
+}
+
+PointList PathFinder::getNodePositions()
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	return m_points;
+}
+
+void PathFinder::setCheckpointFile(const std::string& fileName, std::chrono::seconds interval)
+{
+	bool restart = stop();
+
+	m_checkpointWriter.reset();
+	if (!fileName.empty())
+		m_checkpointWriter.reset(new CheckpointWriter(fileName));
+	m_checkpointInterval = interval;
+	m_lastCheckpointTime = std::chrono::high_resolution_clock::now();
+
+	if (restart)
+		calculatePathAsync();
+}
+
+bool PathFinder::saveCheckpoint(const std::string& fileName)
+{
+	bool restart = stop();
+
+	std::unique_lock<std::mutex> lock{ m_mutex };
+	std::unique_ptr<SolverSnapshot> snapshot = makeSnapshot();
+	lock.unlock();
+	bool result = ::saveCheckpoint(fileName, *snapshot);
+
+	if (restart)
+		calculatePathAsync();
+
+	return result;
+}
+
+bool PathFinder::loadCheckpoint(const std::string& fileName)
+{
+	SolverSnapshot snapshot;
+	if (!::loadCheckpoint(fileName, snapshot))
+		return false;
+
+	stop();
+
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	PointList points = snapshot.points;
+	return applySnapshot(snapshot, points);
+}
+
+void PathFinder::reset()
+{
+	stop();
+
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	resetSolverState();
+}
+
+void PathFinder::resetSolverState()
+{
+	++m_pathVersion;
+	m_temperature = s_kStartingTemperature;
+	m_threshold = s_kStartingThreshold;
+	m_population.clear();
+	m_antColony.reset();
+	m_edgePenalties.reset();
+	m_constructionMode = ModeCount;
+	m_neighbourLists.reset();
+	m_localSearchQueue.clear();
+	m_localSearchQueueValid = false;
+	m_portfolio.clear();
+	m_convergenceHistory.clear();
+	m_finishedRunSeconds = 0;
 }
 
 void PathFinder::calculatePath()
@@ -78,21 +291,81 @@ void PathFinder::calculatePath()
 	std::cout << "Pathing started" << std::endl;
 #endif // _DEBUG
 
+	// Count allocations made by this thread against this solver
+	CounterBlock::setThreadBlock(&m_counters);
+	setTraceThreadName(getModeName(m_mode) + (m_board ? " " + std::to_string(m_boardId) : std::string()));
+	HardwareCounters hardwareCounters;
+	m_threadHardwareCounters = &hardwareCounters;
+
+	// Continue the random sequence from where the last run stopped
+	if (m_hasRandomState)
+		getRandomGenerator() = m_randomGenerator;
+
+	// Other solvers change the path without maintaining the don't look bits
+	if (m_mode != Mode::IteratedLocalSearch && m_mode != Mode::Multilevel && m_mode != Mode::Partitioned)
+		m_localSearchQueueValid = false;
+
+	m_bestOwnPathLength = std::numeric_limits<double>::infinity();
+	m_lastImprovementTime = std::chrono::high_resolution_clock::now();
+	m_runStartTime = m_lastImprovementTime;
+	recordConvergence();
+
 	if (m_mode == Mode::Genetic)
 		doGenetic();
+	else if (m_mode == Mode::Portfolio)
+		doPortfolio();
+	else if (m_mode == Mode::AntColonyOptimization)
+		doAntColony();
+	else if (m_mode == Mode::IteratedLocalSearch)
+		doIteratedLocalSearch();
+	else if (m_mode == Mode::Tabu)
+		doTabuSearch();
+	else if (m_mode == Mode::GuidedLocalSearch)
+		doGuidedLocalSearch();
+	else if (m_mode == Mode::Multilevel)
+		doMultilevel();
+	else if (m_mode == Mode::Partitioned)
+		doPartitioned();
 	else
 		doAnnealingHillclimbing();
 
+	m_randomGenerator = getRandomGenerator();
+	m_hasRandomState = true;
+
+	// Checkpoint the final state so nothing is lost when stopping
+	m_lastCheckpointTime = std::chrono::high_resolution_clock::time_point{};
+	checkpointIfDue();
+
+	recordConvergence();
+	m_finishedRunSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - m_runStartTime).count();
+
+	sampleHardwareCounters();
+	m_threadHardwareCounters = nullptr;
+	m_finishedHardwareCounters = m_hardwareCounters;
 
+	CounterBlock::setThreadBlock(nullptr);
 	m_stopped = true;
 }
 
 void PathFinder::doAnnealingHillclimbing()
 {
-	std::vector<Node*> newPath = m_path;
-	m_pathLength = calculatePathLength(m_path);
+	if (m_path.size() >= s_kTwoLevelListThreshold)
+		doAnnealingHillclimbing<TwoLevelList>();
+	else
+		doAnnealingHillclimbing<ArrayTour>();
+}
+
+template <typename TourT>
+void PathFinder::doAnnealingHillclimbing()
+{
+	TourT tour = buildTour<TourT>(m_path);
+	size_t nodeCount = tour.size();
+	setPathLength(calculatePathLength(m_points, m_path));
 	m_pathsPerSecond = 0;
-	m_temperature = s_kStartingTemperature;
+
+	// Every tour of three or fewer nodes has the same length
+	if (nodeCount < 4)
+		return;
 
 	// Start timing
 	using namespace std::chrono;
@@ -100,42 +373,97 @@ void PathFinder::doAnnealingHillclimbing()
 	unsigned long long pathsProcessed = 0;
 	unsigned long long acceptanceCalcCount = 0;
 	double acceptanceProbSum = 0;
+	bool pathChanged = false;
+	double bestPathLength = m_pathLength;
+
+	// Limit that candidate tours must be shorter than, for the modes that
+	// accept by limit. It is moved on after every move, so that the 
+	// decision itself takes a single comparison and no exp or random draw.
+	bool acceptByLimit = usesAcceptanceLimit(m_mode);
+	std::vector<double> lateAcceptanceHistory;
+	if (m_mode == LateAcceptance) {
+		size_t historyLength = std::min(std::max(s_kLateAcceptanceSpan / nodeCount, s_kMinLateAcceptanceLength), s_kMaxLateAcceptanceLength);
+		lateAcceptanceHistory.assign(historyLength, m_pathLength);
+	}
+	size_t historyIdx = 0;
+	double thresholdDecay = std::pow(0.5, 1 / (s_kThresholdHalfLife * nodeCount));
+	auto getAcceptanceLimit = [&]() {
+		switch (m_mode) {
+		case LateAcceptance:
+			// No longer than the tour of a history length of moves ago, or
+			// than the current tour, so equal lengths are accepted
+			return std::max(lateAcceptanceHistory[historyIdx], m_pathLength) + 1e-9;
+		case RecordToRecord:
+			return bestPathLength * (1 + s_kRecordDeviation / nodeCount);
+		case ThresholdAccepting:
+			return m_pathLength + getThresholdLength();
+		default:
+			return m_pathLength;
+		}
+	};
+	double acceptanceLimit = getAcceptanceLimit();
 
 	// Loop until stopped
 	while (!m_stopped) {
 		auto begin = high_resolution_clock::now();
 
-		// Try swapping two nodes on the path
-		auto it1 = selectRandomly(newPath.begin(), newPath.end());
-		auto it2 = selectRandomly(newPath.begin(), newPath.end());
-		std::swap(*it1, *it2);
-
-		// Decide whether to accept or discard the new candidate path
-		double newPathLength = calculatePathLength(newPath);
-		double acceptanceProb = calculateAcceptanceProbability(newPathLength);
-		acceptanceProbSum += acceptanceProb;
-		++acceptanceCalcCount;
-		if (randomReal() < acceptanceProb) {
-			// Update main path if the candidate path was accepted
-			size_t i = it1 - newPath.begin();
-			size_t j = it2 - newPath.begin();
-
-			std::unique_lock<std::mutex> lock(m_mutex);
-			std::swap(m_path.at(i), m_path.at(j));
-			m_pathLength = newPathLength;
-			lock.unlock();
-		}
-		else {
-			// Revert path to previous if not accepted
-			std::swap(*it1, *it2);
+		// Try a 2-opt move, reversing the path between two nodes. 
+		// Only the two replaced edges need to be measured.
+		size_t a = randomInt(static_cast<size_t>(0), nodeCount - 1);
+		size_t c = randomInt(static_cast<size_t>(0), nodeCount - 1);
+		size_t b = tour.next(a);
+		size_t d = tour.next(c);
+		if (a != c && b != c && a != d) {
+			double delta = euclideanDist(m_points, a, c) + euclideanDist(m_points, b, d)
+			             - euclideanDist(m_points, a, b) - euclideanDist(m_points, c, d);
+
+			// Decide whether to accept or discard the new candidate path
+			double newPathLength = m_pathLength + delta;
+			bool accepted;
+			if (acceptByLimit) {
+				accepted = newPathLength < acceptanceLimit;
+				acceptanceProbSum += accepted ? 1 : 0;
+			}
+			else {
+				double acceptanceProb = calculateAcceptanceProbability(newPathLength);
+				acceptanceProbSum += acceptanceProb;
+				accepted = randomReal() < acceptanceProb;
+			}
+			++acceptanceCalcCount;
+			m_counters.addMove(CounterTotals::AnnealingTwoOpt, delta, accepted);
+			if (accepted) {
+				tour.flip(a, b, c, d);
+
+				std::unique_lock<std::mutex> lock = lockPath();
+				m_pathLength = newPathLength;
+				lock.unlock();
+				pathChanged = true;
+
+				if (newPathLength < bestPathLength) {
+					bestPathLength = newPathLength;
+					m_counters.addImprovement();
+				}
+			}
+
+			if (m_mode == LateAcceptance) {
+				lateAcceptanceHistory[historyIdx] = m_pathLength;
+				historyIdx = historyIdx + 1 == lateAcceptanceHistory.size() ? 0 : historyIdx + 1;
+			}
 		}
 
 		// Reduce temperature for simulated annealing
 		if (m_mode == Anealing) {
 			auto now = high_resolution_clock::now();
 			double deltaT = duration_cast<nanoseconds>(now - begin).count() / 1000000000.0;
-			m_temperature -= m_tempDecay * deltaT * m_temperature;
+			// Only this thread writes, and draw needs no ordering, so a
+			// relaxed store keeps a fence out of every move
+			double temperature = m_temperature.load(std::memory_order_relaxed);
+			m_temperature.store(temperature - m_tempDecay * deltaT * temperature, std::memory_order_relaxed);
 		}
+		else if (m_mode == ThresholdAccepting)
+			m_threshold.store(m_threshold.load(std::memory_order_relaxed) * thresholdDecay, std::memory_order_relaxed);
+		if (acceptByLimit)
+			acceptanceLimit = getAcceptanceLimit();
 
 		// Calculate current stats
 		++pathsProcessed;
@@ -144,13 +472,55 @@ void PathFinder::doAnnealingHillclimbing()
 		using namespace std::chrono_literals;
 		if (timeSinceLastReport > 100ms) {
 			m_pathsPerSecond = pathsProcessed / (timeSinceLastReport.count() / 1000000.0);
-			m_avgAcceptanceProb = acceptanceProbSum / acceptanceCalcCount;
+			m_avgAcceptanceProb = acceptanceCalcCount ? acceptanceProbSum / acceptanceCalcCount : 0;
 			acceptanceCalcCount = 0;
 			acceptanceProbSum = 0;
 			lastReportTime = now;
 			pathsProcessed = 0;
+
+			// Publish the tour for drawing. Copying the whole tour is O(n),
+			// so this only happens once per report rather than per move.
+			if (pathChanged) {
+				TRACE_SCOPE("Publish Tour");
+				std::lock_guard<std::mutex> lock(m_mutex);
+				tour.getOrder(m_path);
+				++m_pathVersion;
+				pathChanged = false;
+			}
+
+			// Share the tour with the rest of the portfolio and restart from
+			// the portfolio's best tour when stuck
+			publishToBoard(m_path, m_pathLength);
+			std::shared_ptr<const BestTourBoard::Entry> seed = takeRestartSeed(m_pathLength);
+			if (seed) {
+				TRACE_SCOPE("Migration");
+				tour = buildTour<TourT>(seed->path);
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_path = seed->path;
+				++m_pathVersion;
+				m_pathLength = seed->pathLength;
+				bestPathLength = std::min(bestPathLength, m_pathLength);
+				std::fill(lateAcceptanceHistory.begin(), lateAcceptanceHistory.end(), m_pathLength);
+			}
+
+			recordConvergence();
+			sampleHardwareCounters();
+			checkpointIfDue();
 		}
 	}
+
+	// Publish the final tour and resync the length to remove accumulated 
+	// floating point error
+	std::lock_guard<std::mutex> lock(m_mutex);
+	tour.getOrder(m_path);
+	++m_pathVersion;
+	m_pathLength = calculatePathLength(m_points, m_path);
+}
+
+double PathFinder::getThresholdLength() const
+{
+	double averageEdgeLength = m_pathLength / std::max<size_t>(m_points.size(), 1);
+	return m_threshold.load(std::memory_order_relaxed) * averageEdgeLength;
 }
 
 void PathFinder::doGenetic()
@@ -159,23 +529,35 @@ void PathFinder::doGenetic()
 	const size_t kSelectionPoolSize = 5;
 	const double kMutationProbability = 0.2;
 
-	std::vector<std::vector<Node*>> population(kPopulationSize);
-	std::vector<std::vector<Node*>> nextGeneration(kPopulationSize);
-	std::vector<std::vector<Node*>> selectionPool1(kSelectionPoolSize);
-	std::vector<std::vector<Node*>> selectionPool2(kSelectionPoolSize);
-
-	// Make initial population
-	for (size_t i = 0; i < kPopulationSize; ++i)
-		population.at(i) = getRandomPermutation(m_path);
+	std::vector<std::vector<size_t>>& population = m_population;
+	std::vector<std::vector<size_t>> nextGeneration(kPopulationSize);
+	std::vector<std::vector<size_t>> selectionPool1(kSelectionPoolSize);
+	std::vector<std::vector<size_t>> selectionPool2(kSelectionPoolSize);
+
+	// Make initial population, or resume the previous one seeded with the
+	// current path
+	if (population.size() != kPopulationSize) {
+		TRACE_SCOPE("Build Population");
+		population.resize(kPopulationSize);
+		for (size_t i = 0; i < kPopulationSize; ++i)
+			population.at(i) = getRandomPermutation(m_path);
+	}
+	else {
+		population.at(0) = m_path;
+	}
 
 	// Start timing
 	using namespace std::chrono;
 	auto lastReportTime = high_resolution_clock::now();
 	unsigned long long generationCount = 0;
+	double bestPathLength = std::numeric_limits<double>::infinity();
 
 	while (!m_stopped) {
-		// Loop population size times
-		for (size_t i = 0; i < kPopulationSize; ++i) {
+		TRACE_SCOPE("Generation");
+
+		// Loop population size times. Large tours make a generation slow, so
+		// stopping is checked per child rather than per generation.
+		for (size_t i = 0; i < kPopulationSize && !m_stopped; ++i) {
 			// Create two selection pools
 			for (size_t i = 0; i < kSelectionPoolSize; ++i) {
 				selectionPool1.at(i) = *selectRandomly(population.begin(), population.end());
@@ -183,24 +565,42 @@ void PathFinder::doGenetic()
 			}
 
 			// Take the best one from each pool as parent 1 and parent 2 respectively
-			const std::vector<Node*>& parent1 = selectBest(selectionPool1);
-			const std::vector<Node*>& parent2 = selectBest(selectionPool2);
-
-			// Perform crossover
-			nextGeneration.at(i) = crossover(parent1, parent2);
+			const std::vector<size_t>& parent1 = selectBest(m_points, selectionPool1);
+			const std::vector<size_t>& parent2 = selectBest(m_points, selectionPool2);
+
+			// Perform crossover. Partition crossover is tried first, since 
+			// its child is shorter than both parents, but it only works once
+			// the parents share enough edges to split into components.
+			bool merged = partitionCrossover(m_points, parent1, parent2, nextGeneration.at(i));
+			m_counters.addMove(CounterTotals::PartitionCrossover, merged);
+			if (!merged) {
+				nextGeneration.at(i) = crossover(parent1, parent2);
+				m_counters.addMove(CounterTotals::Crossover, true);
+			}
 
 			// Do random mutation on random chance
-			if (randomReal() < kMutationProbability) {
+			bool mutated = randomReal() < kMutationProbability;
+			m_counters.addMove(CounterTotals::Mutation, mutated);
+			if (mutated) {
 				nextGeneration.at(i) = mutate(nextGeneration.at(i));
 			}
 		}
 
+		// Discard a generation cut short by stop so the population stays whole
+		if (m_stopped)
+			break;
+
 		// Update the initial population
 		population.swap(nextGeneration);
 
 		// Update the current best path
-		std::unique_lock<std::mutex> lock(m_mutex);
-		m_path = selectBest(population, &m_pathLength);
+		std::unique_lock<std::mutex> lock = lockPath();
+		m_path = selectBest(m_points, population, &m_pathLength);
+		++m_pathVersion;
+		if (m_pathLength < bestPathLength) {
+			bestPathLength = m_pathLength;
+			m_counters.addImprovement();
+		}
 		lock.unlock();
 
 		// Calculate current stats
@@ -212,88 +612,829 @@ void PathFinder::doGenetic()
 			m_generationsPerSecond = generationCount / (timeSinceLastReport.count() / 1000000.0);
 			lastReportTime = now;
 			generationCount = 0;
+
+			// Share the best path with the rest of the portfolio and breed 
+			// from the portfolio's best path when stuck
+			publishToBoard(m_path, m_pathLength);
+			std::shared_ptr<const BestTourBoard::Entry> seed = takeRestartSeed(m_pathLength);
+			if (seed) {
+				TRACE_SCOPE("Migration");
+				population.at(0) = seed->path;
+			}
+
+			recordConvergence();
+			sampleHardwareCounters();
+			checkpointIfDue();
 		}
 	}
 }
 
-const std::vector<Node*>& PathFinder::selectBest(const std::vector<std::vector<Node*>>& selectionPool, double* outPathLength)
+void PathFinder::doIteratedLocalSearch()
+{
+	if (m_path.size() >= s_kTwoLevelListThreshold)
+		doIteratedLocalSearch<TwoLevelList>();
+	else
+		doIteratedLocalSearch<ArrayTour>();
+}
+
+template <typename TourT>
+void PathFinder::doIteratedLocalSearch()
 {
-	size_t bestPathIdx = 0;
-	double bestPathLength = calculatePathLength(selectionPool.at(bestPathIdx));
-	for (size_t i = 1; i < selectionPool.size(); ++i) {
-		double candidatePathLength = calculatePathLength(selectionPool.at(i));
-		if (candidatePathLength < bestPathLength) {
-			bestPathLength = candidatePathLength;
-			bestPathIdx = i;
+	TourT tour = buildTour<TourT>(m_path);
+	size_t nodeCount = tour.size();
+	setPathLength(calculatePathLength(m_points, m_path));
+	m_kicksPerSecond = 0;
+
+	// A double bridge needs two segments plus a node on either side, and 
+	// smaller tours are covered by the initial local search anyway
+	const size_t kMinNodeCount = 8;
+	if (nodeCount < 4)
+		return;
+
+	if (!m_neighbourLists) {
+		TRACE_SCOPE("Build Neighbour Lists");
+		m_neighbourLists.reset(new NeighbourLists(m_points, s_kNeighbourCount));
+	}
+	LocalSearch<TourT> localSearch(tour, m_points, *m_neighbourLists);
+	localSearch.setCounters(&m_counters);
+
+	// Descend to a local optimum. When resuming, only the cities that were
+	// still queued when the last run stopped need to be looked at.
+	if (m_localSearchQueueValid) {
+		for (size_t city : m_localSearchQueue)
+			localSearch.push(city);
+	}
+	else {
+		localSearch.pushAll();
+	}
+	double pathLength = m_pathLength;
+	{
+		TRACE_SCOPE("Local Search");
+		pathLength += localSearch.optimize(&m_stopped);
+	}
+	localSearch.getQueued(m_localSearchQueue);
+	m_localSearchQueueValid = true;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	tour.getOrder(m_path);
+	++m_pathVersion;
+	m_pathLength = pathLength;
+	lock.unlock();
+
+	size_t maxSegmentLength = std::min(s_kMaxKickSegmentLength, (nodeCount - 2) / 2);
+
+	// Start timing
+	using namespace std::chrono;
+	auto lastReportTime = high_resolution_clock::now();
+	unsigned long long kickCount = 0;
+	bool pathChanged = false;
+
+	// Loop until stopped
+	while (!m_stopped && nodeCount >= kMinNodeCount) {
+		// Kick the tour out of the local optimum, then repair only the
+		// neighbourhood of the kick
+		TRACE_SCOPE("Kick");
+		size_t city = randomInt(static_cast<size_t>(0), nodeCount - 1);
+		size_t len1 = randomInt(static_cast<size_t>(1), maxSegmentLength);
+		size_t len2 = randomInt(static_cast<size_t>(1), maxSegmentLength);
+		localSearch.startLog();
+		double delta = localSearch.doubleBridgeKick(city, len1, len2);
+		delta += localSearch.optimize();
+
+		// Accept equal length tours too so the search can drift across 
+		// plateaus
+		m_counters.addMove(CounterTotals::DoubleBridgeKick, delta, delta <= 0);
+		if (delta <= 0) {
+			localSearch.clearLog();
+			lock = lockPath();
+			m_pathLength += delta;
+			lock.unlock();
+			pathChanged = true;
+
+			// Only shorter tours are kept, so any real gain is a new best
+			if (delta < 0)
+				m_counters.addImprovement();
+		}
+		else {
+			localSearch.undo();
+		}
+
+		// Calculate current stats
+		++kickCount;
+		auto now = high_resolution_clock::now();
+		auto timeSinceLastReport = duration_cast<microseconds>(now - lastReportTime);
+		using namespace std::chrono_literals;
+		if (timeSinceLastReport > 100ms) {
+			m_kicksPerSecond = kickCount / (timeSinceLastReport.count() / 1000000.0);
+			lastReportTime = now;
+			kickCount = 0;
+
+			// Publish the tour for drawing
+			if (pathChanged) {
+				TRACE_SCOPE("Publish Tour");
+				lock.lock();
+				tour.getOrder(m_path);
+				++m_pathVersion;
+				lock.unlock();
+				pathChanged = false;
+			}
+
+			// Share the tour with the rest of the portfolio and restart from
+			// the portfolio's best tour when stuck
+			publishToBoard(m_path, m_pathLength);
+			std::shared_ptr<const BestTourBoard::Entry> seed = takeRestartSeed(m_pathLength);
+			if (seed) {
+				// The seed may come from a solver that is not at a local 
+				// optimum, so look at every city again
+				TRACE_SCOPE("Migration");
+				tour = buildTour<TourT>(seed->path);
+				localSearch.pushAll();
+				delta = localSearch.optimize(&m_stopped);
+				lock.lock();
+				tour.getOrder(m_path);
+				++m_pathVersion;
+				m_pathLength = seed->pathLength + delta;
+				lock.unlock();
+			}
+
+			recordConvergence();
+			sampleHardwareCounters();
+			checkpointIfDue();
 		}
 	}
 
-	if (outPathLength)
-		*outPathLength = bestPathLength;
+	// Keep the don't look bits for the next run. Between kicks the queue is
+	// empty, so this is only non-empty if the descent was interrupted.
+	localSearch.getQueued(m_localSearchQueue);
+	m_localSearchQueueValid = true;
+
+	// Publish the final tour and resync the length to remove accumulated 
+	// floating point error
+	lock.lock();
+	tour.getOrder(m_path);
+	++m_pathVersion;
+	m_pathLength = calculatePathLength(m_points, m_path);
+}
+
+void PathFinder::doPortfolio()
+{
+	// Run at least one solver of each kind, then fill the remaining cores
+	const Mode kModes[] = { IteratedLocalSearch, Anealing, Genetic, HillClimbing, AntColonyOptimization, Tabu, GuidedLocalSearch };
+	const size_t kModeCount = sizeof(kModes) / sizeof(kModes[0]);
+	size_t solverCount = std::max(kModeCount, static_cast<size_t>(std::thread::hardware_concurrency()));
+
+	// Resume the previous portfolio if there is one, so every solver keeps
+	// its own state
+	std::unique_lock<std::mutex> lock(m_mutex);
+	std::shared_ptr<BestTourBoard> board = m_portfolio.empty() ? std::make_shared<BestTourBoard>() : m_portfolio.front()->m_board;
+	for (size_t i = m_portfolio.size(); i < solverCount; ++i) {
+		std::unique_ptr<PathFinder> solver{ new PathFinder() };
+		solver->m_points = m_points;
+		solver->m_path = m_path;
+		solver->m_pathLength = m_pathLength;
+		solver->m_mode = kModes[i % kModeCount];
+		solver->m_tempDecay = m_tempDecay;
+		solver->m_antLocalSearch = m_antLocalSearch;
+		solver->m_board = board;
+		solver->m_boardId = i;
+		solver->m_randomGenerator.seed(getRandomGenerator()());
+		solver->m_hasRandomState = true;
+		m_portfolio.push_back(std::move(solver));
+	}
 
-	return selectionPool.at(bestPathIdx);
+	// Solvers in a checkpointed portfolio keep a snapshot ready for this
+	// solver to collect
+	for (std::unique_ptr<PathFinder>& solver : m_portfolio)
+		solver->m_checkpointInterval = m_checkpointWriter ? m_checkpointInterval : std::chrono::seconds{ 0 };
+	lock.unlock();
+
+	for (std::unique_ptr<PathFinder>& solver : m_portfolio)
+		solver->calculatePathAsync();
+
+	// Show the best tour found by any solver, and every so often merge the
+	// solvers' tours into it
+	using namespace std::chrono_literals;
+	const auto kMergeInterval = 1s;
+	auto lastMergeTime = std::chrono::high_resolution_clock::now();
+	while (!m_stopped) {
+		std::this_thread::sleep_for(100ms);
+
+		auto now = std::chrono::high_resolution_clock::now();
+		if (now - lastMergeTime >= kMergeInterval) {
+			mergePortfolioTours(*board);
+			lastMergeTime = now;
+		}
+
+		TRACE_SCOPE("Collect Best");
+		std::shared_ptr<const BestTourBoard::Entry> best = board->getBest();
+		if (best && best->pathLength < m_pathLength) {
+			lock.lock();
+			m_path = best->path;
+			++m_pathVersion;
+			m_pathLength = best->pathLength;
+			lock.unlock();
+		}
+
+		recordConvergence();
+		sampleHardwareCounters();
+		checkpointIfDue();
+	}
+
+	for (std::unique_ptr<PathFinder>& solver : m_portfolio)
+		solver->stop();
+
+	// Pick up anything published while stopping, merged with the solvers'
+	// final tours
+	mergePortfolioTours(*board);
+	std::shared_ptr<const BestTourBoard::Entry> best = board->getBest();
+	lock.lock();
+	if (best && best->pathLength < m_pathLength) {
+		m_path = best->path;
+		++m_pathVersion;
+		m_pathLength = best->pathLength;
+	}
 }
 
-std::vector<Node*> PathFinder::crossover(const std::vector<Node*>& parent1, const std::vector<Node*>& parent2)
+void PathFinder::mergePortfolioTours(BestTourBoard& board)
 {
-	assert(parent1.size() == parent2.size());
+	std::shared_ptr<const BestTourBoard::Entry> best = board.getBest();
+	if (!best)
+		return;
+
+	TRACE_SCOPE("Merge Tours");
+	std::vector<size_t> mergedPath = best->path;
+	std::vector<size_t> child;
+	bool improved = false;
+	for (std::unique_ptr<PathFinder>& solver : m_portfolio) {
+		bool merged = partitionCrossover(m_points, mergedPath, solver->getPath(), child);
+		m_counters.addMove(CounterTotals::PartitionCrossover, merged);
+		if (merged) {
+			mergedPath.swap(child);
+			improved = true;
+		}
+	}
 
-	size_t cutPoint = randomInt(static_cast<size_t>(0), parent1.size());
-	std::vector<Node*> childPath(parent1.size());
+	// Published under an id past the solvers' own, since none of them found
+	// it. Stagnating solvers pick it up as a restart seed like any other.
+	if (improved)
+		board.publish(mergedPath, calculatePathLength(m_points, mergedPath), m_portfolio.size());
+}
 
-	// Take genes from parent 1
-	for (size_t i = 0; i < cutPoint; ++i) {
-		childPath.at(i) = parent1.at(i);
+void PathFinder::doAntColony()
+{
+	setPathLength(calculatePathLength(m_points, m_path));
+	m_antIterationsPerSecond = 0;
+	if (m_path.size() < 3)
+		return;
+
+	if (!m_neighbourLists) {
+		TRACE_SCOPE("Build Neighbour Lists");
+		m_neighbourLists.reset(new NeighbourLists(m_points, s_kNeighbourCount));
 	}
 
-	// Take genes from parent 2
-	for (size_t i = cutPoint; i < parent2.size(); ++i) {
-		// Make sure we don't take duplicate nodes
-		auto curChildPathEnd = std::next(childPath.begin(), i);
-		if (notIn(childPath.begin(), curChildPathEnd, parent2.at(i)))
-			childPath.at(i) = parent2.at(i);
-		else if (notIn(childPath.begin(), curChildPathEnd, parent1.at(i)))
-			childPath.at(i) = parent1.at(i);
-		else {
-			// If we couldn't take either of the parents nodes at this position,
-			// then walk backwards over both parents and select the first unused
-			// node.
-			for (size_t j = i - 1; j >= 0; --j) {
-				if (notIn(childPath.begin(), curChildPathEnd, parent2.at(j))) {
-					childPath.at(i) = parent2.at(j);
-					break;
-				}
-				if (notIn(childPath.begin(), curChildPathEnd, parent1.at(j))) {
-					childPath.at(i) = parent1.at(j);
-					break;
-				}
+	// Resume the previous colony with its trails, unless the tour has been
+	// improved on elsewhere, e.g. by another mode
+	if (!m_antColony) {
+		TRACE_SCOPE("Build Colony");
+		size_t threadCount = m_board ? 1 : std::max(1u, std::thread::hardware_concurrency());
+		m_usedUncountedThreads = m_usedUncountedThreads || threadCount > 1;
+		m_antColony.reset(new AntColony(m_points, *m_neighbourLists, m_path, m_pathLength, threadCount, getRandomGenerator()));
+	}
+	else if (m_pathLength < m_antColony->getBestPathLength()) {
+		m_antColony->setBestTour(m_path, m_pathLength);
+	}
+	m_antColony->setLocalSearch(m_antLocalSearch);
+
+	// Start timing
+	using namespace std::chrono;
+	auto lastReportTime = high_resolution_clock::now();
+	unsigned long long iterationCount = 0;
+
+	while (!m_stopped) {
+		bool improved;
+		{
+			TRACE_SCOPE("Ant Iteration");
+			improved = m_antColony->iterate(&m_stopped);
+		}
+
+		// Every ant's tour counts as a move, accepted if it is the new best
+		for (size_t i = 0; i < m_antColony->getAntCount(); ++i)
+			m_counters.addMove(CounterTotals::AntTour, improved && i == 0);
+
+		if (improved) {
+			m_counters.addImprovement();
+			std::unique_lock<std::mutex> lock = lockPath();
+			m_path = m_antColony->getBestTour();
+			++m_pathVersion;
+			m_pathLength = m_antColony->getBestPathLength();
+		}
+
+		// Calculate current stats
+		++iterationCount;
+		auto now = high_resolution_clock::now();
+		auto timeSinceLastReport = duration_cast<microseconds>(now - lastReportTime);
+		using namespace std::chrono_literals;
+		if (timeSinceLastReport > 100ms) {
+			m_antIterationsPerSecond = iterationCount / (timeSinceLastReport.count() / 1000000.0);
+			lastReportTime = now;
+			iterationCount = 0;
+
+			// Share the best tour with the rest of the portfolio and lay
+			// trails along the portfolio's best tour when stuck
+			publishToBoard(m_path, m_pathLength);
+			std::shared_ptr<const BestTourBoard::Entry> seed = takeRestartSeed(m_pathLength);
+			if (seed) {
+				TRACE_SCOPE("Migration");
+				m_antColony->setBestTour(seed->path, seed->pathLength);
+				std::unique_lock<std::mutex> lock = lockPath();
+				m_path = seed->path;
+				++m_pathVersion;
+				m_pathLength = seed->pathLength;
 			}
+
+			recordConvergence();
+			sampleHardwareCounters();
+			checkpointIfDue();
 		}
 	}
+}
 
-	return childPath;
+void PathFinder::doTabuSearch()
+{
+	if (m_path.size() >= s_kTwoLevelListThreshold)
+		doTabuSearch<TwoLevelList>();
+	else
+		doTabuSearch<ArrayTour>();
 }
 
-std::vector<Node*>& PathFinder::mutate(std::vector<Node*>& path)
+template <typename TourT>
+void PathFinder::doTabuSearch()
 {
-	const double kMutationSelectionProbability = 0.5;
-	auto it1 = selectRandomly(path.begin(), path.end());
-	auto it2 = selectRandomly(path.begin(), path.end());
-	if (randomReal() < kMutationSelectionProbability) {
-		// Mutate by swapping two nodes in the path
-		std::swap(*it1, *it2);
-	} else {
-		// Mutate by selecting two nodes in the path and 
-		// reversing the order of all nodes between them
-		auto it1Idx = std::distance(path.begin(), it1);
-		auto it2Idx = std::distance(path.begin(), it2);
-		if (it1Idx < it2Idx)
-			std::reverse(it1, std::next(it2));
-		else
-			std::reverse(it2, std::next(it1));
+	TourT tour = buildTour<TourT>(m_path);
+	size_t nodeCount = tour.size();
+	setPathLength(calculatePathLength(m_points, m_path));
+	m_pathsPerSecond = 0;
+
+	// Every tour of three or fewer nodes has the same length
+	if (nodeCount < 4)
+		return;
+
+	if (!m_neighbourLists) {
+		TRACE_SCOPE("Build Neighbour Lists");
+		m_neighbourLists.reset(new NeighbourLists(m_points, s_kNeighbourCount));
+	}
+
+	// Descend to a local optimum first, which don't look bits do far 
+	// quicker than tabu steps
+	LocalSearch<TourT> localSearch(tour, m_points, *m_neighbourLists);
+	localSearch.setCounters(&m_counters);
+	localSearch.pushAll();
+	double pathLength = m_pathLength;
+	{
+		TRACE_SCOPE("Local Search");
+		pathLength += localSearch.optimize(&m_stopped);
 	}
 
-	return path;
+	TabuSearch<TourT> tabuSearch(tour, m_points, *m_neighbourLists, pathLength);
+	tabuSearch.setCounters(&m_counters);
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_path = tabuSearch.getBestPath();
+	++m_pathVersion;
+	m_pathLength = tabuSearch.getBestPathLength();
+	lock.unlock();
+
+	// Steps without a new best tour before going back to the best tour, 
+	// by when the search has usually drifted far from it
+	const uint64_t kMaxStepsSinceBest = std::max<uint64_t>(1000, 10 * nodeCount);
+
+	// Start timing
+	using namespace std::chrono;
+	auto lastReportTime = high_resolution_clock::now();
+	unsigned long long stepCount = 0;
+
+	// Loop until stopped
+	while (!m_stopped) {
+		if (!tabuSearch.step() || tabuSearch.getStepsSinceBest() > kMaxStepsSinceBest) {
+			TRACE_SCOPE("Restart From Best");
+			tabuSearch.restartFromBest();
+		}
+
+		// Calculate current stats
+		++stepCount;
+		auto now = high_resolution_clock::now();
+		auto timeSinceLastReport = duration_cast<microseconds>(now - lastReportTime);
+		using namespace std::chrono_literals;
+		if (timeSinceLastReport > 100ms) {
+			m_pathsPerSecond = stepCount / (timeSinceLastReport.count() / 1000000.0);
+			lastReportTime = now;
+			stepCount = 0;
+
+			// Publish the best tour for drawing
+			const std::vector<size_t>& bestPath = tabuSearch.getBestPath();
+			if (tabuSearch.getBestPathLength() < m_pathLength) {
+				TRACE_SCOPE("Publish Tour");
+				lock.lock();
+				m_path = bestPath;
+				++m_pathVersion;
+				m_pathLength = tabuSearch.getBestPathLength();
+				lock.unlock();
+			}
+
+			// Share the tour with the rest of the portfolio and restart from
+			// the portfolio's best tour when stuck
+			publishToBoard(m_path, m_pathLength);
+			std::shared_ptr<const BestTourBoard::Entry> seed = takeRestartSeed(m_pathLength);
+			if (seed) {
+				TRACE_SCOPE("Migration");
+				tabuSearch.restart(seed->path, seed->pathLength);
+				lock.lock();
+				m_path = seed->path;
+				++m_pathVersion;
+				m_pathLength = seed->pathLength;
+				lock.unlock();
+			}
+
+			recordConvergence();
+			sampleHardwareCounters();
+			checkpointIfDue();
+		}
+	}
+
+	// Publish the best tour and resync the length to remove accumulated 
+	// floating point error
+	const std::vector<size_t>& bestPath = tabuSearch.getBestPath();
+	lock.lock();
+	m_path = bestPath;
+	++m_pathVersion;
+	m_pathLength = calculatePathLength(m_points, m_path);
+}
+
+void PathFinder::doGuidedLocalSearch()
+{
+	if (m_path.size() >= s_kTwoLevelListThreshold)
+		doGuidedLocalSearch<TwoLevelList>();
+	else
+		doGuidedLocalSearch<ArrayTour>();
+}
+
+template <typename TourT>
+void PathFinder::doGuidedLocalSearch()
+{
+	// Cost of one penalty relative to the average edge length of the first
+	// local optimum, as suggested for 2-opt by the guided local search paper
+	const double kPenaltyWeightFactor = 0.3;
+
+	// Most edges looked at when picking the edges to penalise
+	const size_t kMaxPenaltyScanLength = 1000;
+
+	TourT tour = buildTour<TourT>(m_path);
+	size_t nodeCount = tour.size();
+	setPathLength(calculatePathLength(m_points, m_path));
+	m_pathsPerSecond = 0;
+
+	// Every tour of three or fewer nodes has the same length
+	if (nodeCount < 4)
+		return;
+
+	if (!m_neighbourLists) {
+		TRACE_SCOPE("Build Neighbour Lists");
+		m_neighbourLists.reset(new NeighbourLists(m_points, s_kNeighbourCount));
+	}
+	if (!m_edgePenalties)
+		m_edgePenalties.reset(new EdgePenalties(m_points, *m_neighbourLists));
+	EdgePenalties& penalties = *m_edgePenalties;
+
+	// Local search only sees the penalised costs, so the real change in 
+	// length is worked out from the moves it logs
+	LocalSearch<TourT, PenalisedCost> localSearch(tour, m_points, *m_neighbourLists, PenalisedCost(penalties));
+	localSearch.setCounters(&m_counters);
+	auto descend = [&]() {
+		localSearch.startLog();
+		localSearch.optimize(&m_stopped);
+		double delta = localSearch.getLoggedLengthDelta();
+		localSearch.clearLog();
+		return delta;
+	};
+
+	localSearch.pushAll();
+	double pathLength = m_pathLength;
+	{
+		TRACE_SCOPE("Local Search");
+		pathLength += descend();
+	}
+	if (!penalties.hasPenaltyWeight())
+		penalties.setPenaltyWeight(kPenaltyWeightFactor * pathLength / nodeCount);
+
+	std::vector<size_t> bestPath;
+	tour.getOrder(bestPath);
+	double bestPathLength = pathLength;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_path = bestPath;
+	++m_pathVersion;
+	m_pathLength = bestPathLength;
+	lock.unlock();
+
+	size_t scanCity = 0;
+	size_t scanLength = std::min(nodeCount, kMaxPenaltyScanLength);
+	std::vector<size_t> penalisedCities;
+
+	// Start timing
+	using namespace std::chrono;
+	auto lastReportTime = high_resolution_clock::now();
+	unsigned long long descentCount = 0;
+	bool pathChanged = false;
+
+	// Loop until stopped
+	while (!m_stopped) {
+		// Penalise the worst edges of the local optimum, then repair only
+		// the cities around them
+		scanCity = penalties.penaliseTour(tour, scanCity, scanLength, penalisedCities);
+		for (size_t city : penalisedCities)
+			localSearch.push(city);
+		double delta = descend();
+		pathLength += delta;
+		m_counters.addMove(CounterTotals::PenaltyDescent, delta, delta < 0);
+
+		// Local optima of the penalised costs are rarely local optima of
+		// the real ones, so keep the best tour seen
+		if (pathLength < bestPathLength) {
+			tour.getOrder(bestPath);
+			bestPathLength = pathLength;
+			pathChanged = true;
+			m_counters.addImprovement();
+		}
+
+		// Calculate current stats
+		++descentCount;
+		auto now = high_resolution_clock::now();
+		auto timeSinceLastReport = duration_cast<microseconds>(now - lastReportTime);
+		using namespace std::chrono_literals;
+		if (timeSinceLastReport > 100ms) {
+			m_pathsPerSecond = descentCount / (timeSinceLastReport.count() / 1000000.0);
+			lastReportTime = now;
+			descentCount = 0;
+
+			// Publish the best tour for drawing
+			if (pathChanged) {
+				TRACE_SCOPE("Publish Tour");
+				lock.lock();
+				m_path = bestPath;
+				++m_pathVersion;
+				m_pathLength = bestPathLength;
+				lock.unlock();
+				pathChanged = false;
+			}
+
+			// Share the tour with the rest of the portfolio and restart from
+			// the portfolio's best tour when stuck. The penalties are kept.
+			publishToBoard(m_path, m_pathLength);
+			std::shared_ptr<const BestTourBoard::Entry> seed = takeRestartSeed(m_pathLength);
+			if (seed) {
+				TRACE_SCOPE("Migration");
+				tour = buildTour<TourT>(seed->path);
+				bestPath = seed->path;
+				bestPathLength = seed->pathLength;
+				localSearch.pushAll();
+				pathLength = seed->pathLength + descend();
+				lock.lock();
+				m_path = bestPath;
+				++m_pathVersion;
+				m_pathLength = bestPathLength;
+				lock.unlock();
+			}
+
+			recordConvergence();
+			sampleHardwareCounters();
+			checkpointIfDue();
+		}
+	}
+
+	// Publish the best tour and resync the length to remove accumulated 
+	// floating point error
+	lock.lock();
+	m_path = bestPath;
+	++m_pathVersion;
+	m_pathLength = calculatePathLength(m_points, m_path);
+}
+
+void PathFinder::doMultilevel()
+{
+	doConstructionThenIteratedLocalSearch([this](std::vector<size_t>& outPath) {
+		TRACE_SCOPE("Multilevel");
+		size_t threadCount = m_board ? 1 : std::max(1u, std::thread::hardware_concurrency());
+		m_usedUncountedThreads = m_usedUncountedThreads || threadCount > 1;
+		return buildMultilevelTour(m_points, *m_neighbourLists, s_kTwoLevelListThreshold, threadCount, outPath, &m_stopped, &m_counters);
+	});
+}
+
+void PathFinder::doPartitioned()
+{
+	doConstructionThenIteratedLocalSearch([this](std::vector<size_t>& outPath) {
+		TRACE_SCOPE("Partitioned");
+		// Regions are always solved on their own threads
+		size_t threadCount = m_board ? 1 : std::max(1u, std::thread::hardware_concurrency());
+		m_usedUncountedThreads = true;
+		return buildPartitionedTour(m_points, *m_neighbourLists, s_kTwoLevelListThreshold, threadCount, outPath, &m_stopped, &m_counters);
+	});
+}
+
+void PathFinder::doConstructionThenIteratedLocalSearch(const std::function<bool(std::vector<size_t>&)>& construct)
+{
+	// The constructed tour is only built once, and kept if it beats the 
+	// current tour. Iterated local search then carries on from the result.
+	if (m_constructionMode != m_mode && m_path.size() >= 4) {
+		if (!m_neighbourLists) {
+			TRACE_SCOPE("Build Neighbour Lists");
+			m_neighbourLists.reset(new NeighbourLists(m_points, s_kNeighbourCount));
+		}
+
+		std::vector<size_t> path;
+		if (!construct(path))
+			return;
+		m_constructionMode = m_mode;
+
+		double pathLength = calculatePathLength(m_points, path);
+		if (pathLength < calculatePathLength(m_points, m_path)) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_path.swap(path);
+			m_pathLength = pathLength;
+			++m_pathVersion;
+			m_localSearchQueueValid = false;
+		}
+	}
+
+	doIteratedLocalSearch();
+}
+
+void PathFinder::checkpointIfDue()
+{
+	bool isPortfolioMember = static_cast<bool>(m_board);
+	if (!m_checkpointWriter && !(isPortfolioMember && m_checkpointInterval.count() > 0))
+		return;
+
+	auto now = std::chrono::high_resolution_clock::now();
+	if (now - m_lastCheckpointTime < m_checkpointInterval)
+		return;
+	m_lastCheckpointTime = now;
+
+	TRACE_SCOPE("Snapshot");
+	m_randomGenerator = getRandomGenerator();
+	m_hasRandomState = true;
+	std::unique_ptr<SolverSnapshot> snapshot = makeSnapshot();
+	if (isPortfolioMember)
+		std::atomic_store(&m_snapshot, std::shared_ptr<const SolverSnapshot>(std::move(snapshot)));
+	else
+		m_checkpointWriter->submit(std::move(snapshot));
+}
+
+std::unique_ptr<SolverSnapshot> PathFinder::makeSnapshot()
+{
+	std::unique_ptr<SolverSnapshot> snapshot{ new SolverSnapshot() };
+	snapshot->mode = static_cast<int>(m_mode);
+	if (!m_board)
+		snapshot->points = m_points;
+	snapshot->path = m_path;
+	snapshot->pathLength = m_pathLength;
+	snapshot->temperature = m_temperature;
+	snapshot->tempDecay = m_tempDecay;
+	snapshot->threshold = m_threshold;
+	snapshot->population = m_population;
+	snapshot->localSearchQueueValid = m_localSearchQueueValid;
+	snapshot->localSearchQueue = m_localSearchQueue;
+	if (m_hasRandomState) {
+		std::ostringstream randomState;
+		randomState << m_randomGenerator;
+		snapshot->randomState = randomState.str();
+	}
+	snapshot->pathsPerSecond = m_pathsPerSecond;
+	snapshot->generationsPerSecond = m_generationsPerSecond;
+	snapshot->kicksPerSecond = m_kicksPerSecond;
+	snapshot->avgAcceptanceProb = m_avgAcceptanceProb;
+
+	// Running portfolio members are only touched through the snapshots they
+	// publish. Stopped ones can be read directly.
+	for (std::unique_ptr<PathFinder>& solver : m_portfolio) {
+		if (m_stopped) {
+			snapshot->portfolio.push_back(*solver->makeSnapshot());
+		}
+		else {
+			std::shared_ptr<const SolverSnapshot> solverSnapshot = std::atomic_load(&solver->m_snapshot);
+			if (solverSnapshot)
+				snapshot->portfolio.push_back(*solverSnapshot);
+		}
+	}
+
+	return snapshot;
+}
+
+bool PathFinder::applySnapshot(const SolverSnapshot& snapshot, const PointList& points)
+{
+	// Reject anything that does not describe a tour of the nodes
+	auto isValidTour = [&points](const std::vector<size_t>& path) {
+		if (path.size() != points.size())
+			return false;
+		std::vector<bool> visited(path.size(), false);
+		for (size_t nodeIdx : path) {
+			if (nodeIdx >= path.size() || visited.at(nodeIdx))
+				return false;
+			visited.at(nodeIdx) = true;
+		}
+		return true;
+	};
+	if (snapshot.mode < Anealing || snapshot.mode >= ModeCount || !isValidTour(snapshot.path))
+		return false;
+	for (const std::vector<size_t>& individual : snapshot.population) {
+		if (!isValidTour(individual))
+			return false;
+	}
+	for (size_t city : snapshot.localSearchQueue) {
+		if (city >= points.size())
+			return false;
+	}
+	std::mt19937 randomGenerator;
+	if (!snapshot.randomState.empty()) {
+		std::istringstream randomState(snapshot.randomState);
+		randomState >> randomGenerator;
+		if (!randomState)
+			return false;
+	}
+
+	std::vector<std::unique_ptr<PathFinder>> portfolio;
+	std::shared_ptr<BestTourBoard> board = std::make_shared<BestTourBoard>();
+	for (size_t i = 0; i < snapshot.portfolio.size(); ++i) {
+		// Portfolio members run a single mode each, never another portfolio
+		if (snapshot.portfolio.at(i).mode == Portfolio)
+			return false;
+
+		std::unique_ptr<PathFinder> solver{ new PathFinder() };
+		solver->m_board = board;
+		solver->m_boardId = i;
+		if (!solver->applySnapshot(snapshot.portfolio.at(i), points))
+			return false;
+		board->publish(solver->m_path, solver->m_pathLength, i);
+		portfolio.push_back(std::move(solver));
+	}
+
+	m_mode = static_cast<Mode>(snapshot.mode);
+	m_points = points;
+	++m_nodesVersion;
+	m_path = snapshot.path;
+	++m_pathVersion;
+	m_pathLength = snapshot.pathLength;
+	m_temperature = snapshot.temperature;
+	m_tempDecay = snapshot.tempDecay;
+	m_threshold = snapshot.threshold;
+	m_population = snapshot.population;
+	m_antColony.reset();
+	m_edgePenalties.reset();
+	m_constructionMode = ModeCount;
+	m_neighbourLists.reset();
+	m_localSearchQueue = snapshot.localSearchQueue;
+	m_localSearchQueueValid = snapshot.localSearchQueueValid;
+	m_randomGenerator = randomGenerator;
+	m_hasRandomState = !snapshot.randomState.empty();
+	m_pathsPerSecond = snapshot.pathsPerSecond;
+	m_generationsPerSecond = snapshot.generationsPerSecond;
+	m_kicksPerSecond = snapshot.kicksPerSecond;
+	m_avgAcceptanceProb = snapshot.avgAcceptanceProb;
+	m_portfolio = std::move(portfolio);
+	return true;
+}
+
+void PathFinder::publishToBoard(const std::vector<size_t>& path, double pathLength)
+{
+	if (!m_board)
+		return;
+
+	TRACE_SCOPE("Publish To Board");
+	auto begin = std::chrono::high_resolution_clock::now();
+	m_board->publish(path, pathLength, m_boardId);
+	auto end = std::chrono::high_resolution_clock::now();
+	m_counters.addWait(CounterTotals::BoardPublish, std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+}
+
+std::shared_ptr<const BestTourBoard::Entry> PathFinder::takeRestartSeed(double pathLength)
+{
+	if (!m_board)
+		return nullptr;
+
+	auto now = std::chrono::high_resolution_clock::now();
+	if (pathLength < m_bestOwnPathLength) {
+		m_bestOwnPathLength = pathLength;
+		m_lastImprovementTime = now;
+		return nullptr;
+	}
+
+	if (now - m_lastImprovementTime < s_kRestartStagnationTime)
+		return nullptr;
+
+	// Give the restarted search a full stagnation period to make progress
+	m_lastImprovementTime = now;
+	std::shared_ptr<const BestTourBoard::Entry> seed = m_board->getBest();
+	if (!seed || seed->pathLength >= pathLength)
+		return nullptr;
+
+	m_bestOwnPathLength = seed->pathLength;
+	return seed;
 }
 
 void PathFinder::calculatePathAsync()
@@ -317,6 +1458,10 @@ void PathFinder::setMode(Mode mode)
 void PathFinder::setTemperatureDecay(double tempDecay)
 {
 	m_tempDecay = tempDecay;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (std::unique_ptr<PathFinder>& solver : m_portfolio)
+		solver->setTemperatureDecay(tempDecay);
 }
 
 double PathFinder::getTemperatureDecay()
@@ -324,6 +1469,15 @@ double PathFinder::getTemperatureDecay()
 	return m_tempDecay;
 }
 
+void PathFinder::setAntLocalSearch(bool enabled)
+{
+	m_antLocalSearch = enabled;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (std::unique_ptr<PathFinder>& solver : m_portfolio)
+		solver->setAntLocalSearch(enabled);
+}
+
 bool PathFinder::stop()
 {
 	bool result = false;
@@ -340,6 +1494,8 @@ bool PathFinder::stop()
 	}
 
 	m_pathsPerSecond = 0;
+	m_kicksPerSecond = 0;
+	m_antIterationsPerSecond = 0;
 
 	return result;
 }
@@ -349,69 +1505,205 @@ bool PathFinder::isStopped()
 	return m_stopped;
 }
 
-void PathFinder::drawGraphSegment(NVGcontext* ctx, const Node& nodeFrom, const Node& nodeTo, const NVGcolor& color)
+CounterTotals PathFinder::getCounters()
 {
-	nvgStrokeWidth(ctx, 3.0f);
-	nvgStrokeColor(ctx, color);
-	nvgBeginPath(ctx);
-	// Move to center of node
-	Eigen::Vector2f start = (nodeFrom.getFloatPos() + nodeFrom.getFloatSize() / 2).cast<float>();
-	nvgMoveTo(ctx, start.x(), start.y());
-	// Draw to center of connected node
-	Eigen::Vector2f end = (nodeTo.getFloatPos() + nodeTo.getFloatSize() / 2).cast<float>();
-	nvgLineTo(ctx, end.x(), end.y());
-	nvgStroke(ctx);
+	CounterTotals totals;
+	m_counters.addTo(totals);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (std::unique_ptr<PathFinder>& solver : m_portfolio)
+		totals += solver->getCounters();
+	return totals;
 }
 
-void PathFinder::draw(NVGcontext* ctx)
+void PathFinder::setRenderSnapshotRate(double snapshotsPerSecond)
 {
-	std::unique_lock<std::mutex> lock{ m_mutex };
-	for (size_t i = 0; i < m_path.size(); ++i) {
-		Node& nodeFrom = *m_path.at(i);
-		Node& nodeTo = *m_path.at((i + 1) % m_path.size());
-		drawGraphSegment(ctx, nodeFrom, nodeTo, nvgRGBA(255, 255, 255, 255));
+	{
+		std::lock_guard<std::mutex> lock(m_renderMutex);
+		m_renderSnapshotRate = snapshotsPerSecond;
 	}
-	lock.unlock();
+	m_renderCondition.notify_all();
 
-	// Draw stats
-	nvgFontFace(ctx, "sans");
-	nvgFontSize(ctx, 24);
-	nvgFillColor(ctx, nvgRGBA(255, 255, 255, 255));
-	nvgTextAlign(ctx, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
-	std::string distText = "Distance: " + toString(m_pathLength);
-	nvgText(ctx, 10, 10, distText.c_str(), nullptr);
-	if (m_mode != Genetic)
-		nvgText(ctx, 10, 40, ("Paths Per Second: " + toString(m_pathsPerSecond)).c_str(), nullptr);
-	else
-		nvgText(ctx, 10, 40, ("Generations Per Second: " + toString(m_generationsPerSecond)).c_str(), nullptr);
-	if (m_mode == Anealing) {
-		nvgText(ctx, 10, 70, ("Temperature: " + toString(m_temperature)).c_str(), nullptr);
-		nvgText(ctx, 10, 100, ("Avg Acceptance Prob: " + toString(m_avgAcceptanceProb)).c_str(), nullptr);
-		nvgText(ctx, 10, 130, ("Temperature Decay: " + toString(m_tempDecay * 100) + "% Per Second").c_str(), nullptr);
+	if (snapshotsPerSecond > 0 && !m_renderThread.joinable())
+		m_renderThread = std::thread(&PathFinder::publishRenderSnapshots, this);
+	else if (snapshotsPerSecond <= 0 && m_renderThread.joinable())
+		m_renderThread.join();
+}
+
+std::shared_ptr<const RenderSnapshot> PathFinder::getRenderSnapshot() const
+{
+	return std::atomic_load(&m_renderSnapshot);
+}
+
+void PathFinder::publishRenderSnapshots()
+{
+	setTraceThreadName("Render Snapshots");
+
+	std::unique_lock<std::mutex> lock(m_renderMutex);
+	while (m_renderSnapshotRate > 0) {
+		std::chrono::duration<double> interval{ 1 / m_renderSnapshotRate };
+		lock.unlock();
+		publishRenderSnapshot();
+		lock.lock();
+
+		// Woken early when the rate changes
+		m_renderCondition.wait_for(lock, interval);
 	}
 }
 
-double PathFinder::euclideanDistSquared(const Node& nodeSrc, const Node& nodeDst)
+void PathFinder::publishRenderSnapshot()
 {
-	Eigen::Vector2d displacement = nodeDst.getFloatPos() - nodeSrc.getFloatPos();
-	return displacement.dot(displacement);
+	TRACE_SCOPE("Publish Render Snapshot");
+
+	std::shared_ptr<const RenderSnapshot> previous = std::atomic_load(&m_renderSnapshot);
+	std::shared_ptr<RenderSnapshot> snapshot = std::make_shared<RenderSnapshot>();
+	snapshot->version = previous ? previous->version + 1 : 1;
+
+	// Counters and history are gathered under their own locks
+	RenderStats& stats = snapshot->stats;
+	stats.stopped = m_stopped;
+	stats.tempDecay = m_tempDecay;
+	stats.pathsPerSecond = m_pathsPerSecond;
+	stats.generationsPerSecond = m_generationsPerSecond;
+	stats.kicksPerSecond = m_kicksPerSecond;
+	stats.antIterationsPerSecond = m_antIterationsPerSecond;
+	stats.avgAcceptanceProb = m_avgAcceptanceProb;
+	stats.counters = getCounters();
+	stats.hardwareCounters = getHardwareCounters();
+	stats.convergence = getConvergenceHistory();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		stats.mode = m_mode;
+		stats.pathLength = m_pathLength;
+		stats.temperature = m_mode == ThresholdAccepting ? getThresholdLength() : m_temperature.load();
+		for (std::unique_ptr<PathFinder>& solver : m_portfolio)
+			stats.portfolio.push_back({ solver->m_mode, solver->getPathLength() });
+
+		// Only copy the tour and nodes when they have changed
+		snapshot->pathVersion = m_pathVersion;
+		if (previous && previous->pathVersion == m_pathVersion) {
+			snapshot->path = previous->path;
+			snapshot->points = previous->points;
+		} else {
+			snapshot->path = std::make_shared<const std::vector<size_t>>(m_path);
+			if (previous && m_renderNodesVersion == m_nodesVersion)
+				snapshot->points = previous->points;
+			else
+				snapshot->points = std::make_shared<const PointList>(m_points);
+			m_renderNodesVersion = m_nodesVersion;
+		}
+	}
+
+	std::atomic_store(&m_renderSnapshot, std::shared_ptr<const RenderSnapshot>(std::move(snapshot)));
 }
 
-double PathFinder::euclideanDist(const Node& nodeSrc, const Node& nodeDst)
+HardwareCounterValues PathFinder::getHardwareCounters()
 {
-	return std::sqrt(euclideanDistSquared(nodeSrc, nodeDst));
+	std::lock_guard<std::mutex> lock(m_mutex);
+	HardwareCounterValues totals = m_hardwareCounters;
+	for (std::unique_ptr<PathFinder>& solver : m_portfolio)
+		totals += solver->getHardwareCounters();
+	return totals;
 }
 
-double PathFinder::calculatePathLength(const std::vector<Node*>& traversalList)
+std::vector<ConvergenceSample> PathFinder::getConvergenceHistory() const
 {
-	double accumDist = 0;
-	for (size_t i = 0; i < traversalList.size(); ++i) {
-		Node& nodeFrom = *traversalList[i];
-		Node& nodeto = *traversalList[(i + 1) % traversalList.size()];
-		accumDist += euclideanDist(nodeFrom, nodeto);
+	return m_convergenceHistory.getSamples();
+}
+
+void PathFinder::recordConvergence()
+{
+	CounterTotals counters = getCounters();
+	uint64_t tried = 0;
+	uint64_t accepted = 0;
+	for (size_t move = 0; move < CounterTotals::MoveCount; ++move) {
+		tried += counters.tried[move];
+		accepted += counters.accepted[move];
 	}
 
-	return accumDist;
+	// Counts drop when the portfolio is rebuilt, so only use them when they
+	// have grown since the last sample
+	double acceptanceRate = 0;
+	if (tried > m_historyMovesTried && accepted >= m_historyMovesAccepted)
+		acceptanceRate = static_cast<double>(accepted - m_historyMovesAccepted) / (tried - m_historyMovesTried);
+	m_historyMovesTried = tried;
+	m_historyMovesAccepted = accepted;
+
+	double seconds = m_finishedRunSeconds + std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - m_runStartTime).count();
+	double temperature = m_mode == Anealing ? m_temperature.load() : m_mode == ThresholdAccepting ? getThresholdLength() : 0;
+	m_convergenceHistory.record(seconds, m_pathLength, temperature, acceptanceRate);
+}
+
+void PathFinder::sampleHardwareCounters()
+{
+	if (!m_threadHardwareCounters || !m_threadHardwareCounters->isAvailable())
+		return;
+
+	HardwareCounterValues totals = m_finishedHardwareCounters;
+	totals += m_threadHardwareCounters->read();
+	totals.solverThreadOnly = totals.solverThreadOnly || m_usedUncountedThreads;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_hardwareCounters = totals;
+}
+
+std::unique_lock<std::mutex> PathFinder::lockPath()
+{
+	std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+	if (!lock.owns_lock()) {
+		auto begin = std::chrono::high_resolution_clock::now();
+		lock.lock();
+		auto end = std::chrono::high_resolution_clock::now();
+		m_counters.addWait(CounterTotals::PathLock, std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+	}
+	return lock;
+}
+
+void PathFinder::setPathLength(double pathLength)
+{
+	std::unique_lock<std::mutex> lock = lockPath();
+	m_pathLength = pathLength;
+}
+
+std::string PathFinder::getModeName(Mode mode)
+{
+	switch (mode) {
+	case Anealing:
+		return "Simulated Annealing";
+	case HillClimbing:
+		return "Hill Climbing";
+	case Genetic:
+		return "Genetic";
+	case IteratedLocalSearch:
+		return "Iterated Local Search";
+	case Portfolio:
+		return "Portfolio";
+	case AntColonyOptimization:
+		return "Ant Colony";
+	case Tabu:
+		return "Tabu Search";
+	case GuidedLocalSearch:
+		return "Guided Local Search";
+	case LateAcceptance:
+		return "Late Acceptance";
+	case RecordToRecord:
+		return "Record To Record";
+	case ThresholdAccepting:
+		return "Threshold Accepting";
+	case Multilevel:
+		return "Multilevel";
+	case Partitioned:
+		return "Partitioned";
+	default:
+		break;
+	}
+
+	return "";
+}
+
+bool PathFinder::usesAcceptanceLimit(Mode mode)
+{
+	return mode == LateAcceptance || mode == RecordToRecord || mode == ThresholdAccepting;
 }
 
 double PathFinder::calculateAcceptanceProbability(double candidatePathLength)
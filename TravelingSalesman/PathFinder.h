@@ -8,6 +8,8 @@
 //
 // Description  : Solver for the traveling salesman problem.
 //                Is able to draw current solution and statistics.
+//                Drawing is implemented in PathFinderDraw.cpp, so headless 
+//                tools can link the solver without nanovg.
 // Author       : Lance Chaney
 // Mail         : lance.cha7337@mediadesign.school.nz
 //
@@ -15,29 +17,109 @@
 #pragma once
 
 #include <vector>
+#include <string>
+#include <memory>
 #include <mutex>
 #include <thread>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
 
-class NVGContext;
-class Node;
+#include "Geometry.h"
+#include "BestTourBoard.h"
+#include "Instrumentation.h"
+#include "HardwareCounters.h"
+#include "ConvergenceHistory.h"
+#include "RenderSnapshot.h"
+
+struct NVGcontext;
+class NeighbourLists;
+class AntColony;
+class EdgePenalties;
+class CheckpointWriter;
+struct SolverSnapshot;
 
 class PathFinder {
 public:
 	enum Mode {
 		Anealing,
 		HillClimbing,
-		Genetic
+		Genetic,
+		IteratedLocalSearch,
+		Portfolio,
+		AntColonyOptimization,
+		Tabu,
+		GuidedLocalSearch,
+		LateAcceptance,
+		RecordToRecord,
+		ThresholdAccepting,
+		Multilevel,
+		Partitioned,
+		ModeCount
 	};
 
 
 	PathFinder();
 	~PathFinder();
 
-	// Adds a node to the solver.
-	void addNode(Node* node);
+	// Adds a node at the specified position to the solver.
+	// Returns the index used to refer to the node.
+	size_t addNode(const Eigen::Vector2d& pos);
+
+	// Removes the node at the specified index from the solver.
+	// Note: The last node is moved into the removed node's index to keep 
+	// indices contiguous (see unorderedErase).
+	void removeNode(size_t nodeIdx);
+
+	// Moves the node at the specified index to a new position.
+	void setNodePosition(size_t nodeIdx, const Eigen::Vector2d& pos);
+
+	// Replaces all nodes at once, e.g. with an instance loaded from a file.
+	// The tour is reset to visiting the nodes in order.
+	void setNodes(const PointList& points);
+
+	// Seeds the random generator used by the next run, so that runs can be
+	// reproduced. Solvers in a portfolio are seeded from this generator.
+	void setSeed(unsigned seed);
+
+	// Replaces the current tour with an externally supplied one, e.g. from 
+	// another solver, as the starting point for the next run.
+	// Returns false and leaves the tour unchanged if the path is not a 
+	// permutation of the node indices.
+	bool setPath(const std::vector<size_t>& path);
+
+	// Returns a copy of the current tour.
+	std::vector<size_t> getPath();
+
+	// Returns the length of the current tour.
+	double getPathLength();
+
+	// Returns a copy of the node positions, indexed by node.
+	PointList getNodePositions();
+
+	// Enables periodic checkpointing of the full solver state to a file.
+	// Snapshots are taken by the solver thread at most once per interval 
+	// (and when it stops), then written by a background thread.
+	// An empty file name disables checkpointing.
+	void setCheckpointFile(const std::string& fileName, std::chrono::seconds interval);
 
-	// Removes a node from the solver.
-	void removeNode(Node* node);
+	// Writes the full solver state to a checkpoint file immediately.
+	// Returns false if the file could not be written.
+	bool saveCheckpoint(const std::string& fileName);
+
+	// Replaces the nodes and solver state with the contents of a checkpoint 
+	// file, so that the next run continues where the saved run left off.
+	// Returns false and leaves the solver unchanged if the file could not be 
+	// read or is invalid.
+	bool loadCheckpoint(const std::string& fileName);
+
+	// Discards all solver state (temperature, population, don't look bits 
+	// and portfolio), so the next run starts from scratch.
+	// Note: State is kept across stop and calculatePathAsync otherwise, so
+	// stopping acts as a pause.
+	void reset();
 
 	// Tries to solve the traveling salesman problem using the current mode 
 	// (Hill Climbing or Simulated Annealing).
@@ -56,6 +138,9 @@ public:
 	// functions (calculatePath or calculatePathAsync) in.
 	void setMode(Mode mode);
 
+	// Returns the mode the solver functions run in.
+	Mode getMode() const { return m_mode; }
+
 	// Sets the temperature decay per second, expressed as a percentage of the 
 	// current temperature.
 	// E.g. 0.5 would be a 50% decrease in temperature per second.
@@ -66,6 +151,10 @@ public:
 	// E.g. 0.5 would be a 50% decrease in temperature per second.
 	double getTemperatureDecay();
 
+	// Sets whether ant colony optimization improves every ant's tour with
+	// local search. On by default.
+	void setAntLocalSearch(bool enabled);
+
 	// Halts any currently running solver.
 	// Returns true if solver had to be halted.
 	// Returns false if solver was not calculating.
@@ -74,53 +163,318 @@ public:
 	// Returns true if no solver thread is running.
 	bool isStopped();
 
-	// Draws the current path configuration can statistics.
-	void draw(NVGcontext* ctx);
-	
-private:
-	// Returns the squared distance between two nodes.
-	static double euclideanDistSquared(const Node&, const Node&);
+	// Returns the move, wait and allocation counters of this solver and any
+	// solvers in its portfolio, summed over the solver's lifetime.
+	CounterTotals getCounters();
+
+	// Returns the hardware counters of this solver's thread and any 
+	// solvers in its portfolio, summed over the solver's lifetime. Counters
+	// are sampled a few times per second, and are only available on Linux.
+	// Ant colony, multilevel and partition helper threads are not counted,
+	// which the solverThreadOnly flag of the result reports.
+	HardwareCounterValues getHardwareCounters();
+
+	// Returns the path length, temperature and acceptance rate sampled over
+	// the time the solver has run since the nodes last changed.
+	std::vector<ConvergenceSample> getConvergenceHistory() const;
+
+	// Publishes a render snapshot the given number of times per second from
+	// a thread of its own, whether or not the solver is running, until the
+	// rate is set to 0 or the solver is destroyed. Off by default, so
+	// headless tools and portfolio members pay nothing for it.
+	void setRenderSnapshotRate(double snapshotsPerSecond);
 
-	// Returns the distance between two nodes
-	static double euclideanDist(const Node&, const Node&);
+	// Returns the latest render snapshot, or nullptr if none has been 
+	// published yet. Never waits on the solver.
+	std::shared_ptr<const RenderSnapshot> getRenderSnapshot() const;
 
-	// Calculates the total path length of a given configuration.
-	static double calculatePathLength(const std::vector<Node*>&);
+	// Draws the statistics of a render snapshot. The tour itself is drawn
+	// by a TourRenderer.
+	static void draw(NVGcontext* ctx, const RenderStats& stats);
 
+	// Returns a display name for the mode.
+	static std::string getModeName(Mode mode);
+	
+private:
 	// Returns the probability that a candidate configuration will 
 	// be accepted as the new configuration.
 	double calculateAcceptanceProbability(double candidatePathLength);
 
-	// Draws a connecting line between two nodes
-	void drawGraphSegment(NVGcontext* ctx, const Node& nodeFrom, const Node& nodeTo, const NVGcolor& color);
+	// Locks m_mutex, recording the time spent waiting if another thread 
+	// holds it.
+	std::unique_lock<std::mutex> lockPath();
+
+	// Sets m_pathLength under the path lock. For the solver thread, while
+	// draw may be reading the length.
+	void setPathLength(double pathLength);
+
+	// Draws the convergence history as a chart in the given rectangle.
+	static void drawConvergence(NVGcontext* ctx, const std::vector<ConvergenceSample>& samples, float x, float y, float width, float height);
+
+	// Draws the move and hardware counters, bottom up from the given height.
+	static void drawCounters(NVGcontext* ctx, const RenderStats& stats, float bottom);
+
+	// Copies the tour and statistics into a new render snapshot and 
+	// publishes it.
+	void publishRenderSnapshot();
+
+	// Publishes render snapshots at the configured rate until it is set to
+	// 0. Runs on m_renderThread.
+	void publishRenderSnapshots();
+
+	// Returns true if the mode accepts moves by comparing the new length
+	// against a limit, rather than by acceptance probability.
+	static bool usesAcceptanceLimit(Mode mode);
 
 	// Helper function to perform anealing / hillclimbing.
+	// Picks a tour representation based on the number of nodes.
+	void doAnnealingHillclimbing();
+
+	// Performs anealing / hillclimbing using 2-opt moves on the given tour 
+	// representation (ArrayTour or TwoLevelList). Late acceptance, record
+	// to record travel and threshold accepting run on the same loop.
+	template <typename TourT>
 	void doAnnealingHillclimbing();
 
+	// Returns how much longer than the current tour threshold accepting
+	// accepts tours.
+	double getThresholdLength() const;
+
 	// Helper function to calculate path based on a genetic algorithm.
 	void doGenetic();
-	
-	// Selects the best candidate path from a list.
-	// Takes an optional pointer to output the path length into.
-	const std::vector<Node*>& selectBest(const std::vector<std::vector<Node*>>& selectionPool, double* outPathLength = nullptr);
 
-	// Constructs a new path from two other parent paths
-	std::vector<Node*> crossover(const std::vector<Node*>& parent1, const std::vector<Node*>& parent2);
+	// Resets solver state that depends on the nodes or the tour.
+	// Note: m_mutex must be held and the solver must be stopped.
+	void resetSolverState();
+
+	// Helper function to run several solvers concurrently, one per core, 
+	// sharing their best tours through a BestTourBoard.
+	void doPortfolio();
+
+	// Merges the portfolio solvers' tours into the board's best tour with
+	// partition crossover, and publishes the result if it is shorter.
+	void mergePortfolioTours(BestTourBoard& board);
+
+	// Helper function to calculate path with ant colony optimization. The 
+	// colony's ants run on all cores unless part of a portfolio.
+	void doAntColony();
+
+	// Takes a snapshot if a checkpoint is due. Top level solvers hand it to
+	// the checkpoint writer, portfolio members keep it for the portfolio.
+	// Must be called from the solver thread.
+	void checkpointIfDue();
+
+	// Updates the hardware counter totals from the solver thread's 
+	// counters. Must be called from the solver thread.
+	void sampleHardwareCounters();
+
+	// Adds the current state to the convergence history. Must be called 
+	// from the solver thread without m_mutex held.
+	void recordConvergence();
 
-	// Mutates the path in place and returns the result
-	std::vector<Node*>& mutate(std::vector<Node*>& path);
+	// Captures the full solver state.
+	std::unique_ptr<SolverSnapshot> makeSnapshot();
+
+	// Restores solver state from a snapshot of a tour of the given nodes.
+	// Returns false and leaves the solver unchanged if the snapshot is 
+	// invalid.
+	bool applySnapshot(const SolverSnapshot& snapshot, const PointList& points);
+
+	// Offers the tour to the best tour board, if this solver is part of a 
+	// portfolio.
+	void publishToBoard(const std::vector<size_t>& path, double pathLength);
+
+	// Returns the best tour on the board if this solver has not improved on 
+	// its own best tour for a while and the board holds a shorter tour.
+	// Otherwise returns nullptr.
+	std::shared_ptr<const BestTourBoard::Entry> takeRestartSeed(double pathLength);
+
+	// Helper function to perform iterated local search.
+	// Picks a tour representation based on the number of nodes.
+	void doIteratedLocalSearch();
+
+	// Repeatedly kicks the tour with a double bridge move, re-optimizes the
+	// cities around the kick and keeps the result if it is no worse.
+	template <typename TourT>
+	void doIteratedLocalSearch();
+
+	// Helper function to perform tabu search.
+	// Picks a tour representation based on the number of nodes.
+	void doTabuSearch();
+
+	// Descends to a local optimum, then applies the best admissible 2-opt
+	// move around recently changed cities over and over, restarting from
+	// the best tour when it has not improved for a while.
+	template <typename TourT>
+	void doTabuSearch();
+
+	// Helper function to perform guided local search.
+	// Picks a tour representation based on the number of nodes.
+	void doGuidedLocalSearch();
+
+	// Repeatedly penalises the edges of the local optimum with the highest
+	// utility and re-optimizes the cities around them with the penalised
+	// edge costs.
+	template <typename TourT>
+	void doGuidedLocalSearch();
+
+	// Builds a tour by coarsening the instance, touring the coarsest level
+	// and refining it back up level by level, then carries on improving it
+	// with iterated local search.
+	void doMultilevel();
+
+	// Builds a tour by solving spatial regions of the instance in parallel
+	// and repairing the boundaries between them, then carries on improving
+	// it with iterated local search.
+	void doPartitioned();
+
+	// Builds a tour with the given construction the first time the mode
+	// runs on these points, keeping it if it beats the current tour, then
+	// runs iterated local search. The construction returns false if it
+	// was stopped before finishing.
+	void doConstructionThenIteratedLocalSearch(const std::function<bool(std::vector<size_t>&)>& construct);
 
 	static const double s_kStartingTemperature;
 
-	std::vector<Node*> m_path;
+	// Late acceptance hill climbing compares candidate tours against the
+	// tour a history length of moves ago. It settles after a number of
+	// moves that grows with both the history length and the node count, so
+	// the history is this many moves divided by the node count, which
+	// settles tours of any size in about the same time. The length is
+	// kept between the minimum and maximum.
+	static const size_t s_kLateAcceptanceSpan;
+	static const size_t s_kMinLateAcceptanceLength;
+	static const size_t s_kMaxLateAcceptanceLength;
+
+	// How far above the best tour record to record travel accepts tours, as
+	// a fraction of the best tour's average edge length. A fraction of the
+	// whole length would let the search wander further on larger tours.
+	static const double s_kRecordDeviation;
+
+	// Threshold that threshold accepting starts from, as a fraction of the
+	// current tour's average edge length. Like the record to record
+	// deviation, it does not depend on the size or scale of the tour.
+	static const double s_kStartingThreshold;
+
+	// Moves per node after which the threshold has halved.
+	static const double s_kThresholdHalfLife;
+
+	// Node count at which 2-opt moves switch from an ArrayTour to a 
+	// TwoLevelList. Below this the array's low constant wins.
+	static const size_t s_kTwoLevelListThreshold;
+
+	// Number of nearest neighbours considered by local search moves.
+	static const size_t s_kNeighbourCount;
+
+	// Longest segment moved by an iterated local search kick.
+	static const size_t s_kMaxKickSegmentLength;
+
+	// How long a portfolio solver may go without improving on its own best
+	// tour before it restarts from the board's best tour.
+	static const std::chrono::milliseconds s_kRestartStagnationTime;
+
+	// Node positions, indexed by node.
+	PointList m_points;
+
+	// The current tour as a list of node indices.
+	std::vector<size_t> m_path;
 	double m_pathLength;
-	double m_temperature;
+
+	// Incremented whenever m_path or m_points change, so that copies of the
+	// tour can tell when they are stale. m_nodesVersion is only incremented
+	// when m_points change. Guarded by m_mutex.
+	uint64_t m_pathVersion;
+	uint64_t m_nodesVersion;
+
+	// Written by the annealing loop and read by draw without the lock.
+	// m_threshold is the threshold of threshold accepting, as a fraction
+	// of the average edge length.
+	std::atomic<double> m_temperature;
 	double m_tempDecay;
-	bool m_stopped;
-	double m_pathsPerSecond;
-	double m_generationsPerSecond;
-	double m_avgAcceptanceProb;
+	std::atomic<double> m_threshold;
+	std::atomic<bool> m_stopped;
+
+	// Rates written by the solver thread and read by draw.
+	std::atomic<double> m_pathsPerSecond;
+	std::atomic<double> m_generationsPerSecond;
+	std::atomic<double> m_kicksPerSecond;
+	std::atomic<double> m_antIterationsPerSecond;
+	std::atomic<double> m_avgAcceptanceProb;
+
+	// Hot path counters, written only by the solver thread.
+	CounterBlock m_counters;
+
+	// Hardware counters of the running solver thread, and the totals of 
+	// the finished runs. Both are only accessed by the solver thread. 
+	// m_hardwareCounters holds the totals including the running thread, 
+	// and is guarded by m_mutex.
+	HardwareCounters* m_threadHardwareCounters;
+	HardwareCounterValues m_finishedHardwareCounters;
+	HardwareCounterValues m_hardwareCounters;
+
+	// Set by the solver thread once a mode has handed work to helper 
+	// threads, which the counters above do not count.
+	bool m_usedUncountedThreads;
+
+	// Convergence history, and the state needed to sample it. Only the 
+	// history itself may be accessed from other threads.
+	ConvergenceHistory m_convergenceHistory;
+	std::chrono::high_resolution_clock::time_point m_runStartTime;
+	double m_finishedRunSeconds;
+	uint64_t m_historyMovesTried;
+	uint64_t m_historyMovesAccepted;
+
 	std::mutex m_mutex;
 	std::thread m_processingThread;
 	Mode m_mode;
+
+	// Portfolio state. m_board is shared by all solvers in the portfolio and
+	// is null for a solver running on its own.
+	std::vector<std::unique_ptr<PathFinder>> m_portfolio;
+	std::shared_ptr<BestTourBoard> m_board;
+	size_t m_boardId;
+	double m_bestOwnPathLength;
+	std::chrono::high_resolution_clock::time_point m_lastImprovementTime;
+
+	// State kept between runs so that a stopped solver resumes where it 
+	// left off. m_temperature and m_threshold above are kept the same way.
+	std::vector<std::vector<size_t>> m_population;
+	std::unique_ptr<NeighbourLists> m_neighbourLists;
+
+	// Ant colony kept between runs, with its pheromone trails. Refers to 
+	// m_points and m_neighbourLists, so must be reset before either changes.
+	std::unique_ptr<AntColony> m_antColony;
+	bool m_antLocalSearch;
+
+	// Guided local search penalties kept between runs. Refers to m_points 
+	// and m_neighbourLists like m_antColony.
+	std::unique_ptr<EdgePenalties> m_edgePenalties;
+
+	// The mode whose construction last built a tour for these points, or
+	// ModeCount if none has. The construction modes only run iterated
+	// local search once their tour has been built.
+	Mode m_constructionMode;
+	std::vector<size_t> m_localSearchQueue;
+	bool m_localSearchQueueValid;
+	std::mt19937 m_randomGenerator;
+	bool m_hasRandomState;
+
+	// Checkpointing state. m_snapshot is the latest snapshot of a portfolio
+	// member, only accessed through the std::atomic_* shared_ptr functions.
+	std::unique_ptr<CheckpointWriter> m_checkpointWriter;
+	std::chrono::seconds m_checkpointInterval;
+	std::chrono::high_resolution_clock::time_point m_lastCheckpointTime;
+	std::shared_ptr<const SolverSnapshot> m_snapshot;
+
+	// Render snapshot publishing. m_renderSnapshotRate is guarded by 
+	// m_renderMutex, and m_renderSnapshot is only accessed through the 
+	// std::atomic_* shared_ptr functions. m_renderNodesVersion is the 
+	// version of the nodes in m_renderSnapshot, and is only accessed by 
+	// the publishing thread.
+	std::thread m_renderThread;
+	std::mutex m_renderMutex;
+	std::condition_variable m_renderCondition;
+	double m_renderSnapshotRate;
+	std::shared_ptr<const RenderSnapshot> m_renderSnapshot;
+	uint64_t m_renderNodesVersion;
 };
\ No newline at end of file
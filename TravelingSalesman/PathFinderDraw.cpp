@@ -0,0 +1,159 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Drawing of the solver's statistics from render snapshots.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <nanovg.h>
+#include <Eigen/Dense>
+
+#include "PathFinder.h"
+#include "Tracing.h"
+#include "Utils.h"
+
+void PathFinder::draw(NVGcontext* ctx, const RenderStats& stats)
+{
+	TRACE_SCOPE("Draw");
+
+	// Draw stats
+	nvgFontFace(ctx, "sans");
+	nvgFontSize(ctx, 24);
+	nvgFillColor(ctx, nvgRGBA(255, 255, 255, 255));
+	nvgTextAlign(ctx, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+	std::string distText = "Distance: " + toString(stats.pathLength);
+	nvgText(ctx, 10, 10, distText.c_str(), nullptr);
+	if (stats.mode == Genetic)
+		nvgText(ctx, 10, 40, ("Generations Per Second: " + toString(stats.generationsPerSecond)).c_str(), nullptr);
+	else if (stats.mode == IteratedLocalSearch || stats.mode == Multilevel || stats.mode == Partitioned)
+		nvgText(ctx, 10, 40, ("Kicks Per Second: " + toString(stats.kicksPerSecond)).c_str(), nullptr);
+	else if (stats.mode == AntColonyOptimization)
+		nvgText(ctx, 10, 40, ("Ant Iterations Per Second: " + toString(stats.antIterationsPerSecond)).c_str(), nullptr);
+	else if (stats.mode == Portfolio) {
+		// List every solver's current distance
+		for (size_t i = 0; i < stats.portfolio.size(); ++i) {
+			const RenderStats::PortfolioEntry& solver = stats.portfolio.at(i);
+			std::string solverText = getModeName(static_cast<Mode>(solver.mode)) + ": " + toString(solver.pathLength);
+			nvgText(ctx, 10, 40 + 30.0f * i, solverText.c_str(), nullptr);
+		}
+	}
+	else
+		nvgText(ctx, 10, 40, ("Paths Per Second: " + toString(stats.pathsPerSecond)).c_str(), nullptr);
+	if (stats.mode == Anealing) {
+		nvgText(ctx, 10, 70, ("Temperature: " + toString(stats.temperature)).c_str(), nullptr);
+		nvgText(ctx, 10, 100, ("Avg Acceptance Prob: " + toString(stats.avgAcceptanceProb)).c_str(), nullptr);
+		nvgText(ctx, 10, 130, ("Temperature Decay: " + toString(stats.tempDecay * 100) + "% Per Second").c_str(), nullptr);
+	}
+	else if (stats.mode == ThresholdAccepting) {
+		nvgText(ctx, 10, 70, ("Threshold: " + toString(stats.temperature)).c_str(), nullptr);
+		nvgText(ctx, 10, 100, ("Acceptance Rate: " + toString(stats.avgAcceptanceProb)).c_str(), nullptr);
+		nvgText(ctx, 10, 130, ("Threshold Half Life: " + toString(s_kThresholdHalfLife) + " Moves Per Node").c_str(), nullptr);
+	}
+	else if (usesAcceptanceLimit(static_cast<Mode>(stats.mode))) {
+		nvgText(ctx, 10, 70, ("Acceptance Rate: " + toString(stats.avgAcceptanceProb)).c_str(), nullptr);
+	}
+
+	drawConvergence(ctx, stats.convergence, 530, 10, 260, 130);
+	drawCounters(ctx, stats, 790);
+}
+
+void PathFinder::drawConvergence(NVGcontext* ctx, const std::vector<ConvergenceSample>& samples, float x, float y, float width, float height)
+{
+	if (samples.size() < 2)
+		return;
+
+	// Scale to the range of lengths seen. The first samples are usually far
+	// longer than the rest, so the axis starts from the best length.
+	double minLength = samples.back().bestPathLength;
+	double maxLength = minLength;
+	for (const ConvergenceSample& sample : samples)
+		maxLength = std::max(maxLength, sample.pathLength);
+	double lengthRange = std::max(maxLength - minLength, 1e-9);
+	double duration = std::max(samples.back().seconds - samples.front().seconds, 1e-9);
+
+	nvgBeginPath(ctx);
+	nvgRect(ctx, x, y, width, height);
+	nvgFillColor(ctx, nvgRGBA(0, 0, 0, 128));
+	nvgFill(ctx);
+
+	// Current length first so the best length is drawn over it
+	for (int series = 0; series < 2; ++series) {
+		nvgBeginPath(ctx);
+		for (size_t i = 0; i < samples.size(); ++i) {
+			double length = series == 0 ? samples.at(i).pathLength : samples.at(i).bestPathLength;
+			float px = x + static_cast<float>((samples.at(i).seconds - samples.front().seconds) / duration) * width;
+			float py = y + height - static_cast<float>((length - minLength) / lengthRange) * height;
+			if (i == 0)
+				nvgMoveTo(ctx, px, py);
+			else
+				nvgLineTo(ctx, px, py);
+		}
+		nvgStrokeWidth(ctx, series == 0 ? 1.0f : 2.0f);
+		nvgStrokeColor(ctx, series == 0 ? nvgRGBA(255, 255, 255, 160) : nvgRGBA(0, 255, 0, 255));
+		nvgStroke(ctx);
+	}
+
+	nvgFontSize(ctx, 14);
+	nvgFillColor(ctx, nvgRGBA(255, 255, 255, 255));
+	nvgTextAlign(ctx, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+	nvgText(ctx, x + 4, y + 2, ("Best: " + toString(samples.back().bestPathLength)).c_str(), nullptr);
+	nvgTextAlign(ctx, NVG_ALIGN_RIGHT | NVG_ALIGN_TOP);
+	nvgText(ctx, x + width - 4, y + 2, (toString(samples.back().seconds) + "s").c_str(), nullptr);
+}
+
+void PathFinder::drawCounters(NVGcontext* ctx, const RenderStats& stats, float bottom)
+{
+	const CounterTotals& counters = stats.counters;
+
+	std::vector<std::string> lines;
+	for (size_t move = 0; move < CounterTotals::MoveCount; ++move) {
+		if (counters.tried[move] == 0)
+			continue;
+		double acceptanceRate = 100.0 * counters.accepted[move] / counters.tried[move];
+		lines.push_back(CounterTotals::getMoveName(static_cast<CounterTotals::Move>(move)) + ": " 
+			+ std::to_string(counters.accepted[move]) + " / " + std::to_string(counters.tried[move]) 
+			+ " accepted (" + toString(acceptanceRate) + "%)");
+	}
+	for (size_t wait = 0; wait < CounterTotals::WaitCount; ++wait) {
+		if (counters.waits[wait] == 0)
+			continue;
+		lines.push_back(CounterTotals::getWaitName(static_cast<CounterTotals::Wait>(wait)) + ": " 
+			+ std::to_string(counters.waits[wait]) + " waits, " 
+			+ toString(counters.waitNanoseconds[wait] / 1000000.0) + "ms");
+	}
+	if (counters.improvements > 0)
+		lines.push_back("Improvements: " + std::to_string(counters.improvements));
+	if (counters.allocations > 0)
+		lines.push_back("Allocations: " + std::to_string(counters.allocations));
+
+	// Misses are shown per thousand instructions so that solvers running at
+	// different speeds can be compared
+	const HardwareCounterValues& hardwareCounters = stats.hardwareCounters;
+	if (hardwareCounters.available[HardwareCounterValues::Instructions]) {
+		if (hardwareCounters.solverThreadOnly)
+			lines.push_back("Hardware Counters: solver thread only");
+		lines.push_back("Instructions Per Cycle: " + toString(hardwareCounters.getInstructionsPerCycle()));
+	}
+	for (size_t counter = HardwareCounterValues::CacheMisses; counter < HardwareCounterValues::CounterCount; ++counter) {
+		if (!hardwareCounters.available[counter] || hardwareCounters.values[HardwareCounterValues::Instructions] == 0)
+			continue;
+		double missesPerKiloInstruction = 1000.0 * hardwareCounters.values[counter] / hardwareCounters.values[HardwareCounterValues::Instructions];
+		lines.push_back(HardwareCounterValues::getCounterName(static_cast<HardwareCounterValues::Counter>(counter)) + ": " 
+			+ toString(missesPerKiloInstruction) + " per 1000 instructions");
+	}
+
+	nvgFontSize(ctx, 16);
+	nvgTextAlign(ctx, NVG_ALIGN_LEFT | NVG_ALIGN_BOTTOM);
+	for (size_t i = 0; i < lines.size(); ++i)
+		nvgText(ctx, 10, bottom - 20.0f * (lines.size() - 1 - i), lines.at(i).c_str(), nullptr);
+}
@@ -0,0 +1,258 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : The canvas' cities, kept as one contiguous array of
+//                positions rather than a widget per city.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "PointLayer.h"
+#include "Tracing.h"
+
+const size_t PointLayer::s_kNoPoint = std::numeric_limits<size_t>::max();
+const float PointLayer::s_kHalfSize = 7;
+const size_t PointLayer::s_kMaxDrawnPoints = 1 << 16;
+
+namespace {
+	// Half the width of the hole inside a point's outline.
+	const float s_kInnerHalfSize = 3;
+
+	// Upper bound on the number of grid cells, so that a few far away
+	// points cannot blow up the grid's memory.
+	const size_t s_kMaxCellCount = 1 << 22;
+}
+
+PointLayer::PointLayer()
+	: m_uploadNeeded{ false }
+	, m_gridValid{ false }
+	, m_gridOrigin{ 0, 0 }
+	, m_cellSize{ 1 }
+	, m_gridSize{ 0, 0 }
+{
+	m_shader.initFromFiles("point_shader", "Shaders/point_vert.glsl", "Shaders/point_frag.glsl");
+
+	// Every point is drawn as an instance of one quad, as a triangle strip
+	Eigen::MatrixXf corners(2, 4);
+	corners.col(0) << -1, -1;
+	corners.col(1) << 1, -1;
+	corners.col(2) << -1, 1;
+	corners.col(3) << 1, 1;
+	m_shader.bind();
+	m_shader.uploadAttrib("corner", corners);
+}
+
+PointLayer::~PointLayer()
+{
+	m_shader.free();
+}
+
+void PointLayer::setPoints(const PointList& points)
+{
+	m_positions.resize(2 * points.size());
+	for (size_t i = 0; i < points.size(); ++i) {
+		m_positions[2 * i] = static_cast<float>(points[i].x());
+		m_positions[2 * i + 1] = static_cast<float>(points[i].y());
+	}
+	m_uploadNeeded = true;
+	m_gridValid = false;
+}
+
+size_t PointLayer::addPoint(const Eigen::Vector2d& pos)
+{
+	m_positions.push_back(static_cast<float>(pos.x()));
+	m_positions.push_back(static_cast<float>(pos.y()));
+	m_uploadNeeded = true;
+	m_gridValid = false;
+	return size() - 1;
+}
+
+void PointLayer::removePoint(size_t pointIdx)
+{
+	size_t lastIdx = size() - 1;
+	m_positions[2 * pointIdx] = m_positions[2 * lastIdx];
+	m_positions[2 * pointIdx + 1] = m_positions[2 * lastIdx + 1];
+	m_positions.resize(2 * lastIdx);
+	m_uploadNeeded = true;
+	m_gridValid = false;
+}
+
+void PointLayer::setPointPosition(size_t pointIdx, const Eigen::Vector2d& pos)
+{
+	m_positions[2 * pointIdx] = static_cast<float>(pos.x());
+	m_positions[2 * pointIdx + 1] = static_cast<float>(pos.y());
+	m_uploadNeeded = true;
+	m_gridValid = false;
+}
+
+size_t PointLayer::size() const
+{
+	return m_positions.size() / 2;
+}
+
+size_t PointLayer::pick(const Eigen::Vector2d& pos, double halfSize)
+{
+	if (size() == 0)
+		return s_kNoPoint;
+	if (!m_gridValid)
+		rebuildGrid();
+
+	Eigen::Vector2i minCell = getCell(pos - Eigen::Vector2d{ halfSize, halfSize });
+	Eigen::Vector2i maxCell = getCell(pos + Eigen::Vector2d{ halfSize, halfSize });
+	size_t closestIdx = s_kNoPoint;
+	double closestDistSq = std::numeric_limits<double>::infinity();
+	for (int y = minCell.y(); y <= maxCell.y(); ++y) {
+		for (int x = minCell.x(); x <= maxCell.x(); ++x) {
+			size_t cell = static_cast<size_t>(y) * m_gridSize.x() + x;
+			for (uint32_t i = m_cellStarts[cell]; i < m_cellStarts[cell + 1]; ++i) {
+				uint32_t pointIdx = m_cellPoints[i];
+				double dx = m_positions[2 * pointIdx] - pos.x();
+				double dy = m_positions[2 * pointIdx + 1] - pos.y();
+				if (std::abs(dx) > halfSize || std::abs(dy) > halfSize)
+					continue;
+				double distSq = dx * dx + dy * dy;
+				if (distSq < closestDistSq) {
+					closestDistSq = distSq;
+					closestIdx = pointIdx;
+				}
+			}
+		}
+	}
+
+	return closestIdx;
+}
+
+void PointLayer::draw(const ViewTransform& view)
+{
+	TRACE_SCOPE("Draw Points");
+
+	if (size() == 0)
+		return;
+
+	m_shader.bind();
+	if (m_uploadNeeded || view != m_drawnView)
+		updateVisiblePoints(view);
+
+	size_t visibleCount = m_visibleCenters.size() / 2;
+	if (visibleCount == 0)
+		return;
+
+	m_shader.setUniform("viewOffset", Eigen::Vector2f{ view.offset.cast<float>() });
+	m_shader.setUniform("viewScale", static_cast<float>(view.scale));
+	m_shader.setUniform("canvasSize", Eigen::Vector2f{ view.canvasSize.cast<float>() });
+	m_shader.setUniform("halfSize", s_kHalfSize);
+	m_shader.setUniform("innerFraction", s_kInnerHalfSize / s_kHalfSize);
+	m_shader.setUniform("color", Eigen::Vector4f{ 1, 0, 0, 1 });
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(visibleCount));
+}
+
+void PointLayer::updateVisiblePoints(const ViewTransform& view)
+{
+	TRACE_SCOPE("Upload Points");
+
+	m_drawnView = view;
+	m_uploadNeeded = false;
+	m_visibleCenters.clear();
+	if (!m_gridValid)
+		rebuildGrid();
+
+	// Include points whose outline pokes into the view
+	Eigen::AlignedBox2d visibleBox = view.getVisibleBox();
+	double margin = s_kHalfSize / view.scale;
+	visibleBox.min() -= Eigen::Vector2d{ margin, margin };
+	visibleBox.max() += Eigen::Vector2d{ margin, margin };
+	Eigen::Vector2i minCell = getCell(visibleBox.min());
+	Eigen::Vector2i maxCell = getCell(visibleBox.max());
+
+	// There is about one point per cell, so a huge range of cells is sure to
+	// hold too many points, and can be rejected without counting them
+	size_t rangeCellCount = static_cast<size_t>(maxCell.x() - minCell.x() + 1) * (maxCell.y() - minCell.y() + 1);
+	if (rangeCellCount > 4 * s_kMaxDrawnPoints)
+		return;
+
+	size_t candidateCount = 0;
+	for (int y = minCell.y(); y <= maxCell.y(); ++y) {
+		size_t rowStart = static_cast<size_t>(y) * m_gridSize.x();
+		candidateCount += m_cellStarts[rowStart + maxCell.x() + 1] - m_cellStarts[rowStart + minCell.x()];
+	}
+	if (candidateCount > 4 * s_kMaxDrawnPoints)
+		return;
+
+	for (int y = minCell.y(); y <= maxCell.y(); ++y) {
+		size_t rowStart = static_cast<size_t>(y) * m_gridSize.x();
+		for (uint32_t i = m_cellStarts[rowStart + minCell.x()]; i < m_cellStarts[rowStart + maxCell.x() + 1]; ++i) {
+			uint32_t pointIdx = m_cellPoints[i];
+			Eigen::Vector2d pos{ m_positions[2 * pointIdx], m_positions[2 * pointIdx + 1] };
+			if (!visibleBox.contains(pos))
+				continue;
+			m_visibleCenters.push_back(m_positions[2 * pointIdx]);
+			m_visibleCenters.push_back(m_positions[2 * pointIdx + 1]);
+		}
+	}
+	if (m_visibleCenters.size() / 2 > s_kMaxDrawnPoints) {
+		m_visibleCenters.clear();
+		return;
+	}
+
+	if (!m_visibleCenters.empty()) {
+		m_shader.uploadAttrib("center", Eigen::Map<const Eigen::MatrixXf>(m_visibleCenters.data(), 2, m_visibleCenters.size() / 2));
+		glVertexAttribDivisor(m_shader.attrib("center"), 1);
+	}
+}
+
+void PointLayer::rebuildGrid()
+{
+	TRACE_SCOPE("Build Point Grid");
+
+	size_t pointCount = size();
+	Eigen::Vector2d minPos{ m_positions[0], m_positions[1] };
+	Eigen::Vector2d maxPos = minPos;
+	for (size_t i = 1; i < pointCount; ++i) {
+		Eigen::Vector2d pos{ m_positions[2 * i], m_positions[2 * i + 1] };
+		minPos = minPos.cwiseMin(pos);
+		maxPos = maxPos.cwiseMax(pos);
+	}
+
+	// Aim for about one point per cell
+	Eigen::Vector2d extent = (maxPos - minPos).cwiseMax(Eigen::Vector2d{ 1, 1 });
+	size_t cellCount = std::min(std::max<size_t>(pointCount, 1), s_kMaxCellCount);
+	m_cellSize = std::sqrt(extent.x() * extent.y() / cellCount);
+	m_gridOrigin = minPos;
+	m_gridSize = { static_cast<int>(extent.x() / m_cellSize) + 1, static_cast<int>(extent.y() / m_cellSize) + 1 };
+
+	// Counting sort of the points by cell
+	m_cellStarts.assign(static_cast<size_t>(m_gridSize.x()) * m_gridSize.y() + 1, 0);
+	std::vector<uint32_t> pointCells(pointCount);
+	for (size_t i = 0; i < pointCount; ++i) {
+		Eigen::Vector2i cell = getCell({ m_positions[2 * i], m_positions[2 * i + 1] });
+		pointCells[i] = static_cast<uint32_t>(cell.y() * m_gridSize.x() + cell.x());
+		++m_cellStarts[pointCells[i] + 1];
+	}
+	for (size_t cell = 1; cell < m_cellStarts.size(); ++cell)
+		m_cellStarts[cell] += m_cellStarts[cell - 1];
+
+	m_cellPoints.resize(pointCount);
+	std::vector<uint32_t> cellFill(m_cellStarts.begin(), m_cellStarts.end() - 1);
+	for (size_t i = 0; i < pointCount; ++i)
+		m_cellPoints[cellFill[pointCells[i]]++] = static_cast<uint32_t>(i);
+
+	m_gridValid = true;
+}
+
+Eigen::Vector2i PointLayer::getCell(const Eigen::Vector2d& pos) const
+{
+	Eigen::Vector2d cell = (pos - m_gridOrigin) / m_cellSize;
+	return {
+		static_cast<int>(std::min(std::max(cell.x(), 0.0), m_gridSize.x() - 1.0)),
+		static_cast<int>(std::min(std::max(cell.y(), 0.0), m_gridSize.y() - 1.0))
+	};
+}
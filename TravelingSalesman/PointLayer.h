@@ -0,0 +1,102 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : The canvas' cities, kept as one contiguous array of
+//                positions rather than a widget per city.
+//                Picking and view culling go through a uniform grid that is
+//                rebuilt lazily after the cities change, and the visible
+//                cities are drawn with a single instanced draw call, so the
+//                canvas stays interactive with millions of cities.
+//                Indices mirror the solver's: a removed city is replaced by
+//                the last city.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Dense>
+#include <nanogui/glutil.h>
+
+#include "Geometry.h"
+#include "ViewTransform.h"
+
+class PointLayer {
+public:
+	// Loads the shaders. Must be called with the GL context current.
+	PointLayer();
+	~PointLayer();
+
+	PointLayer(const PointLayer&) = delete;
+	PointLayer& operator=(const PointLayer&) = delete;
+
+	// Replaces all points.
+	void setPoints(const PointList& points);
+
+	// Appends a point and returns its index.
+	size_t addPoint(const Eigen::Vector2d& pos);
+
+	// Removes a point, moving the last point into its index.
+	void removePoint(size_t pointIdx);
+
+	void setPointPosition(size_t pointIdx, const Eigen::Vector2d& pos);
+
+	size_t size() const;
+
+	// Returns the index of the point closest to pos whose square (of half
+	// width halfSize) contains pos, or s_kNoPoint if there is none.
+	size_t pick(const Eigen::Vector2d& pos, double halfSize);
+
+	// Draws the points in view as square outlines of a fixed pixel size into
+	// the current viewport, which must cover the view's canvas. Nothing is
+	// drawn when more than s_kMaxDrawnPoints are in view, as they would
+	// cover the canvas.
+	void draw(const ViewTransform& view);
+
+	static const size_t s_kNoPoint;
+
+	// Half the width of a point's square, including its outline.
+	static const float s_kHalfSize;
+
+	// Most points drawn at once.
+	static const size_t s_kMaxDrawnPoints;
+
+private:
+	// Rebuilds the grid from the current positions.
+	void rebuildGrid();
+
+	// Returns the grid cell containing pos, clamped to the grid.
+	Eigen::Vector2i getCell(const Eigen::Vector2d& pos) const;
+
+	// Gathers and uploads the centers of the points in view, or none if
+	// there are too many to draw.
+	void updateVisiblePoints(const ViewTransform& view);
+
+	nanogui::GLShader m_shader;
+
+	// Point positions as consecutive x, y pairs.
+	std::vector<float> m_positions;
+
+	// The view and positions the uploaded points were gathered for
+	ViewTransform m_drawnView;
+	bool m_uploadNeeded;
+	std::vector<float> m_visibleCenters;
+
+	// Uniform grid over the points' bounding box. m_cellStarts holds the
+	// offset of each cell's point indices in m_cellPoints, plus one past
+	// the end, so a cell's points are a contiguous range.
+	bool m_gridValid;
+	Eigen::Vector2d m_gridOrigin;
+	double m_cellSize;
+	Eigen::Vector2i m_gridSize;
+	std::vector<uint32_t> m_cellStarts;
+	std::vector<uint32_t> m_cellPoints;
+};
@@ -0,0 +1,66 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : What the UI draws of a solver, copied out of the solver at
+//                a fixed rate so that drawing never touches live solver
+//                state or waits on solver locks.
+//                Snapshots are immutable once published. The tour and node
+//                positions are shared between snapshots until they change,
+//                so an unchanged tour costs nothing to republish.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Geometry.h"
+#include "Instrumentation.h"
+#include "HardwareCounters.h"
+#include "ConvergenceHistory.h"
+
+// Statistics shown next to the tour.
+struct RenderStats {
+	// Current distance of one solver in a portfolio.
+	struct PortfolioEntry {
+		int mode;
+		double pathLength;
+	};
+
+	int mode;
+	bool stopped;
+	double pathLength;
+	double temperature;
+	double tempDecay;
+	double pathsPerSecond;
+	double generationsPerSecond;
+	double kicksPerSecond;
+	double antIterationsPerSecond;
+	double avgAcceptanceProb;
+	std::vector<PortfolioEntry> portfolio;
+	CounterTotals counters;
+	HardwareCounterValues hardwareCounters;
+	std::vector<ConvergenceSample> convergence;
+};
+
+struct RenderSnapshot {
+	// Incremented for every published snapshot.
+	uint64_t version;
+
+	// Version of the tour and nodes, which only changes when either does.
+	uint64_t pathVersion;
+
+	// The tour as node indices, and the node positions indexed by node.
+	std::shared_ptr<const std::vector<size_t>> path;
+	std::shared_ptr<const PointList> points;
+
+	RenderStats stats;
+};
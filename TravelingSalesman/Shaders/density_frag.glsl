@@ -0,0 +1,9 @@
+#version 330 core
+uniform vec4 color;
+
+in float tileAlpha;
+out vec4 fragColor;
+
+void main() {
+   fragColor = vec4(color.rgb, color.a * tileAlpha);
+}
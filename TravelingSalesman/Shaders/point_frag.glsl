@@ -0,0 +1,14 @@
+#version 330 core
+uniform vec4 color;
+
+// Fraction of the quad's half size left hollow inside the outline
+uniform float innerFraction;
+
+in vec2 local;
+out vec4 fragColor;
+
+void main() {
+   if (max(abs(local.x), abs(local.y)) < innerFraction)
+      discard;
+   fragColor = color;
+}
@@ -0,0 +1,28 @@
+#version 330 core
+// Corner of the quad, from -1 to 1 on each axis
+in vec2 corner;
+
+// Position of the point, one per instance
+in vec2 center;
+
+// World position shown at the top left of the canvas, and canvas pixels per
+// world unit
+uniform vec2 viewOffset;
+uniform float viewScale;
+
+// Size of the canvas in pixels
+uniform vec2 canvasSize;
+
+// Half the width of the quad in pixels, whatever the zoom
+uniform float halfSize;
+
+out vec2 local;
+
+void main() {
+   local = corner;
+
+   // Canvas positions have their origin at the top left of the canvas
+   vec2 canvasPos = (center - viewOffset) * viewScale + corner * halfSize;
+   vec2 ndc = canvasPos / canvasSize * 2.0 - 1.0;
+   gl_Position = vec4(ndc.x, -ndc.y, 0, 1);
+}
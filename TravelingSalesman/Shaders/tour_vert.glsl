@@ -0,0 +1,16 @@
+#version 330 core
+in vec2 position;
+
+// World position shown at the top left of the canvas, and canvas pixels per
+// world unit
+uniform vec2 viewOffset;
+uniform float viewScale;
+
+// Size of the canvas in pixels
+uniform vec2 canvasSize;
+
+void main() {
+   // Canvas positions have their origin at the top left of the canvas
+   vec2 ndc = (position - viewOffset) * viewScale / canvasSize * 2.0 - 1.0;
+   gl_Position = vec4(ndc.x, -ndc.y, 0, 1);
+}
@@ -0,0 +1,284 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Tabu search over neighbour list 2-opt moves.
+//                Every step applies the best admissible move around the
+//                cities touched by the previous step and a few random ones,
+//                even if it makes the tour longer. Edges removed by a step
+//                may not be added back for a number of steps, unless that
+//                gives a new best tour (aspiration).
+//                The tabu check reads the step at which each candidate edge
+//                was last removed. That is O(1) for the added t1-t3 edge,
+//                whose neighbour index is known, and O(k) in the neighbour
+//                count for the t2-t4 edge, which has to be looked up in both
+//                ends' lists. Edges that are not candidates of either end
+//                are never tabu.
+//                Works on any tour with the ArrayTour interface.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "Geometry.h"
+#include "NeighbourLists.h"
+#include "Instrumentation.h"
+#include "Utils.h"
+
+template <typename TourT>
+class TabuSearch {
+public:
+	// Starts searching from the tour, which should be a local optimum.
+	TabuSearch(TourT& tour, const PointList& points, const NeighbourLists& neighbours, double pathLength);
+
+	// Applies the best admissible move. Returns false if every move around
+	// the looked at cities was tabu.
+	bool step();
+
+	// Returns the best tour found, which is copied out of the tour when the
+	// search is about to leave it.
+	const std::vector<size_t>& getBestPath();
+	double getBestPathLength() const { return m_bestPathLength; }
+
+	// Returns the length of the current tour.
+	double getPathLength() const { return m_pathLength; }
+
+	// Returns the number of steps since the best tour was last improved on.
+	uint64_t getStepsSinceBest() const { return m_step - m_bestStep; }
+
+	// Carries on from the best tour, forgetting the tabu list.
+	void restartFromBest();
+
+	// Carries on from another tour, e.g. from another solver.
+	void restart(const std::vector<size_t>& path, double pathLength);
+
+	// Sets the block that the move applied by every step is counted in, or
+	// nullptr to not count them.
+	void setCounters(CounterBlock* counters) { m_counters = counters; }
+
+	// Number of random cities looked at by every step, on top of the ends
+	// of the edges changed by the previous step. Keeping this small makes
+	// the search mostly repair around its own last move.
+	static const size_t s_kRandomCityCount = 2;
+
+	// Number of steps that a removed edge stays tabu for.
+	static const uint64_t s_kTabuTenure = 30;
+
+private:
+	// Looks at the 2-opt moves that add an edge from t1 to one of its
+	// neighbours, keeping the best admissible one in the m_move* members.
+	void evaluateCity(size_t t1);
+
+	// Returns true if the edge from a to its neighbour may not be added.
+	bool isCandidateTabu(size_t a, size_t neighbourIdx) const;
+
+	// Returns true if the edge between a and b may not be added. Scans
+	// both neighbour lists, so costs O(k).
+	bool isTabu(size_t a, size_t b) const;
+
+	// Records that the edge between a and b was removed. Costs O(k) like
+	// isTabu.
+	void setTabu(size_t a, size_t b);
+
+	// Copies the tour into the best tour if it is shorter, counting it as an
+	// improvement.
+	void saveBest();
+
+	double dist(size_t a, size_t b) const { return euclideanDist(m_points, a, b); }
+
+	static const double s_kEpsilon;
+
+	TourT& m_tour;
+	const PointList& m_points;
+	const NeighbourLists& m_neighbours;
+
+	double m_pathLength;
+	std::vector<size_t> m_bestPath;
+	double m_bestPathLength;
+	uint64_t m_bestStep;
+
+	// The step at which each candidate edge was last removed, indexed like
+	// the neighbour lists. Both directions of an edge are kept up to date.
+	std::vector<uint64_t> m_removedSteps;
+	uint64_t m_step;
+
+	// Cities at the ends of the edges changed by the last step.
+	size_t m_lastCities[4];
+	size_t m_lastCityCount;
+
+	// Best admissible move found by the current step.
+	double m_moveDelta;
+	size_t m_move[4];
+
+	CounterBlock* m_counters;
+};
+
+template <typename TourT>
+const double TabuSearch<TourT>::s_kEpsilon = 1e-9;
+
+template <typename TourT>
+TabuSearch<TourT>::TabuSearch(TourT& tour, const PointList& points, const NeighbourLists& neighbours, double pathLength)
+	: m_tour{ tour }
+	, m_points{ points }
+	, m_neighbours{ neighbours }
+	, m_pathLength{ pathLength }
+	, m_bestPathLength{ std::numeric_limits<double>::infinity() }
+	, m_bestStep{ 0 }
+	, m_removedSteps(tour.size() * neighbours.getNeighbourCount(), 0)
+	, m_step{ s_kTabuTenure }
+	, m_lastCityCount{ 0 }
+	, m_counters{ nullptr }
+{
+	saveBest();
+}
+
+template <typename TourT>
+bool TabuSearch<TourT>::step()
+{
+	++m_step;
+	m_moveDelta = std::numeric_limits<double>::infinity();
+	for (size_t i = 0; i < m_lastCityCount; ++i)
+		evaluateCity(m_lastCities[i]);
+	for (size_t i = 0; i < s_kRandomCityCount; ++i)
+		evaluateCity(randomInt(static_cast<size_t>(0), m_tour.size() - 1));
+
+	if (m_moveDelta == std::numeric_limits<double>::infinity())
+		return false;
+
+	// Leaving a local optimum, which may be the best tour so far
+	if (m_moveDelta >= -s_kEpsilon)
+		saveBest();
+
+	size_t t1 = m_move[0], t2 = m_move[1], t3 = m_move[2], t4 = m_move[3];
+	if (t2 == m_tour.next(t1))
+		m_tour.flip(t1, t2, t3, t4);
+	else
+		m_tour.flip(t2, t1, t4, t3);
+	setTabu(t1, t2);
+	setTabu(t3, t4);
+	m_pathLength += m_moveDelta;
+	if (m_counters)
+		m_counters->addMove(CounterTotals::TabuTwoOpt, m_moveDelta, true);
+
+	m_lastCities[0] = t1;
+	m_lastCities[1] = t2;
+	m_lastCities[2] = t3;
+	m_lastCities[3] = t4;
+	m_lastCityCount = 4;
+	return true;
+}
+
+template <typename TourT>
+const std::vector<size_t>& TabuSearch<TourT>::getBestPath()
+{
+	saveBest();
+	return m_bestPath;
+}
+
+template <typename TourT>
+void TabuSearch<TourT>::restartFromBest()
+{
+	std::vector<size_t> bestPath = getBestPath();
+	restart(bestPath, m_bestPathLength);
+}
+
+template <typename TourT>
+void TabuSearch<TourT>::restart(const std::vector<size_t>& path, double pathLength)
+{
+	m_tour = TourT(path);
+	m_pathLength = pathLength;
+	m_lastCityCount = 0;
+
+	// Moving the step on past the tenure clears the tabu list
+	m_step += s_kTabuTenure;
+	m_bestStep = m_step;
+	if (pathLength < m_bestPathLength) {
+		m_bestPath = path;
+		m_bestPathLength = pathLength;
+	}
+}
+
+template <typename TourT>
+void TabuSearch<TourT>::evaluateCity(size_t t1)
+{
+	const size_t* neighbours = m_neighbours.getNeighbours(t1);
+	for (size_t direction = 0; direction < 2; ++direction) {
+		bool forward = direction == 0;
+		size_t t2 = forward ? m_tour.next(t1) : m_tour.prev(t1);
+		double removedDist = dist(t1, t2);
+		for (size_t i = 0; i < m_neighbours.getNeighbourCount(); ++i) {
+			size_t t3 = neighbours[i];
+			size_t t4 = forward ? m_tour.next(t3) : m_tour.prev(t3);
+			if (t3 == t2 || t4 == t1)
+				continue;
+
+			double delta = dist(t1, t3) + dist(t2, t4) - removedDist - dist(t3, t4);
+			if (delta >= m_moveDelta)
+				continue;
+
+			// Tabu moves are only allowed if they beat the best tour, which
+			// may be the current one if it has not been saved yet
+			bool aspiration = m_pathLength + delta < std::min(m_pathLength, m_bestPathLength) - s_kEpsilon;
+			if (!aspiration && (isCandidateTabu(t1, i) || isTabu(t2, t4)))
+				continue;
+
+			m_moveDelta = delta;
+			m_move[0] = t1;
+			m_move[1] = t2;
+			m_move[2] = t3;
+			m_move[3] = t4;
+		}
+	}
+}
+
+template <typename TourT>
+bool TabuSearch<TourT>::isCandidateTabu(size_t a, size_t neighbourIdx) const
+{
+	return m_step - m_removedSteps[a * m_neighbours.getNeighbourCount() + neighbourIdx] <= s_kTabuTenure;
+}
+
+template <typename TourT>
+bool TabuSearch<TourT>::isTabu(size_t a, size_t b) const
+{
+	size_t k = m_neighbours.getNeighbourCount();
+	size_t i = m_neighbours.findNeighbour(a, b);
+	if (i < k)
+		return isCandidateTabu(a, i);
+	i = m_neighbours.findNeighbour(b, a);
+	return i < k && isCandidateTabu(b, i);
+}
+
+template <typename TourT>
+void TabuSearch<TourT>::setTabu(size_t a, size_t b)
+{
+	size_t k = m_neighbours.getNeighbourCount();
+	size_t ab = m_neighbours.findNeighbour(a, b);
+	size_t ba = m_neighbours.findNeighbour(b, a);
+	if (ab < k)
+		m_removedSteps[a * k + ab] = m_step;
+	if (ba < k)
+		m_removedSteps[b * k + ba] = m_step;
+}
+
+template <typename TourT>
+void TabuSearch<TourT>::saveBest()
+{
+	if (m_pathLength >= m_bestPathLength - s_kEpsilon)
+		return;
+
+	m_tour.getOrder(m_bestPath);
+	m_bestPathLength = m_pathLength;
+	m_bestStep = m_step;
+	if (m_counters)
+		m_counters->addImprovement();
+}
@@ -0,0 +1,254 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Draws a solver's tour with GL, at a level of detail that
+//                depends on what is visible rather than on the tour size.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+
+#include "TourRenderer.h"
+#include "Tracing.h"
+
+const size_t TourRenderer::s_kMaxDrawnEdges = 1 << 18;
+const double TourRenderer::s_kMinEdgePixels = 1;
+
+namespace {
+	// Target number of edges per tile
+	const size_t s_kEdgesPerTile = 64;
+
+	// Upper bound on the number of tiles along each side, so that culling
+	// stays cheap and a long thin tour cannot make a huge grid
+	const float s_kMaxTilesPerSide = 256;
+	const size_t s_kMaxTileCount = 256 * 256;
+}
+
+TourRenderer::TourRenderer()
+	: m_version{ std::numeric_limits<uint64_t>::max() }
+	, m_edgeCount{ 0 }
+	, m_gridOrigin{ 0, 0 }
+	, m_tileSize{ 1 }
+	, m_gridSize{ 0, 0 }
+	, m_drawListValid{ false }
+	, m_showingDensity{ false }
+{
+	m_lineShader.initFromFiles("tour_shader", "Shaders/tour_vert.glsl", "Shaders/tour_frag.glsl");
+	m_densityShader.initFromFiles("tour_density_shader", "Shaders/density_vert.glsl", "Shaders/density_frag.glsl");
+}
+
+TourRenderer::~TourRenderer()
+{
+	m_lineShader.free();
+	m_densityShader.free();
+}
+
+void TourRenderer::draw(const RenderSnapshot& snapshot, const ViewTransform& view)
+{
+	TRACE_SCOPE("Draw Tour");
+
+	if (snapshot.pathVersion != m_version) {
+		TRACE_SCOPE("Upload Tour");
+
+		m_version = snapshot.pathVersion;
+		buildVertices(snapshot);
+
+		// A line needs at least two distinct nodes (three vertices with the
+		// closing one)
+		m_edgeCount = m_vertices.cols() < 3 ? 0 : static_cast<uint32_t>(m_vertices.cols() - 1);
+		if (m_edgeCount > 0) {
+			m_lineShader.bind();
+			m_lineShader.uploadAttrib("position", m_vertices);
+		}
+		rebuildTiles();
+		m_drawListValid = false;
+	}
+
+	if (m_edgeCount == 0)
+		return;
+
+	if (!m_drawListValid || view != m_drawnView)
+		updateDrawList(view);
+
+	nanogui::GLShader& shader = m_showingDensity ? m_densityShader : m_lineShader;
+	shader.bind();
+	shader.setUniform("viewOffset", Eigen::Vector2f{ view.offset.cast<float>() });
+	shader.setUniform("viewScale", static_cast<float>(view.scale));
+	shader.setUniform("canvasSize", Eigen::Vector2f{ view.canvasSize.cast<float>() });
+	shader.setUniform("color", Eigen::Vector4f{ 1, 1, 1, 1 });
+	if (m_showingDensity) {
+		if (!m_densityAlphas.empty())
+			shader.drawArray(GL_TRIANGLES, 0, static_cast<uint32_t>(m_densityAlphas.size()));
+	} else {
+		if (!m_lineIndices.empty())
+			shader.drawIndexed(GL_LINES, 0, static_cast<uint32_t>(m_lineIndices.size() / 2));
+	}
+}
+
+bool TourRenderer::isShowingDensity() const
+{
+	return m_showingDensity;
+}
+
+void TourRenderer::buildVertices(const RenderSnapshot& snapshot)
+{
+	const std::vector<size_t>& path = *snapshot.path;
+	const PointList& points = *snapshot.points;
+
+	// Close the loop by repeating the first node at the end
+	m_vertices.resize(2, path.empty() ? 0 : path.size() + 1);
+	for (size_t i = 0; i < path.size(); ++i)
+		m_vertices.col(i) = points[path[i]].cast<float>();
+	if (!path.empty())
+		m_vertices.col(path.size()) = m_vertices.col(0);
+}
+
+void TourRenderer::rebuildTiles()
+{
+	TRACE_SCOPE("Build Tour Tiles");
+
+	m_tileStarts.clear();
+	m_tileEdges.clear();
+	m_tileBounds.clear();
+	m_tileLengths.clear();
+	m_gridSize = { 0, 0 };
+	if (m_edgeCount == 0)
+		return;
+
+	Eigen::Vector2f minPos = m_vertices.leftCols(m_edgeCount).rowwise().minCoeff();
+	Eigen::Vector2f maxPos = m_vertices.leftCols(m_edgeCount).rowwise().maxCoeff();
+	Eigen::Vector2f extent = (maxPos - minPos).cwiseMax(Eigen::Vector2f{ 1, 1 });
+	size_t tileCount = std::min(std::max<size_t>(m_edgeCount / s_kEdgesPerTile, 1), s_kMaxTileCount);
+	m_tileSize = std::max(std::sqrt(extent.x() * extent.y() / tileCount), extent.maxCoeff() / s_kMaxTilesPerSide);
+	m_gridOrigin = minPos;
+	m_gridSize = { static_cast<int>(extent.x() / m_tileSize) + 1, static_cast<int>(extent.y() / m_tileSize) + 1 };
+
+	// Counting sort of the edges by the tile of their first vertex
+	size_t gridCellCount = static_cast<size_t>(m_gridSize.x()) * m_gridSize.y();
+	m_tileStarts.assign(gridCellCount + 1, 0);
+	m_tileBounds.assign(gridCellCount, Eigen::AlignedBox2f{});
+	m_tileLengths.assign(gridCellCount, 0);
+	std::vector<uint32_t> edgeTiles(m_edgeCount);
+	for (uint32_t edge = 0; edge < m_edgeCount; ++edge) {
+		Eigen::Vector2f from = m_vertices.col(edge);
+		Eigen::Vector2f to = m_vertices.col(edge + 1);
+		Eigen::Vector2f tile = (from - m_gridOrigin) / m_tileSize;
+		int x = std::min(static_cast<int>(tile.x()), m_gridSize.x() - 1);
+		int y = std::min(static_cast<int>(tile.y()), m_gridSize.y() - 1);
+		uint32_t tileIdx = static_cast<uint32_t>(y * m_gridSize.x() + x);
+
+		edgeTiles[edge] = tileIdx;
+		++m_tileStarts[tileIdx + 1];
+		m_tileBounds[tileIdx].extend(from);
+		m_tileBounds[tileIdx].extend(to);
+		m_tileLengths[tileIdx] += (to - from).norm();
+	}
+	for (size_t tileIdx = 1; tileIdx < m_tileStarts.size(); ++tileIdx)
+		m_tileStarts[tileIdx] += m_tileStarts[tileIdx - 1];
+
+	m_tileEdges.resize(m_edgeCount);
+	std::vector<uint32_t> tileFill(m_tileStarts.begin(), m_tileStarts.end() - 1);
+	for (uint32_t edge = 0; edge < m_edgeCount; ++edge)
+		m_tileEdges[tileFill[edgeTiles[edge]]++] = edge;
+}
+
+void TourRenderer::updateDrawList(const ViewTransform& view)
+{
+	TRACE_SCOPE("Build Tour Draw List");
+
+	// Cull the tiles against the view
+	Eigen::AlignedBox2f visibleBox = view.getVisibleBox().cast<float>();
+	std::vector<uint32_t> visibleTiles;
+	size_t visibleEdgeCount = 0;
+	for (size_t tileIdx = 0; tileIdx + 1 < m_tileStarts.size(); ++tileIdx) {
+		uint32_t tileEdgeCount = m_tileStarts[tileIdx + 1] - m_tileStarts[tileIdx];
+		if (tileEdgeCount == 0 || !m_tileBounds[tileIdx].intersects(visibleBox))
+			continue;
+		visibleTiles.push_back(static_cast<uint32_t>(tileIdx));
+		visibleEdgeCount += tileEdgeCount;
+	}
+
+	m_showingDensity = visibleEdgeCount > s_kMaxDrawnEdges;
+	if (m_showingDensity) {
+		buildDensityQuads(visibleTiles, view);
+		m_densityShader.bind();
+		if (!m_densityAlphas.empty()) {
+			m_densityShader.uploadAttrib("position", Eigen::Map<const Eigen::MatrixXf>(m_densityPositions.data(), 2, m_densityAlphas.size()));
+			m_densityShader.uploadAttrib("alpha", Eigen::Map<const Eigen::MatrixXf>(m_densityAlphas.data(), 1, m_densityAlphas.size()));
+		}
+	} else {
+		std::vector<uint32_t> edges;
+		edges.reserve(visibleEdgeCount);
+		for (uint32_t tileIdx : visibleTiles)
+			edges.insert(edges.end(), m_tileEdges.begin() + m_tileStarts[tileIdx], m_tileEdges.begin() + m_tileStarts[tileIdx + 1]);
+		std::sort(edges.begin(), edges.end());
+
+		buildLines(edges, view);
+		m_lineShader.bind();
+		if (!m_lineIndices.empty())
+			m_lineShader.uploadIndices(Eigen::Map<const Eigen::Matrix<uint32_t, Eigen::Dynamic, Eigen::Dynamic>>(m_lineIndices.data(), 2, m_lineIndices.size() / 2));
+	}
+
+	m_drawnView = view;
+	m_drawListValid = true;
+}
+
+void TourRenderer::buildLines(const std::vector<uint32_t>& edges, const ViewTransform& view)
+{
+	m_lineIndices.clear();
+	double minLengthSq = s_kMinEdgePixels / view.scale * (s_kMinEdgePixels / view.scale);
+
+	// Walk each run of consecutive edges, only ending a line once it is long
+	// enough to see. The last line of a run is always kept so that the tour
+	// has no gaps.
+	size_t i = 0;
+	while (i < edges.size()) {
+		uint32_t lineStart = edges[i];
+		uint32_t runEnd = edges[i] + 1;
+		++i;
+		while (i < edges.size() && edges[i] == runEnd) {
+			if ((m_vertices.col(runEnd) - m_vertices.col(lineStart)).squaredNorm() >= minLengthSq) {
+				m_lineIndices.push_back(lineStart);
+				m_lineIndices.push_back(runEnd);
+				lineStart = runEnd;
+			}
+			runEnd = edges[i] + 1;
+			++i;
+		}
+		m_lineIndices.push_back(lineStart);
+		m_lineIndices.push_back(runEnd);
+	}
+}
+
+void TourRenderer::buildDensityQuads(const std::vector<uint32_t>& tiles, const ViewTransform& view)
+{
+	m_densityPositions.clear();
+	m_densityAlphas.clear();
+
+	// A tile is opaque once the tour inside it would cover its area with
+	// one pixel wide lines
+	double tilePixelArea = m_tileSize * view.scale * m_tileSize * view.scale;
+	for (uint32_t tileIdx : tiles) {
+		float alpha = static_cast<float>(std::min(1.0, m_tileLengths[tileIdx] * view.scale / tilePixelArea));
+		float left = m_gridOrigin.x() + (tileIdx % m_gridSize.x()) * m_tileSize;
+		float top = m_gridOrigin.y() + (tileIdx / m_gridSize.x()) * m_tileSize;
+		float right = left + m_tileSize;
+		float bottom = top + m_tileSize;
+
+		const float corners[] = {
+			left, top, right, top, left, bottom,
+			right, top, right, bottom, left, bottom
+		};
+		m_densityPositions.insert(m_densityPositions.end(), std::begin(corners), std::end(corners));
+		m_densityAlphas.insert(m_densityAlphas.end(), 6, alpha);
+	}
+}
@@ -0,0 +1,105 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Draws a solver's tour with GL, at a level of detail that
+//                depends on what is visible rather than on the tour size.
+//                The node positions are kept in a vertex buffer that is only
+//                rebuilt when a render snapshot holds a new version of the
+//                tour, along with a grid of tiles listing the edges that
+//                start in each tile. When the view changes, only the edges
+//                in tiles overlapping it are considered, and runs of edges
+//                shorter than a pixel are merged into one line. When too
+//                many edges are visible, each tile is drawn as a single quad
+//                shaded by the length of tour inside it instead.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include <nanogui/glutil.h>
+
+#include "RenderSnapshot.h"
+#include "ViewTransform.h"
+
+class TourRenderer {
+public:
+	// Loads the shaders. Must be called with the GL context current.
+	TourRenderer();
+	~TourRenderer();
+
+	TourRenderer(const TourRenderer&) = delete;
+	TourRenderer& operator=(const TourRenderer&) = delete;
+
+	// Draws the snapshot's tour into the current viewport, which must cover
+	// the view's canvas.
+	// Note: NanoVG must be flushed (nvgEndFrame) first, or the tour will be
+	// drawn under anything NanoVG has queued.
+	void draw(const RenderSnapshot& snapshot, const ViewTransform& view);
+
+	// Returns true if the last draw showed edge density rather than edges.
+	bool isShowingDensity() const;
+
+	// Most edges drawn individually before falling back to density.
+	static const size_t s_kMaxDrawnEdges;
+
+	// Runs of edges are merged until they are at least this many pixels
+	// long.
+	static const double s_kMinEdgePixels;
+
+private:
+	// Copies the snapshot's node positions into m_vertices in tour order.
+	void buildVertices(const RenderSnapshot& snapshot);
+
+	// Sorts the edges of the tour in m_vertices into tiles.
+	void rebuildTiles();
+
+	// Rebuilds and uploads the line indices or density quads for a view.
+	void updateDrawList(const ViewTransform& view);
+
+	// Fills m_lineIndices from the visible edges, which must be sorted,
+	// merging runs of sub-pixel edges.
+	void buildLines(const std::vector<uint32_t>& edges, const ViewTransform& view);
+
+	// Fills the density quads from the visible tiles.
+	void buildDensityQuads(const std::vector<uint32_t>& tiles, const ViewTransform& view);
+
+	nanogui::GLShader m_lineShader;
+	nanogui::GLShader m_densityShader;
+
+	// Version of the tour held in the vertex buffer. Vertex i is the node at
+	// tour position i, with the first node repeated at the end, so edge i
+	// runs from vertex i to vertex i + 1.
+	uint64_t m_version;
+	Eigen::MatrixXf m_vertices;
+	uint32_t m_edgeCount;
+
+	// Tile grid over the nodes. m_tileStarts holds the offset of each
+	// tile's edges in m_tileEdges, plus one past the end. A tile's bounds
+	// cover both ends of all of its edges, so may reach outside the tile.
+	Eigen::Vector2f m_gridOrigin;
+	float m_tileSize;
+	Eigen::Vector2i m_gridSize;
+	std::vector<uint32_t> m_tileStarts;
+	std::vector<uint32_t> m_tileEdges;
+	std::vector<Eigen::AlignedBox2f> m_tileBounds;
+	std::vector<float> m_tileLengths;
+
+	// The view the draw list was built for, and the draw list itself
+	ViewTransform m_drawnView;
+	bool m_drawListValid;
+	bool m_showingDensity;
+	std::vector<uint32_t> m_lineIndices;
+	std::vector<float> m_densityPositions;
+	std::vector<float> m_densityAlphas;
+};
@@ -0,0 +1,210 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Optional timeline tracing of solver phases, written out in 
+//                the Chrome trace event format (viewable in chrome://tracing
+//                or Perfetto).
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Tracing.h"
+
+std::atomic<bool> g_tracingEnabled{ false };
+
+namespace {
+	// Events kept per thread. 32 bytes each.
+	const size_t s_kBufferCapacity = 1 << 16;
+
+	typedef std::chrono::high_resolution_clock Clock;
+
+	// One slot of a ring buffer. The sequence number is written last, so a 
+	// reader that sees the same sequence number before and after reading the
+	// fields knows they belong together, even if the writer was overwriting 
+	// the slot at the time.
+	struct Event {
+		Event() : sequence{ 0 }, name{ nullptr }, beginNanoseconds{ 0 }, durationNanoseconds{ 0 } {}
+
+		std::atomic<uint64_t> sequence;
+		std::atomic<const char*> name;
+		std::atomic<int64_t> beginNanoseconds;
+		std::atomic<int64_t> durationNanoseconds;
+	};
+
+	// A ring buffer written only by its own thread.
+	struct TraceBuffer {
+		TraceBuffer() : events(s_kBufferCapacity), head{ 0 }, alive{ true } {}
+
+		std::vector<Event> events;
+
+		// Number of events ever written. Only the owning thread writes it.
+		std::atomic<uint64_t> head;
+
+		std::string threadName;
+		std::atomic<bool> alive;
+	};
+
+	// All buffers of the current trace, including those of threads that
+	// have exited since it started.
+	std::mutex s_buffersMutex;
+	std::vector<std::unique_ptr<TraceBuffer>> s_buffers;
+
+	Clock::time_point s_traceStart;
+
+	// Gives its buffer up when the thread exits. The buffer itself is kept 
+	// until the next trace starts, so the thread's events are not lost.
+	struct ThreadBufferHandle {
+		~ThreadBufferHandle()
+		{
+			if (buffer)
+				buffer->alive = false;
+		}
+
+		TraceBuffer* buffer = nullptr;
+
+		// Kept here as well so a thread can be named before it has a buffer
+		std::string threadName;
+	};
+
+	thread_local ThreadBufferHandle s_threadBuffer;
+
+	TraceBuffer& getThreadBuffer()
+	{
+		if (!s_threadBuffer.buffer) {
+			std::lock_guard<std::mutex> lock(s_buffersMutex);
+			s_buffers.emplace_back(new TraceBuffer());
+			s_threadBuffer.buffer = s_buffers.back().get();
+			s_threadBuffer.buffer->threadName = s_threadBuffer.threadName;
+		}
+		return *s_threadBuffer.buffer;
+	}
+
+	// Escapes a string for use inside a JSON string literal.
+	std::string escapeJson(const std::string& str)
+	{
+		std::string escaped;
+		for (char c : str) {
+			if (c == '"' || c == '\\') {
+				escaped += '\\';
+				escaped += c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20) {
+				char code[8];
+				std::snprintf(code, sizeof(code), "\\u%04x", c);
+				escaped += code;
+			}
+			else {
+				escaped += c;
+			}
+		}
+		return escaped;
+	}
+}
+
+void startTracing()
+{
+	std::lock_guard<std::mutex> lock(s_buffersMutex);
+
+	// Buffers of exited threads belong to the previous trace. Live threads
+	// keep their buffers, and their old events are filtered out by time.
+	s_buffers.erase(std::remove_if(s_buffers.begin(), s_buffers.end(), [](const std::unique_ptr<TraceBuffer>& buffer) {
+		return !buffer->alive;
+	}), s_buffers.end());
+
+	s_traceStart = Clock::now();
+	g_tracingEnabled = true;
+}
+
+void stopTracing()
+{
+	g_tracingEnabled = false;
+}
+
+void setTraceThreadName(const std::string& name)
+{
+	// Buffers are only created once the thread records an event, so naming
+	// a thread costs nothing while tracing is off
+	s_threadBuffer.threadName = name;
+	if (s_threadBuffer.buffer) {
+		std::lock_guard<std::mutex> lock(s_buffersMutex);
+		s_threadBuffer.buffer->threadName = name;
+	}
+}
+
+void TraceScope::record(const char* name, Clock::time_point begin, Clock::time_point end)
+{
+	TraceBuffer& buffer = getThreadBuffer();
+	uint64_t index = buffer.head.load(std::memory_order_relaxed);
+	Event& event = buffer.events[index % s_kBufferCapacity];
+
+	// Mark the slot as being written before touching the fields
+	event.sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	event.name.store(name, std::memory_order_relaxed);
+	event.beginNanoseconds.store(std::chrono::duration_cast<std::chrono::nanoseconds>(begin.time_since_epoch()).count(), std::memory_order_relaxed);
+	event.durationNanoseconds.store(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count(), std::memory_order_relaxed);
+	event.sequence.store(index + 1, std::memory_order_release);
+
+	buffer.head.store(index + 1, std::memory_order_release);
+}
+
+bool writeTrace(const std::string& fileName)
+{
+	std::ofstream file(fileName);
+	if (!file)
+		return false;
+
+	std::lock_guard<std::mutex> lock(s_buffersMutex);
+	int64_t traceStartNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(s_traceStart.time_since_epoch()).count();
+
+	file << "{\"traceEvents\":[\n";
+	bool first = true;
+	for (size_t threadId = 0; threadId < s_buffers.size(); ++threadId) {
+		const TraceBuffer& buffer = *s_buffers[threadId];
+
+		if (!buffer.threadName.empty()) {
+			file << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << threadId
+			     << ",\"args\":{\"name\":\"" << escapeJson(buffer.threadName) << "\"}}";
+			first = false;
+		}
+
+		uint64_t head = buffer.head.load(std::memory_order_acquire);
+		uint64_t begin = head > s_kBufferCapacity ? head - s_kBufferCapacity : 0;
+		for (uint64_t index = begin; index < head; ++index) {
+			const Event& event = buffer.events[index % s_kBufferCapacity];
+			uint64_t sequence = event.sequence.load(std::memory_order_acquire);
+			const char* name = event.name.load(std::memory_order_relaxed);
+			int64_t beginNanoseconds = event.beginNanoseconds.load(std::memory_order_relaxed);
+			int64_t durationNanoseconds = event.durationNanoseconds.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			// Skip slots that were overwritten while being read, and events
+			// from before this trace started
+			if (sequence != index + 1 || event.sequence.load(std::memory_order_relaxed) != sequence)
+				continue;
+			if (beginNanoseconds < traceStartNanoseconds)
+				continue;
+
+			char line[256];
+			std::snprintf(line, sizeof(line), "{\"ph\":\"X\",\"name\":\"%s\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f}",
+			              name, threadId, (beginNanoseconds - traceStartNanoseconds) / 1000.0, durationNanoseconds / 1000.0);
+			file << (first ? "" : ",\n") << line;
+			first = false;
+		}
+	}
+	file << "\n]}\n";
+
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,83 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Optional timeline tracing of solver phases, written out in 
+//                the Chrome trace event format (viewable in chrome://tracing
+//                or Perfetto).
+//                Every thread records scoped events into its own fixed size
+//                ring buffer, so recording never takes a lock, and the 
+//                oldest events are overwritten once a buffer is full. When 
+//                tracing is off a scope costs a single relaxed load.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Set while events are being recorded. Use isTracing rather than reading
+// this directly.
+extern std::atomic<bool> g_tracingEnabled;
+
+// Starts a new trace, discarding the events of any previous one.
+void startTracing();
+
+// Stops recording events. Recorded events are kept until the next trace 
+// starts, so they can still be written out.
+void stopTracing();
+
+// Returns true if events are being recorded.
+inline bool isTracing()
+{
+	return g_tracingEnabled.load(std::memory_order_relaxed);
+}
+
+// Names the calling thread in the trace.
+void setTraceThreadName(const std::string& name);
+
+// Writes the events of the current (or last) trace as Chrome trace JSON.
+// Returns false if the file could not be written.
+bool writeTrace(const std::string& fileName);
+
+// Records the time from construction to destruction as an event on the 
+// calling thread's timeline.
+// Note: The name must outlive the trace, e.g. a string literal.
+class TraceScope {
+public:
+	explicit TraceScope(const char* name)
+		: m_name{ isTracing() ? name : nullptr }
+	{
+		if (m_name)
+			m_begin = std::chrono::high_resolution_clock::now();
+	}
+
+	~TraceScope()
+	{
+		if (m_name)
+			record(m_name, m_begin, std::chrono::high_resolution_clock::now());
+	}
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+	static void record(const char* name, std::chrono::high_resolution_clock::time_point begin, std::chrono::high_resolution_clock::time_point end);
+
+	const char* m_name;
+	std::chrono::high_resolution_clock::time_point m_begin;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+// Traces the rest of the enclosing scope under the given name.
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__){ name }
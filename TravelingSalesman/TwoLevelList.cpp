@@ -0,0 +1,461 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Two-level doubly-linked list tour representation.
+//                See "Data structures for traveling salesmen" by Fredman et al.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "TwoLevelList.h"
+
+TwoLevelList::TwoLevelList(const std::vector<size_t>& order)
+	: m_segmentCount{ 0 }
+	, m_groupSize{ 1 }
+	, m_targetSegmentCount{ 0 }
+	, m_ranksDirty{ false }
+{
+	rebuild(order);
+}
+
+void TwoLevelList::rebuild(const std::vector<size_t>& order)
+{
+	size_t n = order.size();
+	m_next.resize(n);
+	m_prev.resize(n);
+	m_parent.resize(n);
+	m_rank.resize(n);
+
+	m_groupSize = std::max(static_cast<size_t>(1), static_cast<size_t>(std::sqrt(static_cast<double>(n))));
+	m_segmentCount = (n + m_groupSize - 1) / m_groupSize;
+	m_targetSegmentCount = m_segmentCount;
+	m_segments.assign(m_segmentCount, Segment{});
+	m_freeSegments.clear();
+	m_ranksDirty = false;
+
+	for (size_t i = 0; i < n; ++i) {
+		size_t city = order[i];
+		m_next[city] = order[i + 1 == n ? 0 : i + 1];
+		m_prev[city] = order[i == 0 ? n - 1 : i - 1];
+		m_parent[city] = i / m_groupSize;
+		m_rank[city] = static_cast<ptrdiff_t>(i % m_groupSize);
+	}
+
+	for (size_t s = 0; s < m_segmentCount; ++s) {
+		size_t begin = s * m_groupSize;
+		size_t end = std::min(n, begin + m_groupSize);
+		Segment& segment = m_segments[s];
+		segment.reversed = false;
+		segment.first = order[begin];
+		segment.last = order[end - 1];
+		segment.next = s + 1 == m_segmentCount ? 0 : s + 1;
+		segment.prev = s == 0 ? m_segmentCount - 1 : s - 1;
+		segment.size = end - begin;
+		segment.rank = static_cast<ptrdiff_t>(s);
+	}
+}
+
+bool TwoLevelList::between(size_t a, size_t b, size_t c) const
+{
+	if (b == a || b == c)
+		return true;
+	if (a == c)
+		return false;
+
+	size_t segA = m_parent[a];
+	size_t segB = m_parent[b];
+	size_t segC = m_parent[c];
+	if (segA == segC) {
+		ptrdiff_t rankA = tourRank(a);
+		ptrdiff_t rankC = tourRank(c);
+		if (segB == segA) {
+			ptrdiff_t rankB = tourRank(b);
+			if (rankA < rankC)
+				return rankB > rankA && rankB < rankC;
+			else
+				return rankB > rankA || rankB < rankC;
+		}
+
+		// The path from a to c only leaves the segment if it wraps around
+		return rankA > rankC;
+	}
+	if (segB == segC)
+		return tourRank(b) < tourRank(c);
+	if (segA == segB)
+		return tourRank(a) < tourRank(b);
+
+	ptrdiff_t rankA = m_segments[segA].rank;
+	ptrdiff_t rankB = m_segments[segB].rank;
+	ptrdiff_t rankC = m_segments[segC].rank;
+	if (rankA < rankC)
+		return rankB > rankA && rankB < rankC;
+	else
+		return rankB > rankA || rankB < rankC;
+}
+
+void TwoLevelList::flip(size_t a, size_t b, size_t c, size_t d)
+{
+	// Reversing a single city (or all but one) leaves the tour unchanged
+	if (b == c || a == d)
+		return;
+
+	// Reverse within a single segment when one of the two paths allows it
+	if (m_parent[b] == m_parent[c] && tourRank(b) <= tourRank(c)) {
+		reverseLocal(b, c);
+		return;
+	}
+	if (m_parent[d] == m_parent[a] && tourRank(d) <= tourRank(a)) {
+		reverseLocal(d, a);
+		return;
+	}
+
+	// Make sure both paths consist of whole segments
+	if (m_parent[a] == m_parent[b])
+		split(a, b);
+	if (m_parent[c] == m_parent[d])
+		split(c, d);
+
+	// Reverse whichever path spans fewer segments
+	if (m_ranksDirty)
+		renumberSegments(m_parent[a]);
+	ptrdiff_t segmentCount = static_cast<ptrdiff_t>(m_segmentCount);
+	ptrdiff_t innerCount = m_segments[m_parent[c]].rank - m_segments[m_parent[b]].rank;
+	innerCount = (innerCount % segmentCount + segmentCount) % segmentCount + 1;
+	if (innerCount * 2 <= segmentCount)
+		reverseSegments(a, b, c, d);
+	else
+		reverseSegments(c, d, a, b);
+
+	// Keep the number of segments close to sqrt(n)
+	if (next(a) == c)
+		tryMerge(m_parent[a], m_parent[c]);
+	else
+		tryMerge(m_parent[c], m_parent[a]);
+	if (next(b) == d)
+		tryMerge(m_parent[b], m_parent[d]);
+	else
+		tryMerge(m_parent[d], m_parent[b]);
+
+	if (m_segmentCount > 2 * m_targetSegmentCount) {
+		std::vector<size_t> order;
+		getOrder(order);
+		rebuild(order);
+	}
+	else if (m_ranksDirty) {
+		renumberSegments(m_parent[a]);
+	}
+}
+
+void TwoLevelList::getOrder(std::vector<size_t>& outOrder) const
+{
+	outOrder.clear();
+	outOrder.reserve(size());
+	if (size() == 0)
+		return;
+
+	// Walk segment by segment so that only raw links need to be followed
+	size_t segment = m_parent[0];
+	for (size_t i = 0; i < m_segmentCount; ++i) {
+		const Segment& s = m_segments[segment];
+		if (s.reversed) {
+			for (size_t city = s.last; ; city = m_prev[city]) {
+				outOrder.push_back(city);
+				if (city == s.first)
+					break;
+			}
+		}
+		else {
+			for (size_t city = s.first; ; city = m_next[city]) {
+				outOrder.push_back(city);
+				if (city == s.last)
+					break;
+			}
+		}
+		segment = s.next;
+	}
+}
+
+size_t TwoLevelList::tourFirst(size_t segment) const
+{
+	const Segment& s = m_segments[segment];
+	return s.reversed ? s.last : s.first;
+}
+
+size_t TwoLevelList::tourLast(size_t segment) const
+{
+	const Segment& s = m_segments[segment];
+	return s.reversed ? s.first : s.last;
+}
+
+void TwoLevelList::setNextLink(size_t city, size_t nextCity)
+{
+	if (m_segments[m_parent[city]].reversed)
+		m_prev[city] = nextCity;
+	else
+		m_next[city] = nextCity;
+}
+
+void TwoLevelList::setPrevLink(size_t city, size_t prevCity)
+{
+	if (m_segments[m_parent[city]].reversed)
+		m_next[city] = prevCity;
+	else
+		m_prev[city] = prevCity;
+}
+
+void TwoLevelList::reverseLocal(size_t from, size_t to)
+{
+	Segment& segment = m_segments[m_parent[from]];
+
+	// Work in the segment's internal direction where ranks increase
+	size_t rawFirst = segment.reversed ? to : from;
+	size_t rawLast = segment.reversed ? from : to;
+	size_t outerPrev = m_prev[rawFirst];
+	size_t outerNext = m_next[rawLast];
+
+	m_scratch.clear();
+	for (size_t city = rawFirst; ; city = m_next[city]) {
+		m_scratch.push_back(city);
+		if (city == rawLast)
+			break;
+	}
+
+	ptrdiff_t baseRank = m_rank[rawFirst];
+	size_t length = m_scratch.size();
+	for (size_t i = 0; i < length; ++i) {
+		size_t city = m_scratch[i];
+		std::swap(m_next[city], m_prev[city]);
+		m_rank[city] = baseRank + static_cast<ptrdiff_t>(length - 1 - i);
+	}
+
+	// Reconnect the reversed path to its outer neighbours
+	m_prev[rawLast] = outerPrev;
+	m_next[rawFirst] = outerNext;
+	if (m_next[outerPrev] == rawFirst)
+		m_next[outerPrev] = rawLast;
+	else
+		m_prev[outerPrev] = rawLast;
+	if (m_prev[outerNext] == rawLast)
+		m_prev[outerNext] = rawFirst;
+	else
+		m_next[outerNext] = rawFirst;
+
+	if (segment.first == rawFirst)
+		segment.first = rawLast;
+	if (segment.last == rawLast)
+		segment.last = rawFirst;
+}
+
+void TwoLevelList::split(size_t a, size_t b)
+{
+	size_t oldSegment = m_parent[a];
+	size_t firstCity = tourFirst(oldSegment);
+	size_t headSize = static_cast<size_t>(tourRank(a) - tourRank(firstCity)) + 1;
+	size_t tailSize = m_segments[oldSegment].size - headSize;
+
+	// Note: Allocating may reallocate the segment list, so segments are
+	// only accessed by reference after this point.
+	size_t newSegment = allocateSegment();
+	Segment& oldS = m_segments[oldSegment];
+	Segment& newS = m_segments[newSegment];
+	newS.reversed = oldS.reversed;
+
+	// Ranks and links are unaffected since both segments share a direction,
+	// only the cities in the smaller half need to be relabelled.
+	if (headSize <= tailSize) {
+		if (oldS.reversed) {
+			relabel(a, oldS.last, newSegment);
+			newS.first = a;
+			newS.last = oldS.last;
+			oldS.last = b;
+		}
+		else {
+			relabel(oldS.first, a, newSegment);
+			newS.first = oldS.first;
+			newS.last = a;
+			oldS.first = b;
+		}
+		newS.size = headSize;
+		oldS.size = tailSize;
+
+		// Insert before the old segment
+		newS.prev = oldS.prev;
+		newS.next = oldSegment;
+		m_segments[oldS.prev].next = newSegment;
+		oldS.prev = newSegment;
+	}
+	else {
+		if (oldS.reversed) {
+			relabel(oldS.first, b, newSegment);
+			newS.first = oldS.first;
+			newS.last = b;
+			oldS.first = a;
+		}
+		else {
+			relabel(b, oldS.last, newSegment);
+			newS.first = b;
+			newS.last = oldS.last;
+			oldS.last = a;
+		}
+		newS.size = tailSize;
+		oldS.size = headSize;
+
+		// Insert after the old segment
+		newS.next = oldS.next;
+		newS.prev = oldSegment;
+		m_segments[oldS.next].prev = newSegment;
+		oldS.next = newSegment;
+	}
+
+	++m_segmentCount;
+	m_ranksDirty = true;
+}
+
+void TwoLevelList::relabel(size_t rawFirst, size_t rawLast, size_t segment)
+{
+	for (size_t city = rawFirst; ; city = m_next[city]) {
+		m_parent[city] = segment;
+		if (city == rawLast)
+			break;
+	}
+}
+
+void TwoLevelList::reverseSegments(size_t a, size_t b, size_t c, size_t d)
+{
+	size_t segA = m_parent[a];
+	size_t segB = m_parent[b];
+	size_t segC = m_parent[c];
+	size_t segD = m_parent[d];
+
+	// Reverse the segment list between b and c and toggle reversal bits.
+	// Links between cities inside the range stay valid since both ends of
+	// every internal connection are toggled together.
+	// Ranks are handed out in reverse, so segment c takes b's rank and so
+	// on, which keeps the ranks a consecutive sequence around the tour.
+	ptrdiff_t rank = m_segments[segC].rank;
+	for (size_t s = segB; ; ) {
+		Segment& segment = m_segments[s];
+		size_t nextSegment = segment.next;
+		std::swap(segment.next, segment.prev);
+		segment.reversed = !segment.reversed;
+		segment.rank = rank--;
+		if (s == segC)
+			break;
+		s = nextSegment;
+	}
+	m_segments[segC].prev = segA;
+	m_segments[segB].next = segD;
+	m_segments[segA].next = segC;
+	m_segments[segD].prev = segB;
+
+	// Reconnect the outer cities
+	setNextLink(a, c);
+	setPrevLink(c, a);
+	setNextLink(b, d);
+	setPrevLink(d, b);
+}
+
+void TwoLevelList::tryMerge(size_t first, size_t second)
+{
+	if (first == second)
+		return;
+	if (m_segments[first].size + m_segments[second].size > m_groupSize)
+		return;
+
+	if (m_segments[first].size >= m_segments[second].size)
+		absorb(first, second, true);
+	else
+		absorb(second, first, false);
+}
+
+void TwoLevelList::absorb(size_t dst, size_t src, bool append)
+{
+	// Collect the moved cities in travelling order before relabelling them.
+	// Following the raw links avoids looking up the parent of every city.
+	m_scratch.clear();
+	for (size_t city = m_segments[src].first; ; city = m_next[city]) {
+		m_scratch.push_back(city);
+		if (city == m_segments[src].last)
+			break;
+	}
+	if (m_segments[src].reversed)
+		std::reverse(m_scratch.begin(), m_scratch.end());
+
+	Segment& dstS = m_segments[dst];
+	Segment& srcS = m_segments[src];
+	bool swapLinks = dstS.reversed != srcS.reversed;
+	ptrdiff_t rankStep = dstS.reversed ? -1 : 1;
+	if (append) {
+		ptrdiff_t rank = m_rank[tourLast(dst)];
+		for (size_t movedCity : m_scratch) {
+			if (swapLinks)
+				std::swap(m_next[movedCity], m_prev[movedCity]);
+			m_parent[movedCity] = dst;
+			rank += rankStep;
+			m_rank[movedCity] = rank;
+		}
+		if (dstS.reversed)
+			dstS.first = m_scratch.back();
+		else
+			dstS.last = m_scratch.back();
+	}
+	else {
+		ptrdiff_t rank = m_rank[tourFirst(dst)];
+		for (auto it = m_scratch.rbegin(); it != m_scratch.rend(); ++it) {
+			size_t movedCity = *it;
+			if (swapLinks)
+				std::swap(m_next[movedCity], m_prev[movedCity]);
+			m_parent[movedCity] = dst;
+			rank -= rankStep;
+			m_rank[movedCity] = rank;
+		}
+		if (dstS.reversed)
+			dstS.last = m_scratch.front();
+		else
+			dstS.first = m_scratch.front();
+	}
+	dstS.size += srcS.size;
+
+	// Unlink the emptied segment
+	m_segments[srcS.prev].next = srcS.next;
+	m_segments[srcS.next].prev = srcS.prev;
+	freeSegment(src);
+	--m_segmentCount;
+	m_ranksDirty = true;
+}
+
+void TwoLevelList::renumberSegments(size_t startSegment)
+{
+	size_t segment = startSegment;
+	for (size_t i = 0; i < m_segmentCount; ++i) {
+		m_segments[segment].rank = static_cast<ptrdiff_t>(i);
+		segment = m_segments[segment].next;
+	}
+	m_ranksDirty = false;
+}
+
+size_t TwoLevelList::allocateSegment()
+{
+	if (!m_freeSegments.empty()) {
+		size_t segment = m_freeSegments.back();
+		m_freeSegments.pop_back();
+		return segment;
+	}
+
+	m_segments.push_back(Segment{});
+	return m_segments.size() - 1;
+}
+
+void TwoLevelList::freeSegment(size_t segment)
+{
+	m_freeSegments.push_back(segment);
+}
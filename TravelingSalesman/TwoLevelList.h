@@ -0,0 +1,142 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Two-level doubly-linked list tour representation.
+//                The tour is split into segments of roughly sqrt(n) cities,
+//                each with a reversal bit, so that next, prev, between and
+//                flip all run in O(sqrt(n)) time instead of O(n).
+//                Intended for large instances, see ArrayTour for small ones.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+class TwoLevelList {
+public:
+	// Creates a tour visiting the cities in the specified order.
+	// Cities must be numbered 0 to order.size() - 1.
+	explicit TwoLevelList(const std::vector<size_t>& order);
+
+	// Returns the number of cities in the tour.
+	size_t size() const { return m_next.size(); }
+
+	// Returns the city visited after the specified city.
+	size_t next(size_t city) const
+	{
+		return m_segments[m_parent[city]].reversed ? m_prev[city] : m_next[city];
+	}
+
+	// Returns the city visited before the specified city.
+	size_t prev(size_t city) const
+	{
+		return m_segments[m_parent[city]].reversed ? m_next[city] : m_prev[city];
+	}
+
+	// Returns true if b lies on the path from a to c (inclusive) when
+	// travelling forwards through the tour.
+	bool between(size_t a, size_t b, size_t c) const;
+
+	// Performs a 2-opt move, replacing the edges (a, b) and (c, d) with the
+	// edges (a, c) and (b, d).
+	// Requires b == next(a) and d == next(c).
+	// Note: The shorter of the two paths is reversed, so the direction of the
+	// tour may be flipped after this call.
+	void flip(size_t a, size_t b, size_t c, size_t d);
+
+	// Outputs the cities in visiting order.
+	void getOrder(std::vector<size_t>& outOrder) const;
+
+private:
+	// A run of consecutive cities in the tour.
+	// first and last are the cities with the lowest and highest rank. When a
+	// segment is reversed the tour visits its cities from last to first.
+	struct Segment {
+		bool reversed;
+		size_t first;
+		size_t last;
+		size_t next;
+		size_t prev;
+		size_t size;
+		ptrdiff_t rank;
+	};
+
+	// Rebuilds all segments from scratch for the given visiting order.
+	void rebuild(const std::vector<size_t>& order);
+
+	// Returns the rank of a city within its segment in travelling order.
+	ptrdiff_t tourRank(size_t city) const
+	{
+		return m_segments[m_parent[city]].reversed ? -m_rank[city] : m_rank[city];
+	}
+
+	// Returns the first city of a segment in travelling order.
+	size_t tourFirst(size_t segment) const;
+
+	// Returns the last city of a segment in travelling order.
+	size_t tourLast(size_t segment) const;
+
+	// Sets the city visited after / before a city, taking the reversal bit of
+	// its segment into account.
+	void setNextLink(size_t city, size_t nextCity);
+	void setPrevLink(size_t city, size_t prevCity);
+
+	// Reverses the path from one city to another, where both are in the same
+	// segment and the path does not leave that segment.
+	void reverseLocal(size_t from, size_t to);
+
+	// Splits the segment containing a and b = next(a) so that a becomes the
+	// last city of one segment and b the first city of the next.
+	// The smaller half is moved into a new segment.
+	void split(size_t a, size_t b);
+
+	// Assigns a segment to the cities from rawFirst to rawLast, following
+	// the raw (internal direction) links.
+	void relabel(size_t rawFirst, size_t rawLast, size_t segment);
+
+	// Reverses the path b..c, where b starts a segment and c ends a segment,
+	// by reversing the order of the segments between them and toggling their
+	// reversal bits. a = prev(b) and d = next(c).
+	void reverseSegments(size_t a, size_t b, size_t c, size_t d);
+
+	// Merges two neighbouring segments if they are small enough to be
+	// stored as one. second must follow first in travelling order.
+	void tryMerge(size_t first, size_t second);
+
+	// Moves all cities from one segment to the start or end of its
+	// neighbour, then releases the emptied segment.
+	void absorb(size_t dst, size_t src, bool append);
+
+	// Renumbers segment ranks in travelling order starting from a segment.
+	// Splits and merges only mark the ranks as dirty so that a flip 
+	// renumbers at most twice.
+	void renumberSegments(size_t startSegment);
+
+	size_t allocateSegment();
+	void freeSegment(size_t segment);
+
+	// Per city links and ranks. next and prev are stored in the segment's
+	// internal direction and must be interpreted using its reversal bit.
+	std::vector<size_t> m_next;
+	std::vector<size_t> m_prev;
+	std::vector<size_t> m_parent;
+	std::vector<ptrdiff_t> m_rank;
+
+	std::vector<Segment> m_segments;
+	std::vector<size_t> m_freeSegments;
+	size_t m_segmentCount;
+	size_t m_groupSize;
+	size_t m_targetSegmentCount;
+	bool m_ranksDirty;
+
+	// Reused scratch space to avoid allocating during flips.
+	std::vector<size_t> m_scratch;
+};
@@ -48,11 +48,12 @@ void unorderedErase(Vector& v, size_t i)
 	v.pop_back();
 }
 
-// Returns a generator for generating random numbers
-std::mt19937& getRandomGenerator() 
+// Returns a generator for generating random numbers.
+// Each thread has its own generator so that solvers can run concurrently.
+inline std::mt19937& getRandomGenerator() 
 {
-	static std::random_device rd;
-	static std::mt19937 gen(rd());
+	thread_local std::random_device rd;
+	thread_local std::mt19937 gen(rd());
 	return gen;
 }
 
@@ -76,7 +77,7 @@ IntT randomInt(IntT min = 0, IntT max = 1)
 template<typename Iter, typename RandomGenerator>
 Iter selectRandomly(Iter start, Iter end, RandomGenerator& g) 
 {
-	std::uniform_int_distribution<std::_Iter_diff_t<Iter>> dist(0, std::distance(start, end) - 1);
+	std::uniform_int_distribution<typename std::iterator_traits<Iter>::difference_type> dist(0, std::distance(start, end) - 1);
 	std::advance(start, dist(g));
 	return start;
 }
@@ -0,0 +1,84 @@
+//
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+//
+// (c) 2017 Media Design School
+//
+// Description  : Mapping between solver (world) coordinates and canvas
+//                pixels, used for panning and zooming the canvas.
+// Author       : Lance Chaney
+// Mail         : lance.cha7337@mediadesign.school.nz
+//
+
+#pragma once
+
+#include <algorithm>
+
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+
+struct ViewTransform {
+	ViewTransform()
+		: offset{ 0, 0 }
+		, scale{ 1 }
+		, canvasSize{ 0, 0 }
+	{
+	}
+
+	// Returns the canvas pixel position of a world position.
+	Eigen::Vector2d toCanvas(const Eigen::Vector2d& world) const
+	{
+		return (world - offset) * scale;
+	}
+
+	// Returns the world position of a canvas pixel position.
+	Eigen::Vector2d toWorld(const Eigen::Vector2d& canvas) const
+	{
+		return canvas / scale + offset;
+	}
+
+	// Returns the part of the world that is visible on the canvas.
+	Eigen::AlignedBox2d getVisibleBox() const
+	{
+		return Eigen::AlignedBox2d(offset, toWorld(canvasSize));
+	}
+
+	// Zooms by the given factor, keeping the world position under the given
+	// canvas position fixed.
+	void zoom(double factor, const Eigen::Vector2d& canvasPos)
+	{
+		Eigen::Vector2d world = toWorld(canvasPos);
+		scale *= factor;
+		offset = world - canvasPos / scale;
+	}
+
+	// Moves the view so that the box fills the canvas, keeping a margin of
+	// the given number of pixels.
+	void fit(const Eigen::AlignedBox2d& box, double margin)
+	{
+		Eigen::Vector2d available = (canvasSize - Eigen::Vector2d{ 2 * margin, 2 * margin }).cwiseMax(Eigen::Vector2d{ 1, 1 });
+		Eigen::Vector2d extent = box.sizes().cwiseMax(Eigen::Vector2d{ 1e-9, 1e-9 });
+		scale = std::min(available.x() / extent.x(), available.y() / extent.y());
+		offset = box.center() - canvasSize / (2 * scale);
+	}
+
+	bool operator==(const ViewTransform& other) const
+	{
+		return offset == other.offset && scale == other.scale && canvasSize == other.canvasSize;
+	}
+
+	bool operator!=(const ViewTransform& other) const
+	{
+		return !(*this == other);
+	}
+
+	// World position shown at the canvas' top left corner.
+	Eigen::Vector2d offset;
+
+	// Canvas pixels per world unit.
+	double scale;
+
+	Eigen::Vector2d canvasSize;
+};
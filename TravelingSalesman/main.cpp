@@ -12,7 +12,7 @@
 // Mail         : lance.cha7337@mediadesign.school.nz
 //
 
-#include <nanogui\nanogui.h>
+#include <nanogui/nanogui.h>
 
 #include "App.h"
 